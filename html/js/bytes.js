@@ -0,0 +1,67 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Byte array conversions, shared by the page and the TPM worker.
+//
+// The WASM module takes and returns byte buffers (std::vector<uint8_t>) as
+// Uint8Arrays, see src/bindings.cc. The functions below convert to and from
+// them.
+
+function StringToStdVector(str) {
+    var bytes = new Uint8Array(str.length);
+    for (var i = 0; i < str.length; i++) {
+        bytes[i] = str.charCodeAt(i);
+    }
+    return bytes;
+}
+
+// Also takes objects with byte values at index keys, e.g. deep copies of
+// arrays.
+function ByteArrayToStdVector(bytes) {
+    if (ArrayBuffer.isView(bytes) || Array.isArray(bytes)) {
+        return Uint8Array.from(bytes);
+    }
+    return Uint8Array.from(Object.values(bytes));
+}
+
+function StdVectorToByteArray(v) {
+    return Array.from(v);
+}
+
+function ByteArrayToBigInt(bytes) {
+    var bn = BigInt(0);
+    for (var i in bytes) {
+        bn <<= BigInt(8);
+        bn += BigInt(bytes[i]);
+    }
+    return bn;
+}
+
+function ByteArrayToBigIntStr(bytes) {
+    return "0x" + ByteArrayToBigInt(bytes).toString(16);
+}
+
+function BigIntToByteArray(bn) {
+    var bytes = [];
+    while (bn > 0) {
+        bytes.push(parseInt(bn & BigInt(0xFF)));
+        bn >>= BigInt(8);
+    }
+    bytes.reverse();
+    return bytes;
+}
+
+function BigIntStrToByteArray(str) {
+    return BigIntToByteArray(BigInt(str));
+}
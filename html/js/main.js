@@ -12,20 +12,23 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-// TPM application object (src/app.cc).
-var app = {};
-
-// TPM simulator: wraps src/simulator.cc static functions.
-var sim = {};
-
-// TPM util: wraps src/util.cc static functions.
-var util = {};
+// The TPM of the page runs in a dedicated Web Worker (js/tpm_worker.js), so
+// that the page stays responsive while e.g. a 2048-bit CreatePrimary runs.
+// app, sim and util have the functions of the TPM application object
+// (src/app.cc), and of the simulator (src/simulator.cc) and util
+// (src/util.cc) static functions, but each call returns a promise of the
+// result. Calls queue in the worker and run in order, once the TPM is
+// initialized.
+//
+// Example: app.GetRandom(10).then(bytes => print(bytes));
+// or, in code cells: var bytes = await app.GetRandom(10);
 
 // Log verbosity level.
 var logging_level = 2;
 
 // Adds log message to logs output window.
-// This function is called from the WASM code (src/log.cc).
+// This function is called from the WASM code (src/log.cc), through the TPM
+// worker.
 function LogMessage(level, msg) {
     if (level <= logging_level) {
         $("#textarea_logs")
@@ -37,57 +40,114 @@ function LogMessage(level, msg) {
     }
 }
 
-function StringToStdVector(str) {
-    var v = new Module.StdVectorOfBytes();
-    for (var ch of str) {
-        v.push_back(ch.charCodeAt());
-    }
-    return v;
-}
-
-function ByteArrayToStdVector(bytes) {
-    var v = new Module.StdVectorOfBytes();
-    for (var i in bytes) {
-        v.push_back(bytes[i]);
-    }
-    return v;
+// App functions after which the simulator window is refreshed. This
+// simplifies our code snippets.
+var REFRESHING_APP_FUNCTIONS = ["Startup", "ExtendPcr"];
+
+// Returns an object whose functions post calls on object ("app", "sim" or
+// "util") to the TPM worker.
+function TpmWorkerObject(object) {
+    return new Proxy({}, {
+        get: function(target, method) {
+            // Not a thenable.
+            if (method == "then") {
+                return undefined;
+            }
+            return function() {
+                var args = Array.from(arguments);
+                var result = new Promise(function(resolve, reject) {
+                    var worker = GetTpmWorker();
+                    var id = worker.next_id++;
+                    worker.pending[id] = {
+                        resolve: resolve,
+                        reject: reject
+                    };
+                    worker.postMessage({
+                        id: id,
+                        object: object,
+                        method: method,
+                        args: args
+                    });
+                });
+                if (object == "app" && REFRESHING_APP_FUNCTIONS.includes(method)) {
+                    return result.then(function(value) {
+                        RefreshSimulatorWindow();
+                        return value;
+                    });
+                }
+                return result;
+            };
+        }
+    });
 }
 
+var tpm_worker = null;
 
-function StdVectorToByteArray(v) {
-    var bytes = [];
-    for (var i = 0; i < v.size(); i++) {
-        bytes.push(v.get(i));
+// Returns the TPM worker, started on the first call, or again after it
+// failed.
+function GetTpmWorker() {
+    if (tpm_worker !== null) {
+        return tpm_worker;
     }
-    return bytes;
+    tpm_worker = new Worker("js/tpm_worker.js");
+    tpm_worker.next_id = 0;
+    // Promise callbacks of calls in flight, by id.
+    tpm_worker.pending = {};
+    tpm_worker.onmessage = function(event) {
+        var message = event.data;
+        if ("log" in message) {
+            LogMessage(message.log[0], message.log[1]);
+            return;
+        }
+        if ("fatal" in message) {
+            FailTpmWorker(this, message.fatal);
+            return;
+        }
+        var call = this.pending[message.id];
+        delete this.pending[message.id];
+        if ("error" in message) {
+            call.reject(new Error(message.error));
+        } else {
+            call.resolve(message.result);
+        }
+    };
+    tpm_worker.onerror = function(event) {
+        FailTpmWorker(this, event.message || "TPM worker failed");
+    };
+    tpm_worker.onmessageerror = function() {
+        FailTpmWorker(this, "Cannot read a message of the TPM worker");
+    };
+    return tpm_worker;
 }
 
-function ByteArrayToBigInt(bytes) {
-    var bn = BigInt(0);
-    for (var i in bytes) {
-        bn <<= BigInt(8);
-        bn += BigInt(bytes[i]);
+// Stops worker, which failed, e.g. its module did not load or aborted, and
+// rejects its calls in flight. The next call starts a new worker, whose TPM
+// starts from the NV state saved by the failed one.
+function FailTpmWorker(worker, error) {
+    console.log("TPM worker failed:", error);
+    worker.terminate();
+    if (tpm_worker === worker) {
+        tpm_worker = null;
+    }
+    var pending = worker.pending;
+    worker.pending = {};
+    for (var id in pending) {
+        pending[id].reject(new Error(error));
     }
-    return bn;
 }
 
-function ByteArrayToBigIntStr(bytes) {
-    return "0x" + ByteArrayToBigInt(bytes).toString(16);
-}
+var app = TpmWorkerObject("app");
+var sim = TpmWorkerObject("sim");
+var util = TpmWorkerObject("util");
 
-function BigIntToByteArray(bn) {
-    var bytes = [];
-    while (bn > 0) {
-        bytes.push(parseInt(bn & BigInt(0xFF)));
-        bn >>= BigInt(8);
+// Save NV without waiting for the TPM to be idle when the page may go away.
+document.addEventListener("visibilitychange", function() {
+    if (document.visibilityState == "hidden" && tpm_worker !== null) {
+        tpm_worker.postMessage({
+            flush_nv: true
+        });
     }
-    bytes.reverse();
-    return bytes;
-}
-
-function BigIntStrToByteArray(str) {
-    return BigIntToByteArray(BigInt(str));
-}
+});
 
 function ByteArrayToForgeBuffer(bytes) {
     var buffer = forge.util.createBuffer();
@@ -136,40 +196,76 @@ function SetPowerStatuIcon(el, is_on) {
 }
 
 function RefreshPcrTable() {
-    var data = [];
-    for (var pcr = 0; pcr < 4; pcr++) {
-        data.push({
-            "pcr": pcr,
-            "value": HexdumpByteArray(sim.GetPcr(pcr))
-        });
-    }
-    $("#table_pcrs").bootstrapTable("load", data);
+    var pcrs = [0, 1, 2, 3];
+    return Promise.all(pcrs.map(pcr => sim.GetPcr(pcr))).then(function(values) {
+        var data = [];
+        for (var pcr of pcrs) {
+            data.push({
+                "pcr": pcr,
+                "value": HexdumpByteArray(values[pcr])
+            });
+        }
+        $("#table_pcrs").bootstrapTable("load", data);
+    });
 }
 
 function RefreshSeedsTable() {
-    var data = [{
-        "hierarchy": "Endorsement",
-        "value": HexdumpByteArray(sim.GetEndorsementSeed())
-    }, {
-        "hierarchy": "Platform",
-        "value": HexdumpByteArray(sim.GetPlatformSeed())
-    }, {
-        "hierarchy": "Owner",
-        "value": HexdumpByteArray(sim.GetOwnerSeed())
-    }, {
-        "hierarchy": "Null",
-        "value": HexdumpByteArray(sim.GetNullSeed())
-    }, ];
-    $("#table_seeds").bootstrapTable("load", data);
+    return Promise.all([
+        sim.GetEndorsementSeed(),
+        sim.GetPlatformSeed(),
+        sim.GetOwnerSeed(),
+        sim.GetNullSeed(),
+    ]).then(function(seeds) {
+        var data = [{
+            "hierarchy": "Endorsement",
+            "value": HexdumpByteArray(seeds[0])
+        }, {
+            "hierarchy": "Platform",
+            "value": HexdumpByteArray(seeds[1])
+        }, {
+            "hierarchy": "Owner",
+            "value": HexdumpByteArray(seeds[2])
+        }, {
+            "hierarchy": "Null",
+            "value": HexdumpByteArray(seeds[3])
+        }, ];
+        $("#table_seeds").bootstrapTable("load", data);
+    });
+}
+
+// Shows the version and state of the simulator, once the TPM worker has
+// initialized it, and enables the controls that use the TPM: the System menu
+// and the Run buttons of code cells, disabled until then. They are enabled
+// even if the worker failed, since the next call starts a new one.
+function OnTpmInitialized() {
+    var enable_controls = function() {
+        $("#dropdown_system, .code_cell button.run").prop("disabled", false);
+    };
+    return app.GetTpmProperties().then(function(properties) {
+        $("#simulator_version")
+            .text(properties.manufacturer_id + "v" + properties.spec_version)
+        enable_controls();
+        return RefreshSimulatorWindow();
+    }, function(e) {
+        console.log("Cannot initialize TPM", e);
+        enable_controls();
+    });
 }
 
 function RefreshSimulatorWindow() {
-    SetPowerStatuIcon($("#icon_powered"), sim.IsPoweredOn());
-    SetPowerStatuIcon($("#icon_manufactured"), sim.IsManufactured());
-    SetPowerStatuIcon($("#icon_started"), sim.IsStarted());
-    $("#boot_counter").text(sim.GetBootCounter());
-    RefreshPcrTable();
-    RefreshSeedsTable();
+    return Promise.all([
+        sim.IsPoweredOn(),
+        sim.IsManufactured(),
+        sim.IsStarted(),
+        sim.GetBootCounter(),
+        RefreshPcrTable(),
+        RefreshSeedsTable(),
+    ]).then(function(status) {
+        SetPowerStatuIcon($("#icon_powered"), status[0]);
+        SetPowerStatuIcon($("#icon_manufactured"), status[1]);
+        SetPowerStatuIcon($("#icon_started"), status[2]);
+        $("#boot_counter").text(status[3]);
+    });
 }
 
 function ShowSeedsWindow() {
@@ -204,12 +300,15 @@ $(document).ready(function() {
     $("#system_actions").on("click", "li", function(event) {
         event.preventDefault();
         var action = $(event.target).attr("data-value");
+        // The worker runs calls in order, so the window is refreshed once
+        // the last one is done.
+        var done;
         switch (action) {
             case "restart":
                 app.Shutdown();
                 sim.PowerOff();
                 sim.PowerOn();
-                app.Startup();
+                done = app.Startup();
                 break;
 
             case "clear":
@@ -217,7 +316,7 @@ $(document).ready(function() {
                 app.Shutdown();
                 sim.PowerOff();
                 sim.PowerOn();
-                app.Startup();
+                done = app.Startup();
                 break;
 
             case "manufacture_reset":
@@ -226,13 +325,14 @@ $(document).ready(function() {
                 sim.ManufactureReset();
                 sim.PowerOff();
                 sim.PowerOn();
-                app.Startup();
+                done = app.Startup();
                 break;
 
             default:
                 console.log("Unknown action", action);
+                return;
         }
-        RefreshSimulatorWindow();
+        done.then(RefreshSimulatorWindow);
     });
 
     // Process view menu action.
@@ -279,20 +379,18 @@ $(document).ready(function() {
         var output = [];
         output_el.text("...");
         $.when().then(function() {
-            try {
-                var print = function() {
-                    var args = []
-                    for (var i in arguments) {
-                        if (typeof(arguments[i]) == 'string' || arguments[i] instanceof String) {
-                            args.push(arguments[i]);
-                        } else {
-                            args.push(JSON.stringify(arguments[i]));
-                        }
+            var print = function() {
+                var args = []
+                for (var i in arguments) {
+                    if (typeof(arguments[i]) == 'string' || arguments[i] instanceof String) {
+                        args.push(arguments[i]);
+                    } else {
+                        args.push(JSON.stringify(arguments[i]));
                     }
-                    output.push(args.join(" "));
-                };
-                output.push(JSON.stringify(eval(input_el.text())));
-            } catch (e) {
+                }
+                output.push(args.join(" "));
+            };
+            var print_error = function(e) {
                 if (e instanceof Error) {
                     output.push(e.stack);
                 } else if (typeof(e) === 'string' || e instanceof String) {
@@ -300,355 +398,33 @@ $(document).ready(function() {
                 } else {
                     output.push(JSON.stringify(e));
                 }
+            };
+            var show_output = function() {
+                output_el.text(output.join("\n"));
+                output_el.removeClass('prettyprinted');
+                PR.prettyPrint();
+            };
+            try {
+                var code = input_el.text();
+                // Code that awaits TPM calls runs as the body of an async
+                // function, which shows what it prints.
+                var result = /\bawait\b/.test(code) ?
+                    eval("(async function() {\n" + code + "\n})()") :
+                    eval(code);
+                // E.g. a TPM call: show its result once it is done.
+                if (result instanceof Promise) {
+                    result.then(function(value) {
+                        output.push(JSON.stringify(value));
+                    }, print_error).then(show_output);
+                    return;
+                }
+                output.push(JSON.stringify(result));
+            } catch (e) {
+                print_error(e);
             }
-            output_el.text(output.join("\n"));
-            output_el.removeClass('prettyprinted');
-            PR.prettyPrint();
+            show_output();
         });
     })
 
-    Module.onRuntimeInitialized = function() {
-        console.log("WASM runtime initialized. Creating global objects");
-        app = new Module.App();
-
-
-        //
-        // Decorate wasm functions: change return types to simper, native js types.
-        //
-        app.GetRandom = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                return StdVectorToByteArray(result);
-            }
-        }(app.GetRandom);
-
-        app.CreatePrimary = function(wrapped) {
-            return function() {
-                // Function signature:
-                //
-                // CreatePrimaryResult CreatePrimary(int hierarchy, int type, int restricted,
-                //                                   int decrypt, int sign,
-                //                                   const std::string &unique,
-                //                                   const std::string &user_auth,
-                //                                   const std::string &sensitive_data,
-                //                                   const std::vector<uint8_t> &auth_policy);
-                //
-                // Add extra default arguments to match signature.
-                if (arguments.length == 0) {
-                    [].push.call(arguments, /*hierarchy=*/ TPM2_RH_OWNER);
-                }
-                if (arguments.length == 1) {
-                    [].push.call(arguments, /*type=*/ TPM2_ALG_RSA);
-                }
-                if (arguments.length == 2) {
-                    [].push.call(arguments, /*restricted=*/ 1);
-                }
-                if (arguments.length == 3) {
-                    [].push.call(arguments, /*decrypt=*/ 1);
-                }
-                if (arguments.length == 4) {
-                    [].push.call(arguments, /*sign=*/ 0);
-                }
-                if (arguments.length == 5) {
-                    [].push.call(arguments, /*unique=*/ "");
-                }
-                if (arguments.length == 6) {
-                    [].push.call(arguments, /*user_auth=*/ "");
-                }
-                if (arguments.length == 7) {
-                    [].push.call(arguments, /*sensitive_data=*/ "");
-                }
-                if (arguments.length == 8) {
-                    [].push.call(arguments, /*auth_policy=*/ StringToStdVector(""));
-                }
-                const result = wrapped.apply(this, arguments);
-                result.rsa_public_n = ByteArrayToBigIntStr(StdVectorToByteArray(result.rsa_public_n));
-                result.ecc_public_x = ByteArrayToBigIntStr(StdVectorToByteArray(result.ecc_public_x));
-                result.ecc_public_y = ByteArrayToBigIntStr(StdVectorToByteArray(result.ecc_public_y));
-                result.name = StdVectorToByteArray(result.name);
-                result.parent_name = StdVectorToByteArray(result.parent_name);
-                result.parent_qualified_name = StdVectorToByteArray(result.parent_qualified_name);
-                return result;
-            }
-        }(app.CreatePrimary);
-
-        app.CreatePrimaryEndorsementKey = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                result.rsa_public_n = ByteArrayToBigIntStr(StdVectorToByteArray(result.rsa_public_n));
-                result.ecc_public_x = ByteArrayToBigIntStr(StdVectorToByteArray(result.ecc_public_x));
-                result.ecc_public_y = ByteArrayToBigIntStr(StdVectorToByteArray(result.ecc_public_y));
-                result.name = StdVectorToByteArray(result.name);
-                result.parent_name = StdVectorToByteArray(result.parent_name);
-                result.parent_qualified_name = StdVectorToByteArray(result.parent_qualified_name);
-                return result;
-            }
-        }(app.CreatePrimaryEndorsementKey);
-
-        app.Create = function(wrapped) {
-            return function() {
-                // Function signature:
-                //
-                // CreateResult Create(uint32_t parent_handle, int type, int restricted,
-                //                     int decrypt, int sign, const std::string &user_auth,
-                //                     const std::string &sensitive_data,
-                //                     const std::vector<uint8_t> &auth_policy);
-                //
-                // Add extra default arguments to match signature.
-                if (arguments.length == 1) {
-                    [].push.call(arguments, /*type=*/ TPM2_ALG_RSA);
-                }
-                if (arguments.length == 2) {
-                    [].push.call(arguments, /*restricted=*/ 1);
-                }
-                if (arguments.length == 3) {
-                    [].push.call(arguments, /*decrypt=*/ 0);
-                }
-                if (arguments.length == 4) {
-                    [].push.call(arguments, /*sign=*/ 1);
-                }
-                if (arguments.length == 5) {
-                    [].push.call(arguments, /*user_auth=*/ "");
-                }
-                if (arguments.length == 6) {
-                    [].push.call(arguments, /*sensitive_data=*/ "");
-                }
-                if (arguments.length == 7) {
-                    [].push.call(arguments, /*auth_policy=*/ StringToStdVector(""));
-                }
-                const result = wrapped.apply(this, arguments);
-                // Don't change tpm2b types.
-                // result.tpm2b_private = StdVectorToByteArray(result.tpm2b_private);
-                // result.tpm2b_public = StdVectorToByteArray(result.tpm2b_public);
-                result.rsa_public_n = ByteArrayToBigIntStr(StdVectorToByteArray(result.rsa_public_n));
-                result.ecc_public_x = ByteArrayToBigIntStr(StdVectorToByteArray(result.ecc_public_x));
-                result.ecc_public_y = ByteArrayToBigIntStr(StdVectorToByteArray(result.ecc_public_y));
-                result.parent_name = StdVectorToByteArray(result.parent_name);
-                result.parent_qualified_name = StdVectorToByteArray(result.parent_qualified_name);
-                return result;
-            }
-        }(app.Create);
-
-        app.Load = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                result.name = StdVectorToByteArray(result.name);
-                return result;
-            }
-        }(app.Load);
-
-        app.Decrypt = function(wrapped) {
-            return function() {
-                arguments[1] = jQuery.extend(true, {}, arguments[1]); // deep-copy buffer.
-                arguments[1] = ByteArrayToStdVector(arguments[1]);
-                const result = wrapped.apply(this, arguments);
-                return StdVectorToByteArray(result);
-            }
-        }(app.Decrypt);
-
-        app.Encrypt = function(wrapped) {
-            return function() {
-                arguments[1] = jQuery.extend(true, {}, arguments[1]); // deep-copy buffer.
-                arguments[1] = ByteArrayToStdVector(arguments[1]);
-                const result = wrapped.apply(this, arguments);
-                return StdVectorToByteArray(result);
-            }
-        }(app.Encrypt);
-
-        app.Sign = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                result.rsa_ssa_sig = StdVectorToByteArray(result.rsa_ssa_sig);
-                result.ecdsa_r = ByteArrayToBigIntStr(StdVectorToByteArray(result.ecdsa_r));
-                result.ecdsa_s = ByteArrayToBigIntStr(StdVectorToByteArray(result.ecdsa_s));
-                return result;
-            }
-        }(app.Sign);
-
-        app.VerifySignature = function(wrapped) {
-            return function() {
-                arguments[2] = jQuery.extend(true, {}, arguments[2]); // deep-copy SignResult.
-                arguments[2].rsa_ssa_sig = ByteArrayToStdVector(arguments[2].rsa_ssa_sig);
-                arguments[2].ecdsa_r = ByteArrayToStdVector(BigIntStrToByteArray(arguments[2].ecdsa_r));
-                arguments[2].ecdsa_s = ByteArrayToStdVector(BigIntStrToByteArray(arguments[2].ecdsa_s));
-                const result = wrapped.apply(this, arguments);
-                return result;
-            }
-        }(app.VerifySignature);
-
-        app.RSADecrypt = function(wrapped) {
-            return function() {
-                arguments[1] = jQuery.extend(true, {}, arguments[1]); // deep-copy buffer.
-                arguments[1] = ByteArrayToStdVector(arguments[1]);
-                const result = wrapped.apply(this, arguments);
-                return StdVectorToByteArray(result);
-            }
-        }(app.RSADecrypt);
-
-        app.RSAEncrypt = function(wrapped) {
-            return function() {
-                arguments[1] = jQuery.extend(true, {}, arguments[1]); // deep-copy buffer.
-                arguments[1] = ByteArrayToStdVector(arguments[1]);
-                const result = wrapped.apply(this, arguments);
-                return StdVectorToByteArray(result);
-            }
-        }(app.RSAEncrypt);
-
-        app.NvRead = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                result.data = StdVectorToByteArray(result.data);
-                return result;
-            }
-        }(app.NvRead);
-
-        app.Quote = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                result.rsa_ssa_sig = StdVectorToByteArray(result.rsa_ssa_sig);
-                result.tpm2b_attest = StdVectorToByteArray(result.tpm2b_attest);
-                return result;
-            }
-        }(app.Quote);
-
-
-        app.Unseal = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                result.sensitive_data = StdVectorToByteArray(result.sensitive_data);
-                return result;
-            }
-        }(app.Unseal);
-
-        app.PolicyGetDigest = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                return StdVectorToByteArray(result);
-            }
-        }(app.PolicyGetDigest);
-
-        app.Import = function(wrapped) {
-            return function() {
-                arguments[2] = jQuery.extend(true, [], arguments[2]); // deep-copy integrity_hmac.
-                arguments[2] = StringToStdVector(arguments[2]);
-                arguments[3] = jQuery.extend(true, [], arguments[3]); // deep-copy encrypted_private.
-                arguments[3] = StringToStdVector(arguments[3]);
-                arguments[4] = jQuery.extend(true, [], arguments[4]); // deep-copy encrypted_seed.
-                arguments[4] = StringToStdVector(arguments[4]);
-                const result = wrapped.apply(this, arguments);
-                // Don't change tpm2b types.
-                // result.tpm2b_private = StdVectorToByteArray(result.tpm2b_private);
-                // result.tpm2b_public = StdVectorToByteArray(result.tpm2b_public);
-                return result;
-            }
-        }(app.Import);
-
-        Module.SimGetPcr = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                return StdVectorToByteArray(result);
-            }
-        }(Module.SimGetPcr);
-
-        Module.SimGetEndorsementSeed = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                return StdVectorToByteArray(result);
-            }
-        }(Module.SimGetEndorsementSeed);
-
-        Module.SimGetPlatformSeed = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                return StdVectorToByteArray(result);
-            }
-        }(Module.SimGetPlatformSeed);
-
-        Module.SimGetOwnerSeed = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                return StdVectorToByteArray(result);
-            }
-        }(Module.SimGetOwnerSeed);
-
-        Module.SimGetNullSeed = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                return StdVectorToByteArray(result);
-            }
-        }(Module.SimGetNullSeed);
-
-        Module.UtilUnmarshalAttestBuffer = function(wrapped) {
-            return function() {
-                arguments[0] = jQuery.extend(true, {}, arguments[0]); // deep-copy tpm2b_attest.
-                arguments[0] = ByteArrayToStdVector(arguments[0]);
-                const result = wrapped.apply(this, arguments);
-                result.signer_qualified_name = StdVectorToByteArray(result.signer_qualified_name);
-                result.nonce = StdVectorToByteArray(result.nonce);
-                result.selected_pcr_digest = StdVectorToByteArray(result.selected_pcr_digest);
-                return result;
-            }
-        }(Module.UtilUnmarshalAttestBuffer);
-
-        Module.UtilKDFa = function(wrapped) {
-            return function() {
-                arguments[1] = jQuery.extend(true, [], arguments[1]); // deep-copy key.
-                arguments[1] = StringToStdVector(arguments[1]);
-                //arguments[3] = jQuery.extend(true, [], arguments[3]); // deep-copy context_u.
-                //arguments[3] = StringToStdVector(arguments[3]);
-                arguments[4] = jQuery.extend(true, [], arguments[4]); // deep-copy context_v.
-                arguments[4] = StringToStdVector(arguments[4]);
-                const result = wrapped.apply(this, arguments);
-                return StdVectorToByteArray(result);
-            }
-        }(Module.UtilKDFa);
-
-        // Automatically refresh simulator window after Startup.
-        // This simplifies our code snippets.
-        app.Startup = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                RefreshSimulatorWindow();
-                return result;
-            }
-        }(app.Startup);
-
-        // Automatically refresh simulator window after ExtendPcr.
-        // This simplifies our code snippets.
-        app.ExtendPcr = function(wrapped) {
-            return function() {
-                const result = wrapped.apply(this, arguments);
-                RefreshSimulatorWindow();
-                return result;
-            }
-        }(app.ExtendPcr);
-
-        // Copy simulator functions to sim object for easier access.
-        // sim.XXXX = Module.SimXXXX
-        for (var name in Module) {
-            if (name.startsWith("Sim")) {
-                sim[name.substring(3)] = Module[name];
-            }
-        }
-
-        // Copy util functions to util object for easier access.
-        // util.XXXX = Module.UtilXXXX
-        for (var name in Module) {
-            if (name.startsWith("Util")) {
-                util[name.substring(4)] = Module[name];
-            }
-        }
-
-        //
-        // Run TPM initialization sequence.
-        //
-        console.log("Initializing TPM");
-        sim.PowerOn();
-        sim.ManufactureReset();
-        app.Startup();
-        var properties = app.GetTpmProperties();
-        $("#simulator_version")
-            .text(properties.manufacturer_id + "v" + properties.spec_version)
-        RefreshSimulatorWindow();
-    };
+    OnTpmInitialized();
 })
@@ -0,0 +1,193 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Persists the NV memory of the simulator (sim) in IndexedDB, so that keys,
+// NV indices and hierarchy settings survive reloads. Runs in the TPM worker,
+// which hosts the simulator. NV is saved block by block: a flush writes only
+// the blocks written since the previous one (sim.TakeWrittenNvBlocks), in a
+// single transaction, once the TPM has been idle for NV_STORE_FLUSH_DELAY.
+
+// Name of the IndexedDB database.
+var NV_STORE_DATABASE = "tpm-js";
+
+// Time since the last use of the TPM after which written blocks are flushed,
+// in milliseconds.
+var NV_STORE_FLUSH_DELAY = 1000;
+
+var nv_store = {
+    // Promise of the database, or of null if IndexedDB is not available.
+    db: null,
+    // Whether the NV state of sim is the one to persist, i.e. it is loaded.
+    ready: false,
+    // Indices of the written blocks not saved yet.
+    unsaved: new Set(),
+    // Timer of the scheduled flush.
+    flush_timer: null,
+    // Incremented by NvStoreStart, so that flushes of a previous NV state
+    // that are still in flight neither save nor retry its blocks.
+    generation: 0,
+};
+
+// Returns a promise of the result of an IndexedDB request.
+function NvStoreRequest(request) {
+    return new Promise(function(resolve, reject) {
+        request.onsuccess = function() {
+            resolve(request.result);
+        };
+        request.onerror = function() {
+            reject(request.error);
+        };
+    });
+}
+
+// Returns a promise of the database, opened on the first call, or of null if
+// IndexedDB is not available, e.g. in some private browsing modes.
+function NvStoreOpen() {
+    if (nv_store.db) {
+        return nv_store.db;
+    }
+    if (!self.indexedDB) {
+        nv_store.db = Promise.resolve(null);
+        return nv_store.db;
+    }
+    var request = indexedDB.open(NV_STORE_DATABASE, 1);
+    request.onupgradeneeded = function() {
+        // Block contents by block index.
+        request.result.createObjectStore("nv_blocks");
+        // The NV block size and count the blocks were saved with.
+        request.result.createObjectStore("nv_layout");
+    };
+    nv_store.db = NvStoreRequest(request).catch(function(e) {
+        console.log("IndexedDB not available, NV is not persisted", e);
+        return null;
+    });
+    return nv_store.db;
+}
+
+// Returns a promise of the NV image saved by previous flushes, as a
+// Uint8Array, or of null if none was saved with the NV layout of sim.
+function NvStoreLoad() {
+    return NvStoreOpen().then(function(db) {
+        if (!db) {
+            return null;
+        }
+        var transaction =
+            db.transaction(["nv_blocks", "nv_layout"], "readonly");
+        return Promise.all([
+            NvStoreRequest(transaction.objectStore("nv_layout").get("layout")),
+            // Sorted by block index.
+            NvStoreRequest(transaction.objectStore("nv_blocks").getAll()),
+        ]).then(function(results) {
+            var layout = results[0];
+            var blocks = results[1];
+            if (!layout || layout.block_size != sim.GetNvBlockSize() ||
+                layout.block_count != sim.GetNvBlockCount() ||
+                blocks.length != layout.block_count) {
+                return null;
+            }
+            var size = blocks.reduce(function(size, block) {
+                return size + block.length;
+            }, 0);
+            var image = new Uint8Array(size);
+            var offset = 0;
+            blocks.forEach(function(block) {
+                image.set(block, offset);
+                offset += block.length;
+            });
+            return image;
+        });
+    }).catch(function(e) {
+        console.log("Cannot load NV", e);
+        return null;
+    });
+}
+
+// Starts persisting the NV state of sim, once it is initialized. save_all
+// saves all blocks, e.g. when the state does not come from NvStoreLoad, so
+// that the database holds a complete NV image.
+function NvStoreStart(save_all) {
+    ++nv_store.generation;
+    nv_store.unsaved.clear();
+    if (save_all) {
+        for (var i = 0; i < sim.GetNvBlockCount(); ++i) {
+            nv_store.unsaved.add(i);
+        }
+    }
+    nv_store.ready = true;
+    NvStoreScheduleFlush();
+}
+
+// Flushes the written blocks once the TPM has been idle for
+// NV_STORE_FLUSH_DELAY. Call after using the TPM.
+function NvStoreScheduleFlush() {
+    if (!nv_store.ready) {
+        return;
+    }
+    clearTimeout(nv_store.flush_timer);
+    nv_store.flush_timer = setTimeout(NvStoreFlush, NV_STORE_FLUSH_DELAY);
+}
+
+// Saves the blocks written since the last flush, in one transaction. Blocks
+// of a failed flush are saved by the next one. Transactions commit in the
+// order they are created, so an earlier flush never overwrites the blocks of
+// a later one.
+function NvStoreFlush() {
+    var generation = nv_store.generation;
+    clearTimeout(nv_store.flush_timer);
+    nv_store.flush_timer = null;
+    var written = sim.TakeWrittenNvBlocks();
+    for (var i = 0; i < written.size(); ++i) {
+        nv_store.unsaved.add(written.get(i));
+    }
+    written.delete();
+    if (nv_store.unsaved.size == 0) {
+        return Promise.resolve();
+    }
+    // Read the blocks now: NV may change before the database is open.
+    var blocks = new Map();
+    nv_store.unsaved.forEach(function(index) {
+        blocks.set(index, sim.GetNvBlock(index));
+    });
+    nv_store.unsaved.clear();
+    return NvStoreOpen().then(function(db) {
+        if (!db || generation != nv_store.generation) {
+            return;
+        }
+        var transaction =
+            db.transaction(["nv_blocks", "nv_layout"], "readwrite");
+        var done = new Promise(function(resolve, reject) {
+            transaction.oncomplete = resolve;
+            transaction.onabort = function() {
+                reject(transaction.error);
+            };
+        });
+        blocks.forEach(function(block, index) {
+            transaction.objectStore("nv_blocks").put(block, index);
+        });
+        transaction.objectStore("nv_layout").put({
+            block_size: sim.GetNvBlockSize(),
+            block_count: sim.GetNvBlockCount(),
+        }, "layout");
+        return done;
+    }).catch(function(e) {
+        console.log("Cannot save NV", e);
+        if (generation != nv_store.generation) {
+            return;
+        }
+        blocks.forEach(function(block, index) {
+            nv_store.unsaved.add(index);
+        });
+        NvStoreScheduleFlush();
+    });
+}
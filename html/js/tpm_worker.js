@@ -0,0 +1,301 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Web Worker that hosts the TPM of the page, so that TPM commands do not block
+// it. The app, sim and util objects of main.js forward their calls here.
+//
+// Messages from the page: {id, object, method, args}, where object is "app",
+// "sim" or "util" and method is the name of a function of that object, and
+// {flush_nv: true} when the page may go away.
+//
+// Messages to the page: {id, result} or {id, error} once a call is done,
+// {log: [level, msg]} for each log message, and {fatal: msg} if the module
+// aborts, after which no call is answered.
+//
+// Calls run one at a time, in the order they were posted. Calls posted before
+// the TPM is initialized wait for it.
+
+var Module = {
+    locateFile: function(url) {
+        return "../wasm/" + url;
+    },
+    onAbort: function(what) {
+        postMessage({
+            fatal: String(what)
+        });
+    }
+};
+
+importScripts("consts.js", "bytes.js", "nv_store.js");
+
+var app = null;
+var sim = {};
+var util = {};
+
+// Objects the calls are made on, set once the TPM is initialized.
+var objects = null;
+
+// Calls posted before the TPM is initialized.
+var queued_calls = [];
+
+// Called from the WASM code (src/log.cc).
+function LogMessage(level, msg) {
+    postMessage({
+        log: [level, msg]
+    });
+}
+
+// Byte arguments may be strings, e.g. in Import, or arrays.
+function ToBytes(value) {
+    if (typeof(value) == "string" || value instanceof String) {
+        return StringToStdVector(value);
+    }
+    return ByteArrayToStdVector(value);
+}
+
+// Converts a key returned by CreatePrimary, CreatePrimaryEndorsementKey or
+// Create: public key parameters to BigInt strings, names to arrays. The
+// tpm2b buffers stay as they are, to be passed back to e.g. Load.
+function ConvertKey(key) {
+    key.rsa_public_n = ByteArrayToBigIntStr(key.rsa_public_n);
+    key.ecc_public_x = ByteArrayToBigIntStr(key.ecc_public_x);
+    key.ecc_public_y = ByteArrayToBigIntStr(key.ecc_public_y);
+    for (var name of ["name", "parent_name", "parent_qualified_name"]) {
+        if (key[name] !== undefined) {
+            key[name] = StdVectorToByteArray(key[name]);
+        }
+    }
+    return key;
+}
+
+// Wraps object[name]: convert_args takes and returns the arguments array,
+// convert_result takes and returns the result.
+function Decorate(object, name, convert_args, convert_result) {
+    var wrapped = object[name];
+    object[name] = function() {
+        var args = Array.from(arguments);
+        if (convert_args) {
+            args = convert_args(args);
+        }
+        var result = wrapped.apply(this, args);
+        return convert_result ? convert_result(result) : result;
+    };
+}
+
+// Appends the defaults past the given arguments.
+function DefaultArgs(defaults) {
+    return function(args) {
+        return args.concat(defaults.slice(args.length));
+    };
+}
+
+// Converts the arguments at indices with ToBytes.
+function BytesArgs(indices) {
+    return function(args) {
+        for (var i of indices) {
+            args[i] = ToBytes(args[i]);
+        }
+        return args;
+    };
+}
+
+function ResultField(name) {
+    return function(result) {
+        result[name] = StdVectorToByteArray(result[name]);
+        return result;
+    };
+}
+
+// Changes return types of the WASM functions to simpler, native js types,
+// the ones the code snippets of the page use.
+function DecorateTpmFunctions() {
+    // CreatePrimary(hierarchy, type, restricted, decrypt, sign, unique,
+    //               user_auth, sensitive_data, auth_policy)
+    Decorate(app, "CreatePrimary", DefaultArgs([TPM2_RH_OWNER, TPM2_ALG_RSA,
+        /*restricted=*/ 1, /*decrypt=*/ 1, /*sign=*/ 0, /*unique=*/ "",
+        /*user_auth=*/ "", /*sensitive_data=*/ "", /*auth_policy=*/ []
+    ]), ConvertKey);
+    Decorate(app, "CreatePrimaryEndorsementKey", null, ConvertKey);
+    // Create(parent_handle, type, restricted, decrypt, sign, user_auth,
+    //        sensitive_data, auth_policy)
+    Decorate(app, "Create", DefaultArgs([undefined, TPM2_ALG_RSA,
+        /*restricted=*/ 1, /*decrypt=*/ 0, /*sign=*/ 1, /*user_auth=*/ "",
+        /*sensitive_data=*/ "", /*auth_policy=*/ []
+    ]), ConvertKey);
+    Decorate(app, "Load", null, ResultField("name"));
+    Decorate(app, "GetRandom", null, StdVectorToByteArray);
+    for (var name of ["Encrypt", "Decrypt", "RSAEncrypt", "RSADecrypt"]) {
+        Decorate(app, name, BytesArgs([1]), StdVectorToByteArray);
+    }
+    Decorate(app, "Sign", null, function(result) {
+        result.rsa_ssa_sig = StdVectorToByteArray(result.rsa_ssa_sig);
+        result.ecdsa_r = ByteArrayToBigIntStr(result.ecdsa_r);
+        result.ecdsa_s = ByteArrayToBigIntStr(result.ecdsa_s);
+        return result;
+    });
+    // Takes a result of Sign.
+    Decorate(app, "VerifySignature", function(args) {
+        args[2] = Object.assign({}, args[2], {
+            rsa_ssa_sig: ToBytes(args[2].rsa_ssa_sig),
+            ecdsa_r: ToBytes(BigIntStrToByteArray(args[2].ecdsa_r)),
+            ecdsa_s: ToBytes(BigIntStrToByteArray(args[2].ecdsa_s)),
+        });
+        return args;
+    });
+    Decorate(app, "NvRead", null, ResultField("data"));
+    Decorate(app, "Quote", null, function(result) {
+        result.rsa_ssa_sig = StdVectorToByteArray(result.rsa_ssa_sig);
+        result.tpm2b_attest = StdVectorToByteArray(result.tpm2b_attest);
+        return result;
+    });
+    Decorate(app, "Unseal", null, ResultField("sensitive_data"));
+    Decorate(app, "PolicyGetDigest", null, StdVectorToByteArray);
+    // Import(parent_handle, public_area, integrity_hmac, encrypted_private,
+    //        encrypted_seed)
+    Decorate(app, "Import", BytesArgs([2, 3, 4]));
+
+    for (var name of ["GetPcr", "GetEndorsementSeed", "GetPlatformSeed",
+            "GetOwnerSeed", "GetNullSeed"
+        ]) {
+        Decorate(sim, name, null, StdVectorToByteArray);
+    }
+
+    Decorate(util, "UnmarshalAttestBuffer", BytesArgs([0]), function(result) {
+        result.signer_qualified_name =
+            StdVectorToByteArray(result.signer_qualified_name);
+        result.nonce = StdVectorToByteArray(result.nonce);
+        result.selected_pcr_digest =
+            StdVectorToByteArray(result.selected_pcr_digest);
+        return result;
+    });
+    // KDFa(hash_alg, key, label, context_u, context_v, bits)
+    Decorate(util, "KDFa", BytesArgs([1, 4]), StdVectorToByteArray);
+}
+
+// Adds the buffers of the Uint8Arrays in value to transfer, and converts
+// other vectors to arrays.
+function FromWasm(value, transfer) {
+    if (ArrayBuffer.isView(value)) {
+        transfer.push(value.buffer);
+        return value;
+    }
+    if (value !== null && typeof(value) == "object" &&
+        typeof(value.size) == "function" && typeof(value.get) == "function") {
+        var elements = [];
+        for (var i = 0; i < value.size(); i++) {
+            elements.push(FromWasm(value.get(i), transfer));
+        }
+        value.delete();
+        return elements;
+    }
+    if (value !== null && typeof(value) == "object") {
+        for (var name in value) {
+            value[name] = FromWasm(value[name], transfer);
+        }
+    }
+    return value;
+}
+
+function Call(call) {
+    try {
+        var object = objects[call.object];
+        if (object === undefined || typeof(object[call.method]) != "function") {
+            throw new Error("Unknown function " + call.object + "." + call.method);
+        }
+        var transfer = [];
+        var result = FromWasm(object[call.method].apply(object, call.args),
+                              transfer);
+        postMessage({
+            id: call.id,
+            result: result
+        }, transfer);
+    } catch (e) {
+        postMessage({
+            id: call.id,
+            error: e instanceof Error ? e.message : String(e)
+        });
+    }
+    NvStoreScheduleFlush();
+}
+
+onmessage = function(event) {
+    if (event.data.flush_nv) {
+        // Do not wait for the TPM to be idle when the page may go away.
+        if (nv_store.flush_timer) {
+            NvStoreFlush();
+        }
+    } else if (objects === null) {
+        queued_calls.push(event.data);
+    } else {
+        Call(event.data);
+    }
+};
+
+// Runs the TPM initialization sequence, once the NV state saved by a previous
+// visit (nv_store.js) is loaded, then runs the queued calls.
+function InitializeTpm() {
+    return NvStoreLoad().then(function(nv) {
+        console.log("Initializing TPM");
+        if (nv && sim.RestoreNv(nv)) {
+            // The restored blocks are saved already.
+            sim.TakeWrittenNvBlocks().delete();
+            sim.PowerOn();
+            if (app.Startup() == 0) {
+                NvStoreStart(false);
+                return;
+            }
+            console.log("Saved NV state does not start, discarding it");
+            sim.PowerOff();
+            // Drop what the failed start wrote: the snapshot below replaces
+            // all of NV, and NvStoreStart saves all of it.
+            sim.TakeWrittenNvBlocks().delete();
+            clearTimeout(nv_store.flush_timer);
+            nv_store.flush_timer = null;
+            nv_store.unsaved.clear();
+        }
+        // Restore the TPM manufactured at build time
+        // (src/snapshot_builder.cc), which is much faster than manufacturing
+        // it.
+        var restored = sim.RestoreBuiltInSnapshot();
+        sim.PowerOn();
+        if (!restored) {
+            sim.ManufactureReset();
+        }
+        app.Startup();
+        NvStoreStart(true);
+    }).then(function() {
+        objects = {
+            app: app,
+            sim: sim,
+            util: util
+        };
+        queued_calls.forEach(Call);
+        queued_calls = [];
+    });
+}
+
+Module.onRuntimeInitialized = function() {
+    app = new Module.App();
+    for (var name in Module) {
+        if (name.startsWith("Sim")) {
+            sim[name.substring(3)] = Module[name];
+        } else if (name.startsWith("Util")) {
+            util[name.substring(4)] = Module[name];
+        }
+    }
+    DecorateTpmFunctions();
+    InitializeTpm();
+};
+
+importScripts("../wasm/bindings.js");
@@ -14,6 +14,7 @@
 
 #include "app.h"
 
+#include <algorithm>
 #include <cassert>
 #include <endian.h>
 #include <string.h>
@@ -237,7 +238,9 @@ TPM2B_PUBLIC GetPublicSYM(int restricted, int decrypt, int sign,
 
   in_public.publicArea.parameters.symDetail.sym.algorithm = TPM2_ALG_AES;
   in_public.publicArea.parameters.symDetail.sym.keyBits.sym = 128;
-  in_public.publicArea.parameters.symDetail.sym.mode.sym = TPM2_ALG_CFB;
+  // Unrestricted keys leave the mode to each EncryptDecrypt2 command.
+  in_public.publicArea.parameters.symDetail.sym.mode.sym =
+      (restricted ? TPM2_ALG_CFB : TPM2_ALG_NULL);
 
   in_public.publicArea.unique.sym.size = 0;
   if (unique) {
@@ -284,7 +287,14 @@ TPM2B_PUBLIC GetPublicHASH(int restricted, int decrypt, int sign,
   memcpy(in_public.publicArea.authPolicy.buffer, auth_policy.data(),
          auth_policy.size());
 
-  if (sign) {
+  // A signing key is an HMAC key. A key that both signs and decrypts has no
+  // default scheme.
+  if (sign && !decrypt) {
+    in_public.publicArea.parameters.keyedHashDetail.scheme.scheme =
+        TPM2_ALG_HMAC;
+    in_public.publicArea.parameters.keyedHashDetail.scheme.details.hmac
+        .hashAlg = TPM2_ALG_SHA256;
+  } else if (decrypt && !sign) {
     in_public.publicArea.parameters.keyedHashDetail.scheme.scheme =
         TPM2_ALG_XOR;
     in_public.publicArea.parameters.keyedHashDetail.scheme.details.exclusiveOr
@@ -321,7 +331,7 @@ TPMA_NV BuildNvSpaceAttributes() {
   attributes |= TPMA_NV_AUTHREAD;
   // REQUIRED: Disable dictionary attack protection.
   attributes |= TPMA_NV_NO_DA;
-  // OPTIONAL: Ownder readable.
+  // OPTIONAL: Owner readable.
   attributes |= TPMA_NV_OWNERREAD;
   // OPTIONAL: Readable under platform auth.
   attributes |= TPMA_NV_PPREAD;
@@ -362,8 +372,13 @@ App *App::Get() {
 }
 
 App::App()
-    : tss_(&Simulator::ExecuteCommand), sessions_data_({}),
-      sessions_data_out_({}) {
+    : resource_manager_(&Simulator::ExecuteCommand),
+      tss_([this](const std::vector<uint8_t> &command) {
+        return resource_manager_.ExecuteCommand(command);
+      }),
+      sessions_data_({}), sessions_data_out_({}), nv_buffer_max_(0) {
+  tss_.EnableResponseCache(&Simulator::GetStateGeneration);
+  tss_.EnableNvCommitDeferral(&Simulator::SetNvCommitDeferred);
   ClearSessionData();
 }
 
@@ -386,7 +401,11 @@ void App::ClearSessionData() {
 
 int App::Startup() {
   LOG1("Startup\n");
-  return Tss2_Sys_Startup(tss_.GetSysContext(), TPM2_SU_CLEAR);
+  TPM2_RC rc = Tss2_Sys_Startup(tss_.GetSysContext(), TPM2_SU_CLEAR);
+  if (rc == TPM2_RC_SUCCESS) {
+    event_log_.Clear();
+  }
+  return rc;
 }
 
 int App::Shutdown() {
@@ -412,9 +431,20 @@ int App::ExtendPcr(int pcr, const std::string &str) {
   memcpy(digests.digests[0].digest.sha256, message.buffer, message.size);
   TPM2_RC rc = Tss2_Sys_PCR_Extend(tss_.GetSysContext(), pcr, &sessions_data_,
                                    &digests, /*rspAuthsArray=*/nullptr);
+  if (rc == TPM2_RC_SUCCESS) {
+    event_log_.Append(pcr, kEventIpl,
+                      std::vector<uint8_t>(message.buffer,
+                                           message.buffer + message.size),
+                      std::vector<uint8_t>(str.begin(), str.end()));
+  }
   return rc;
 }
 
+std::vector<uint8_t> App::GetEventLog() {
+  LOG1("GetEventLog\n");
+  return event_log_.Serialize();
+}
+
 std::vector<uint8_t> App::GetRandom(int num_bytes) {
   LOG1("GetRandom\n");
   TPM2B_DIGEST random_bytes = {
@@ -428,6 +458,43 @@ std::vector<uint8_t> App::GetRandom(int num_bytes) {
                               random_bytes.buffer + random_bytes.size);
 }
 
+int App::GetRandomStream(uint8_t *buffer, size_t num_bytes,
+                         size_t *num_generated) {
+  LOG1("GetRandomStream %zu\n", num_bytes);
+  *num_generated = 0;
+  while (*num_generated < num_bytes) {
+    // TPM2_GetRandom never returns more than a digest worth of bytes.
+    const UINT16 chunk_size = static_cast<UINT16>(
+        std::min(num_bytes - *num_generated, sizeof(TPMU_HA)));
+    TPM2B_DIGEST random_bytes = {
+        TPM2BStructSize<TPM2B_DIGEST>(),
+    };
+    TPM2_RC rc =
+        Tss2_Sys_GetRandom(tss_.GetSysContext(), /*cmdAuthsArray=*/nullptr,
+                           chunk_size, &random_bytes,
+                           /*rspAuthsArray=*/nullptr);
+    if (rc != TPM2_RC_SUCCESS) {
+      return rc;
+    }
+    if (random_bytes.size == 0 || random_bytes.size > chunk_size) {
+      return TPM2_RC_FAILURE;
+    }
+    memcpy(buffer + *num_generated, random_bytes.buffer, random_bytes.size);
+    *num_generated += random_bytes.size;
+  }
+  return TPM2_RC_SUCCESS;
+}
+
+GetRandomStreamResult App::GetRandomStream(size_t num_bytes) {
+  GetRandomStreamResult result = {};
+  result.random_bytes.resize(num_bytes);
+  size_t num_generated;
+  result.rc =
+      GetRandomStream(result.random_bytes.data(), num_bytes, &num_generated);
+  result.random_bytes.resize(num_generated);
+  return result;
+}
+
 int App::SelfTest() {
   LOG1("SelfTest\n");
   TPM2_RC rc =
@@ -465,6 +532,22 @@ TPMS_CAPABILITY_DATA App::GetCapability(TPM2_CAP capability, UINT32 property) {
   return capability_data;
 }
 
+size_t App::GetNvBufferMax() {
+  // A fixed property of the TPM, fetched once.
+  if (nv_buffer_max_ != 0) {
+    return nv_buffer_max_;
+  }
+  TPMS_CAPABILITY_DATA capability_data =
+      GetCapability(TPM2_CAP_TPM_PROPERTIES, TPM2_PT_NV_BUFFER_MAX);
+  assert(capability_data.data.tpmProperties.count == 1);
+  assert(capability_data.data.tpmProperties.tpmProperty[0].property ==
+         TPM2_PT_NV_BUFFER_MAX);
+  nv_buffer_max_ = std::min<size_t>(
+      capability_data.data.tpmProperties.tpmProperty[0].value,
+      TPM2_MAX_NV_BUFFER_SIZE);
+  return nv_buffer_max_;
+}
+
 int App::TestHashParam(int hash_algo) {
   LOG1("TestHashParam %d\n", hash_algo);
   TPMT_PUBLIC_PARMS params = {};
@@ -750,6 +833,73 @@ SignResult App::Sign(uint32_t key_handle, int type, const std::string &str) {
   return result;
 }
 
+SignManyResult App::SignMany(uint32_t key_handle, int type,
+                             const std::vector<uint8_t> &digests) {
+  LOG1("SignMany %x %zu\n", key_handle, digests.size());
+  assert((type == TPM2_ALG_RSA) || (type == TPM2_ALG_ECC));
+  assert(digests.size() % TPM2_SHA256_DIGEST_SIZE == 0);
+
+  TPMT_SIG_SCHEME scheme = {};
+  if (type == TPM2_ALG_RSA) {
+    scheme.scheme = TPM2_ALG_RSASSA;
+    scheme.details.rsassa.hashAlg = TPM2_ALG_SHA256;
+  } else { /* type == TPM2_ALG_ECC */
+    scheme.scheme = TPM2_ALG_ECDSA;
+    scheme.details.ecdsa.hashAlg = TPM2_ALG_SHA256;
+  }
+
+  TPMT_TK_HASHCHECK validation = {};
+  validation.tag = TPM2_ST_HASHCHECK;
+  validation.hierarchy = TPM2_RH_NULL;
+  validation.digest.size = 0;
+
+  SignManyResult result = {};
+  result.rc = TPM2_RC_SUCCESS;
+  const size_t num_digests = digests.size() / TPM2_SHA256_DIGEST_SIZE;
+  TPM2B_DIGEST message = {};
+  message.size = TPM2_SHA256_DIGEST_SIZE;
+  TPMT_SIGNATURE signature = {};
+  for (size_t i = 0; i < num_digests; ++i) {
+    memcpy(message.buffer, digests.data() + i * TPM2_SHA256_DIGEST_SIZE,
+           TPM2_SHA256_DIGEST_SIZE);
+    result.rc =
+        Tss2_Sys_Sign(tss_.GetSysContext(), key_handle, &sessions_data_,
+                      &message, &scheme, &validation, &signature,
+                      &sessions_data_out_);
+    if (result.rc != TPM2_RC_SUCCESS) {
+      break;
+    }
+    if (i == 0) {
+      result.sign_algo = signature.sigAlg;
+      if (type == TPM2_ALG_RSA) {
+        result.hash_algo = signature.signature.rsassa.hash;
+        result.signature_size = signature.signature.rsassa.sig.size;
+      } else { /* type == TPM2_ALG_ECC */
+        result.hash_algo = signature.signature.ecdsa.hash;
+        result.signature_size = signature.signature.ecdsa.signatureR.size +
+                                signature.signature.ecdsa.signatureS.size;
+      }
+      result.signatures.reserve(num_digests * result.signature_size);
+    }
+    if (type == TPM2_ALG_RSA) {
+      const TPM2B_PUBLIC_KEY_RSA &sig = signature.signature.rsassa.sig;
+      result.signatures.insert(result.signatures.end(), sig.buffer,
+                               sig.buffer + sig.size);
+    } else { /* type == TPM2_ALG_ECC */
+      // The TPM pads r and s to the size of the curve order, so every
+      // signature has the same size.
+      const TPM2B_ECC_PARAMETER &r = signature.signature.ecdsa.signatureR;
+      const TPM2B_ECC_PARAMETER &s = signature.signature.ecdsa.signatureS;
+      result.signatures.insert(result.signatures.end(), r.buffer,
+                               r.buffer + r.size);
+      result.signatures.insert(result.signatures.end(), s.buffer,
+                               s.buffer + s.size);
+    }
+    ++result.count;
+  }
+  return result;
+}
+
 int App::VerifySignature(uint32_t key_handle, const std::string &str,
                          const SignResult &in_signature) {
   LOG1("VerifySignature %x '%s'\n", key_handle, str.c_str());
@@ -792,31 +942,123 @@ std::vector<uint8_t> App::Decrypt(uint32_t key_handle,
 std::vector<uint8_t> App::EncryptDecrypt(uint32_t key_handle,
                                          const std::vector<uint8_t> &message,
                                          bool decrypt) {
-  TPM2B_IV iv_in = {
-      .size = TPM2BStructSize<TPM2B_IV>(),
-  };
+  std::vector<uint8_t> iv(TPM2BStructSize<TPM2B_IV>(), 0);
+  std::vector<uint8_t> output(message.size());
+  TPM2_RC rc =
+      EncryptDecryptStream(key_handle, TPM2_ALG_CFB, decrypt, &iv,
+                           message.data(), message.size(), output.data());
+  assert(rc == TPM2_RC_SUCCESS);
+  return output;
+}
 
-  TPM2B_IV iv_out = {
-      .size = TPM2BStructSize<TPM2B_IV>(),
-  };
+int App::EncryptDecryptStream(uint32_t key_handle, int mode, bool decrypt,
+                              std::vector<uint8_t> *iv, const uint8_t *in,
+                              size_t size, uint8_t *out) {
+  LOG1("EncryptDecryptStream %x %x %zu\n", key_handle, mode, size);
+  assert((mode == TPM2_ALG_CFB) || (mode == TPM2_ALG_CTR));
+
+  TPM2B_IV iv_in = {};
+  assert(iv->size() <= sizeof(iv_in.buffer));
+  iv_in.size = iv->size();
+  memcpy(iv_in.buffer, iv->data(), iv->size());
 
   TPM2B_MAX_BUFFER data_in = {};
-  data_in.size = message.size();
-  assert(message.size() <= sizeof(data_in.buffer));
-  memcpy(data_in.buffer, message.data(), message.size());
+  // Chunks are a multiple of the block size, so the IV chains through partial
+  // blocks only at the end of the stream.
+  static_assert(sizeof(data_in.buffer) % TPM2_MAX_SYM_BLOCK_SIZE == 0,
+                "chunks must be a multiple of the block size");
+  TPM2_RC rc = TPM2_RC_SUCCESS;
+  for (size_t offset = 0; offset < size; offset += data_in.size) {
+    data_in.size = std::min(size - offset, sizeof(data_in.buffer));
+    memcpy(data_in.buffer, in + offset, data_in.size);
+
+    TPM2B_MAX_BUFFER data_out = {
+        .size = TPM2BStructSize<TPM2B_MAX_BUFFER>(),
+    };
+    TPM2B_IV iv_out = {
+        .size = TPM2BStructSize<TPM2B_IV>(),
+    };
+    rc = Tss2_Sys_EncryptDecrypt2(
+        tss_.GetSysContext(), key_handle, &sessions_data_, &data_in,
+        (decrypt ? TPM2_YES : TPM2_NO), mode, &iv_in, &data_out, &iv_out,
+        &sessions_data_out_);
+    if (rc != TPM2_RC_SUCCESS) {
+      return rc;
+    }
+    assert(data_out.size == data_in.size);
+    memcpy(out + offset, data_out.buffer, data_out.size);
+    iv_in = iv_out;
+  }
+  iv->assign(iv_in.buffer, iv_in.buffer + iv_in.size);
+  return rc;
+}
 
-  TPM2B_MAX_BUFFER data_out = {
-      .size = TPM2BStructSize<TPM2B_MAX_BUFFER>(),
-  };
+SequenceStartResult App::HashSequenceStart() {
+  LOG1("HashSequenceStart\n");
+  TPM2B_AUTH auth = {};
+  SequenceStartResult result = {};
+  result.rc = Tss2_Sys_HashSequenceStart(
+      tss_.GetSysContext(), /*cmdAuthsArray=*/nullptr, &auth, TPM2_ALG_SHA256,
+      &result.handle, /*rspAuthsArray=*/nullptr);
+  return result;
+}
 
-  TPM2_RC rc =
-      Tss2_Sys_EncryptDecrypt(tss_.GetSysContext(), key_handle, &sessions_data_,
-                              (decrypt ? TPM2_YES : TPM2_NO),
-                              /*mode=*/TPM2_ALG_NULL, &iv_in, &data_in,
-                              &data_out, &iv_out, &sessions_data_out_);
-  assert(rc == TPM2_RC_SUCCESS);
+SequenceStartResult App::HmacStart(uint32_t key_handle) {
+  LOG1("HmacStart %x\n", key_handle);
+  TPM2B_AUTH auth = {};
+  SequenceStartResult result = {};
+  result.rc = Tss2_Sys_HMAC_Start(tss_.GetSysContext(), key_handle,
+                                  &sessions_data_, &auth, TPM2_ALG_NULL,
+                                  &result.handle, &sessions_data_out_);
+  return result;
+}
 
-  return std::vector<uint8_t>(data_out.buffer, data_out.buffer + data_out.size);
+int App::SequenceUpdate(uint32_t sequence_handle, const uint8_t *data,
+                        size_t size) {
+  LOG1("SequenceUpdate %x %zu\n", sequence_handle, size);
+  TPM2B_MAX_BUFFER buffer = {};
+  for (size_t offset = 0; offset < size; offset += buffer.size) {
+    buffer.size = std::min(size - offset, sizeof(buffer.buffer));
+    memcpy(buffer.buffer, data + offset, buffer.size);
+    TPM2_RC rc =
+        Tss2_Sys_SequenceUpdate(tss_.GetSysContext(), sequence_handle,
+                                &sessions_data_, &buffer, &sessions_data_out_);
+    if (rc != TPM2_RC_SUCCESS) {
+      return rc;
+    }
+  }
+  return TPM2_RC_SUCCESS;
+}
+
+SequenceCompleteResult App::SequenceComplete(uint32_t sequence_handle,
+                                             const uint8_t *data,
+                                             size_t size) {
+  LOG1("SequenceComplete %x %zu\n", sequence_handle, size);
+  TPM2B_MAX_BUFFER buffer = {};
+  // Size of the chunks sent before the last one.
+  const size_t head_size =
+      size > sizeof(buffer.buffer)
+          ? (size - 1) / sizeof(buffer.buffer) * sizeof(buffer.buffer)
+          : 0;
+  SequenceCompleteResult result = {};
+  result.rc = SequenceUpdate(sequence_handle, data, head_size);
+  if (result.rc != TPM2_RC_SUCCESS) {
+    return result;
+  }
+  buffer.size = size - head_size;
+  memcpy(buffer.buffer, data + head_size, buffer.size);
+
+  TPM2B_DIGEST digest = {
+      .size = TPM2BStructSize<TPM2B_DIGEST>(),
+  };
+  TPMT_TK_HASHCHECK validation = {};
+  result.rc = Tss2_Sys_SequenceComplete(
+      tss_.GetSysContext(), sequence_handle, &sessions_data_, &buffer,
+      TPM2_RH_NULL, &digest, &validation, &sessions_data_out_);
+  if (result.rc == TPM2_RC_SUCCESS) {
+    result.result.assign(digest.buffer, digest.buffer + digest.size);
+  }
+  return result;
 }
 
 std::vector<uint8_t> App::RSAEncrypt(uint32_t key_handle,
@@ -881,13 +1123,18 @@ int App::EvictControl(uint32_t auth, uint32_t key_handle,
 }
 
 int App::NvDefineSpace(uint32_t nv_index, size_t data_size) {
-  LOG1("NvDefineSpace %x %x\n", nv_index, data_size);
+  return NvDefineSpace(nv_index, data_size, BuildNvSpaceAttributes());
+}
+
+int App::NvDefineSpace(uint32_t nv_index, size_t data_size,
+                       uint32_t attributes) {
+  LOG1("NvDefineSpace %x %zu %x\n", nv_index, data_size, attributes);
   TPM2B_AUTH auth = {};
   TPM2B_NV_PUBLIC public_info = {};
   public_info.size = sizeof(TPMS_NV_PUBLIC);
   public_info.nvPublic.nvIndex = nv_index;
   public_info.nvPublic.nameAlg = TPM2_ALG_SHA256;
-  public_info.nvPublic.attributes = BuildNvSpaceAttributes();
+  public_info.nvPublic.attributes = attributes;
   public_info.nvPublic.authPolicy.size = 0;
   public_info.nvPublic.dataSize = data_size;
   return Tss2_Sys_NV_DefineSpace(tss_.GetSysContext(),
@@ -898,15 +1145,32 @@ int App::NvDefineSpace(uint32_t nv_index, size_t data_size) {
 
 int App::NvWrite(uint32_t nv_index, const std::vector<uint8_t> &data) {
   LOG1("NvWrite %x %x\n", nv_index, data.size());
-  TPM2B_MAX_NV_BUFFER buffer = {};
-  assert(data.size() <= TPM2_MAX_NV_BUFFER_SIZE);
-  buffer.size = data.size();
-  memcpy(buffer.buffer, data.data(), data.size());
+  return NvWriteStream(nv_index, data.data(), data.size(), /*offset=*/0);
+}
 
-  return Tss2_Sys_NV_Write(tss_.GetSysContext(),
+int App::NvWriteStream(uint32_t nv_index, const uint8_t *data, size_t size,
+                       size_t offset) {
+  LOG1("NvWriteStream %x %zu %zu\n", nv_index, size, offset);
+  const size_t chunk_size = GetNvBufferMax();
+  TPM2B_MAX_NV_BUFFER buffer = {};
+  // Coalesce the NV commits of all chunks into one.
+  TPM2_RC rc = tss_.DeferNvCommits(true);
+  if (rc != TSS2_RC_SUCCESS) {
+    return rc;
+  }
+  size_t done = 0;
+  // An empty write is still sent, as it sets TPMA_NV_WRITTEN.
+  do {
+    buffer.size = std::min(size - done, chunk_size);
+    memcpy(buffer.buffer, data + done, buffer.size);
+    rc = Tss2_Sys_NV_Write(tss_.GetSysContext(),
                            /*authHandle=*/TPM2_RH_PLATFORM, nv_index,
-                           &sessions_data_, &buffer,
-                           /*offset=*/0, &sessions_data_out_);
+                           &sessions_data_, &buffer, offset + done,
+                           &sessions_data_out_);
+    done += buffer.size;
+  } while (rc == TPM2_RC_SUCCESS && done < size);
+  const TPM2_RC commit_rc = tss_.DeferNvCommits(false);
+  return rc != TPM2_RC_SUCCESS ? rc : commit_rc;
 }
 
 NvReadPublicResult App::NvReadPublic(uint32_t nv_index) {
@@ -943,6 +1207,38 @@ NvReadResult App::NvRead(uint32_t nv_index, int size, int offset) {
   return result;
 }
 
+int App::NvReadStream(uint32_t nv_index, uint8_t *buffer, size_t size,
+                      size_t offset) {
+  LOG1("NvReadStream %x %zu %zu\n", nv_index, size, offset);
+  const size_t chunk_size = GetNvBufferMax();
+  for (size_t done = 0; done < size;) {
+    TPM2B_MAX_NV_BUFFER data = {
+        .size = TPM2BStructSize<TPM2B_MAX_NV_BUFFER>(),
+    };
+    TPM2_RC rc = Tss2_Sys_NV_Read(
+        tss_.GetSysContext(), TPM2_RH_PLATFORM, nv_index, &sessions_data_,
+        std::min(size - done, chunk_size), offset + done, &data,
+        &sessions_data_out_);
+    if (rc != TPM2_RC_SUCCESS) {
+      return rc;
+    }
+    assert(data.size > 0 && data.size <= size - done);
+    memcpy(buffer + done, data.buffer, data.size);
+    done += data.size;
+  }
+  return TPM2_RC_SUCCESS;
+}
+
+NvReadResult App::NvReadStream(uint32_t nv_index, size_t size, size_t offset) {
+  NvReadResult result;
+  result.data.resize(size);
+  result.rc = NvReadStream(nv_index, result.data.data(), size, offset);
+  if (result.rc != TPM2_RC_SUCCESS) {
+    result.data.clear();
+  }
+  return result;
+}
+
 QuoteResult App::Quote(uint32_t key_handle, const std::string &nonce) {
   LOG1("Quote %x '%s'\n", key_handle, nonce.c_str());
   TPM2B_DATA qualifying_data = {};
@@ -988,6 +1284,16 @@ QuoteResult App::Quote(uint32_t key_handle, const std::string &nonce) {
           std::vector<uint8_t>(signature.signature.rsassa.sig.buffer,
                                signature.signature.rsassa.sig.buffer +
                                    signature.signature.rsassa.sig.size);
+    } else if (signature.sigAlg == TPM2_ALG_ECDSA) {
+      result.hash_algo = signature.signature.ecdsa.hash;
+      result.ecdsa_r =
+          std::vector<uint8_t>(signature.signature.ecdsa.signatureR.buffer,
+                               signature.signature.ecdsa.signatureR.buffer +
+                                   signature.signature.ecdsa.signatureR.size);
+      result.ecdsa_s =
+          std::vector<uint8_t>(signature.signature.ecdsa.signatureS.buffer,
+                               signature.signature.ecdsa.signatureS.buffer +
+                                   signature.signature.ecdsa.signatureS.size);
     }
     result.tpm2b_attest = std::vector<uint8_t>(
         quoted.attestationData, quoted.attestationData + quoted.size);
@@ -1194,4 +1500,82 @@ ImportResult App::Import(uint32_t parent_handle,
   return result;
 } // namespace tpm_js
 
+BatchResult App::ExecuteBatch(const std::vector<BatchOperation> &operations) {
+  LOG1("ExecuteBatch %zu\n", operations.size());
+  BatchResult result;
+  result.rc.reserve(operations.size());
+  result.output_size.reserve(operations.size());
+
+  // Command and response structures shared by all operations. Outputs go
+  // straight to result.output, with no result object per operation.
+  TPMT_SIG_SCHEME scheme = {};
+  TPMT_TK_HASHCHECK validation = {};
+  validation.tag = TPM2_ST_HASHCHECK;
+  validation.hierarchy = TPM2_RH_NULL;
+  validation.digest.size = 0;
+  TPMT_SIGNATURE signature = {};
+  TPM2B_MAX_NV_BUFFER nv_data = {};
+
+  for (const BatchOperation &operation : operations) {
+    const size_t output_begin = result.output.size();
+    // Operations come from JavaScript unchecked. Invalid ones fail on their
+    // own instead of reaching the asserts of the App functions.
+    int rc = TSS2_SYS_RC_BAD_VALUE;
+    switch (operation.type) {
+    case kBatchExtendPcr:
+      rc = ExtendPcr(operation.handle, operation.data);
+      break;
+    case kBatchSign: {
+      if (operation.param == TPM2_ALG_RSA) {
+        scheme.scheme = TPM2_ALG_RSASSA;
+        scheme.details.rsassa.hashAlg = TPM2_ALG_SHA256;
+      } else if (operation.param == TPM2_ALG_ECC) {
+        scheme.scheme = TPM2_ALG_ECDSA;
+        scheme.details.ecdsa.hashAlg = TPM2_ALG_SHA256;
+      } else {
+        break;
+      }
+      TPM2B_DIGEST message = HashString(operation.data, EVP_sha256());
+      rc = Tss2_Sys_Sign(tss_.GetSysContext(), operation.handle,
+                         &sessions_data_, &message, &scheme, &validation,
+                         &signature, &sessions_data_out_);
+      if (rc != TPM2_RC_SUCCESS) {
+        break;
+      }
+      if (operation.param == TPM2_ALG_RSA) {
+        const TPM2B_PUBLIC_KEY_RSA &sig = signature.signature.rsassa.sig;
+        result.output.insert(result.output.end(), sig.buffer,
+                             sig.buffer + sig.size);
+      } else { /* operation.param == TPM2_ALG_ECC */
+        const TPM2B_ECC_PARAMETER &r = signature.signature.ecdsa.signatureR;
+        const TPM2B_ECC_PARAMETER &s = signature.signature.ecdsa.signatureS;
+        result.output.insert(result.output.end(), r.buffer, r.buffer + r.size);
+        result.output.insert(result.output.end(), s.buffer, s.buffer + s.size);
+      }
+      break;
+    }
+    case kBatchNvRead:
+      if (operation.param < 0 || operation.param > UINT16_MAX ||
+          operation.offset < 0 || operation.offset > UINT16_MAX) {
+        break;
+      }
+      nv_data.size = TPM2BStructSize<TPM2B_MAX_NV_BUFFER>();
+      rc = Tss2_Sys_NV_Read(tss_.GetSysContext(), TPM2_RH_PLATFORM,
+                            operation.handle, &sessions_data_, operation.param,
+                            operation.offset, &nv_data, &sessions_data_out_);
+      if (rc == TPM2_RC_SUCCESS) {
+        result.output.insert(result.output.end(), nv_data.buffer,
+                             nv_data.buffer + nv_data.size);
+      }
+      break;
+    default:
+      // Unknown operation type.
+      break;
+    }
+    result.rc.push_back(rc);
+    result.output_size.push_back(result.output.size() - output_begin);
+  }
+  return result;
+}
+
 } // namespace tpm_js
@@ -18,6 +18,8 @@
 
 #include <string>
 
+#include "event_log.h"
+#include "resource_manager.h"
 #include "tss_adapter.h"
 
 namespace tpm_js {
@@ -87,6 +89,27 @@ struct SignResult {
   std::vector<uint8_t> ecdsa_s;
 };
 
+struct SignManyResult {
+  int rc;
+  // Number of digests that were signed. Signing stops at the first failure.
+  int count;
+  // Following fields are only valid if count > 0.
+  int sign_algo;
+  int hash_algo;
+  // Size of each signature in signatures.
+  int signature_size;
+  // Signatures of the digests, back to back. An RSASSA signature, or ECDSA r
+  // followed by s, each padded to the size of the curve order.
+  std::vector<uint8_t> signatures;
+};
+
+struct GetRandomStreamResult {
+  int rc;
+  // Random bytes generated before rc was returned, so fewer than requested
+  // unless rc == TPM2_RC_SUCCESS.
+  std::vector<uint8_t> random_bytes;
+};
+
 struct NvReadPublicResult {
   int rc;
   int data_size;
@@ -104,6 +127,9 @@ struct QuoteResult {
   int hash_algo;
   // RSA signature. Valid only if sign_algo == TPM2_ALG_RSASSA.
   std::vector<uint8_t> rsa_ssa_sig;
+  // ECDSA signature. Valid only if sign_algo == TPM2_ALG_ECDSA.
+  std::vector<uint8_t> ecdsa_r;
+  std::vector<uint8_t> ecdsa_s;
   // Wire representation of TPMS_ATTEST structure.
   // The signature is over this buffer.
   std::vector<uint8_t> tpm2b_attest;
@@ -131,12 +157,59 @@ struct ImportResult {
   std::vector<uint8_t> tpm2b_public;
 };
 
+struct SequenceStartResult {
+  int rc;
+  // Following fields are only valid if rc == TPM2_RC_SUCCESS.
+  uint32_t handle;
+};
+
+struct SequenceCompleteResult {
+  int rc;
+  // Following fields are only valid if rc == TPM2_RC_SUCCESS.
+  // SHA256 digest or HMAC of all bytes fed to the sequence.
+  std::vector<uint8_t> result;
+};
+
+// Operation types of BatchOperation.
+enum BatchOperationType {
+  // ExtendPcr(handle, data).
+  kBatchExtendPcr,
+  // Sign(handle, param, data).
+  kBatchSign,
+  // NvRead(handle, param, offset).
+  kBatchNvRead,
+};
+
+struct BatchOperation {
+  BatchOperationType type;
+  // PCR index, key handle or NV index.
+  uint32_t handle;
+  // Key type for kBatchSign, number of bytes to read for kBatchNvRead.
+  int param;
+  // Offset to read from for kBatchNvRead.
+  int offset;
+  // String to extend or sign for kBatchExtendPcr and kBatchSign.
+  std::string data;
+};
+
+struct BatchResult {
+  // rc of each operation, in the order of the operations.
+  std::vector<int> rc;
+  // Number of bytes each operation added to output.
+  std::vector<int> output_size;
+  // Outputs of the operations, back to back. Operations that failed or have
+  // no output add no bytes. kBatchSign adds the RSASSA signature, or ECDSA r
+  // followed by s, each half of the output. kBatchNvRead adds the data read.
+  std::vector<uint8_t> output;
+};
+
 class App {
 public:
   static App *Get();
   ~App();
 
-  // Calls Tss2_Sys_Startup with TPM2_SU_CLEAR.
+  // Calls Tss2_Sys_Startup with TPM2_SU_CLEAR. Clears the event log, as the
+  // PCRs are reset.
   int Startup();
 
   // Calls Tss2_Sys_Shutdown with TPM2_SU_CLEAR.
@@ -145,12 +218,27 @@ public:
   // Calls Tss2_Sys_Clear with TPM2_RH_PLATFORM.
   int Clear();
 
-  // Calls Tss2_Sys_PCR_Extend with the SHA256 digest of str.
+  // Calls Tss2_Sys_PCR_Extend with the SHA256 digest of str, and records the
+  // extend in the event log as a kEventIpl event with str as event data.
   int ExtendPcr(int pcr, const std::string &str);
 
+  // Returns the event log of the extends since Startup, in the TCG
+  // crypto-agile format.
+  std::vector<uint8_t> GetEventLog();
+
   // Calls Tss2_Sys_GetRandom with num_bytes.
   std::vector<uint8_t> GetRandom(int num_bytes);
 
+  // Fills buffer with num_bytes by issuing back-to-back Tss2_Sys_GetRandom
+  // calls, each for as many bytes as the TPM returns per command. Stops at the
+  // first failing call and returns its rc. Sets *num_generated to the number
+  // of bytes written to buffer.
+  int GetRandomStream(uint8_t *buffer, size_t num_bytes,
+                      size_t *num_generated);
+
+  // Calls GetRandomStream into a newly allocated buffer of num_bytes.
+  GetRandomStreamResult GetRandomStream(size_t num_bytes);
+
   // Calls Tss2_Sys_SelfTest.
   int SelfTest();
 
@@ -198,20 +286,60 @@ public:
   // type = {TPM2_ALG_RSA, TPM2_ALG_ECC}.
   SignResult Sign(uint32_t key_handle, int type, const std::string &str);
 
+  // Calls Tss2_Sys_Sign once per SHA256 digest in digests, which holds the
+  // digests back to back. The scheme, validation ticket and sessions data are
+  // built once and reused for every digest.
+  // type = {TPM2_ALG_RSA, TPM2_ALG_ECC}.
+  SignManyResult SignMany(uint32_t key_handle, int type,
+                          const std::vector<uint8_t> &digests);
+
   // Verifies the SHA256 digest of str against the signature.
   int VerifySignature(uint32_t key_handle, const std::string &str,
                       const SignResult &in_signature);
 
-  // Calls Tss2_Sys_EncryptDecrypt.
+  // Encrypts message of any size in CFB mode with a zero IV.
   // key_handle should be a handle of a loaded TPM2_ALG_SYMCIPHER key.
   std::vector<uint8_t> Encrypt(uint32_t key_handle,
                                const std::vector<uint8_t> &message);
 
-  // Calls Tss2_Sys_EncryptDecrypt.
+  // Decrypts message of any size in CFB mode with a zero IV.
   // key_handle should be a handle of a loaded TPM2_ALG_SYMCIPHER key.
   std::vector<uint8_t> Decrypt(uint32_t key_handle,
                                const std::vector<uint8_t> &message);
 
+  // Encrypts or decrypts size bytes at in into out with back to back
+  // Tss2_Sys_EncryptDecrypt2 calls, one per TPM2B_MAX_BUFFER sized chunk. Each
+  // chunk continues from the IV the previous one returned. iv holds the
+  // initial IV and, on return, the IV to continue the stream with. in and out
+  // may be the same buffer.
+  // mode = {TPM2_ALG_CFB, TPM2_ALG_CTR}.
+  // key_handle should be a handle of a loaded TPM2_ALG_SYMCIPHER key created
+  // unrestricted, or restricted to mode.
+  int EncryptDecryptStream(uint32_t key_handle, int mode, bool decrypt,
+                           std::vector<uint8_t> *iv, const uint8_t *in,
+                           size_t size, uint8_t *out);
+
+  // Calls Tss2_Sys_HashSequenceStart for a SHA256 sequence with empty auth.
+  SequenceStartResult HashSequenceStart();
+
+  // Calls Tss2_Sys_HMAC_Start with the default hash of the key and empty auth.
+  // key_handle should be a handle of a loaded TPM2_ALG_KEYEDHASH key created
+  // unrestricted with sign set and decrypt clear.
+  SequenceStartResult HmacStart(uint32_t key_handle);
+
+  // Feeds size bytes at data to the sequence with back to back
+  // Tss2_Sys_SequenceUpdate calls, one per TPM2B_MAX_BUFFER sized chunk. Stops
+  // at the first failing call and returns its rc.
+  int SequenceUpdate(uint32_t sequence_handle, const uint8_t *data,
+                     size_t size);
+
+  // Feeds size bytes at data to the sequence and calls
+  // Tss2_Sys_SequenceComplete. All chunks but the last go through
+  // SequenceUpdate, the last one is sent with Tss2_Sys_SequenceComplete. The
+  // sequence handle is flushed once the sequence completes.
+  SequenceCompleteResult SequenceComplete(uint32_t sequence_handle,
+                                          const uint8_t *data, size_t size);
+
   // Calls Tss2_Sys_RSA_Encrypt.
   // key_handle should be a handle of a loaded TPM2_ALG_RSA key.
   std::vector<uint8_t> RSAEncrypt(uint32_t key_handle,
@@ -226,18 +354,41 @@ public:
   int EvictControl(uint32_t auth, uint32_t key_handle,
                    uint32_t persistent_handle);
 
-  // Calls Tss2_Sys_NV_DefineSpace.
+  // Calls Tss2_Sys_NV_DefineSpace with the attributes of an EK certificate
+  // space from the TCG PC Client Platform TPM Profile, under platform auth.
   int NvDefineSpace(uint32_t nv_index, size_t data_size);
 
-  // Calls Tss2_Sys_NV_Write.
+  // Calls Tss2_Sys_NV_DefineSpace with TPMA_NV attributes, under platform
+  // auth. For the NvWrite and NvRead functions, which use platform auth,
+  // attributes should include TPMA_NV_PPWRITE and TPMA_NV_PPREAD.
+  int NvDefineSpace(uint32_t nv_index, size_t data_size, uint32_t attributes);
+
+  // Calls NvWriteStream with data at offset 0.
   int NvWrite(uint32_t nv_index, const std::vector<uint8_t> &data);
 
+  // Writes size bytes at data to nv_index at offset with back to back
+  // Tss2_Sys_NV_Write calls, each for as many bytes as the TPM accepts per
+  // command (TPM2_PT_NV_BUFFER_MAX). The simulator commits NV once for all
+  // chunks. Stops at the first failing call and returns its rc.
+  int NvWriteStream(uint32_t nv_index, const uint8_t *data, size_t size,
+                    size_t offset);
+
   // Calls Tss2_Sys_NV_ReadPublic.
   NvReadPublicResult NvReadPublic(uint32_t nv_index);
 
   // Calls Tss2_Sys_NV_Read.
   NvReadResult NvRead(uint32_t nv_index, int size, int offset);
 
+  // Reads size bytes of nv_index at offset into buffer with back to back
+  // Tss2_Sys_NV_Read calls, each for as many bytes as the TPM returns per
+  // command (TPM2_PT_NV_BUFFER_MAX). Stops at the first failing call and
+  // returns its rc.
+  int NvReadStream(uint32_t nv_index, uint8_t *buffer, size_t size,
+                   size_t offset);
+
+  // Calls NvReadStream into a newly allocated buffer of size bytes.
+  NvReadResult NvReadStream(uint32_t nv_index, size_t size, size_t offset);
+
   // Calls Tss2_Sys_Quote. Signs the SHA256 digest of PCR0, PCR1, PCR2 and PCR3.
   QuoteResult Quote(uint32_t key_handle, const std::string &nonce);
 
@@ -281,6 +432,13 @@ public:
                       const std::vector<uint8_t> &encrypted_private,
                       const std::vector<uint8_t> &encrypted_seed);
 
+  // Executes operations back to back with the same sessions data, as if each
+  // was called on its own, and collects all their results. Unlike separate
+  // calls, a batch costs a single call from JavaScript. Operations with an
+  // unknown type, key type or out of range NV size or offset fail with
+  // TSS2_SYS_RC_BAD_VALUE without reaching the TPM.
+  BatchResult ExecuteBatch(const std::vector<BatchOperation> &operations);
+
 private:
   App();
 
@@ -290,7 +448,10 @@ private:
   // Calls Tss2_Sys_GetCapability with the given capability and property.
   TPMS_CAPABILITY_DATA GetCapability(TPM2_CAP capability, UINT32 property);
 
-  // Calls Tss2_Sys_EncryptDecrypt.
+  // Returns the number of bytes NV_Read and NV_Write take per command.
+  size_t GetNvBufferMax();
+
+  // Calls EncryptDecryptStream in CFB mode with a zero IV.
   std::vector<uint8_t> EncryptDecrypt(uint32_t key_handle,
                                       const std::vector<uint8_t> &message,
                                       bool decrypt);
@@ -301,12 +462,22 @@ private:
                             const TPM2B_SENSITIVE_CREATE &in_sensitive,
                             const TPM2B_PUBLIC &in_public);
 
+  // Swaps transient objects and sessions in and out of the simulator.
+  // Declared before tss_, which sends every command through it.
+  ResourceManager resource_manager_;
+
   // Maintains TSS2_SYS_CONTEXT passed to Tss2_Sys_* functions.
   TssAdapter tss_;
 
   // Session data is used across different TPM calls.
   TSS2L_SYS_AUTH_COMMAND sessions_data_;
   TSS2L_SYS_AUTH_RESPONSE sessions_data_out_;
+
+  // Extends made with ExtendPcr since Startup.
+  EventLog event_log_;
+
+  // Result of GetNvBufferMax, or 0 until first fetched.
+  size_t nv_buffer_max_;
 };
 
 } // namespace tpm_js
@@ -0,0 +1,243 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of App operations against the simulator.
+// Prints the time per operation of each benchmark.
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "app.h"
+#include "hash_sequence.h"
+#include "quote_verifier.h"
+#include "simulator.h"
+#include "tss_adapter.h"
+
+namespace tpm_js {
+namespace {
+
+// Number of signatures per signing benchmark.
+const int kNumSignatures = 200;
+
+// Number of quotes per quote verification benchmark.
+const int kNumQuotes = 20000;
+
+// Number of MiB hashed per hashing benchmark.
+const int kHashMiB = 1024;
+
+// Number of commands per TCTI benchmark.
+const int kNumCommands = 20000;
+
+// Number of MiB encrypted per symmetric encryption benchmark.
+const int kCipherMiB = 64;
+
+// Runs fn, which executes num_ops operations, and prints the time per
+// operation.
+void RunBenchmark(const std::string &name, int num_ops,
+                  const std::function<void()> &fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  printf("%-32s %8d ops %12.1f us/op\n", name.c_str(), num_ops,
+         elapsed.count() / num_ops);
+}
+
+void ResetSimulator() {
+  Simulator::PowerOff();
+  Simulator::PowerOn();
+  Simulator::ManufactureReset();
+  int rc = App::Get()->Startup();
+  assert(rc == TPM2_RC_SUCCESS);
+  (void)rc;
+}
+
+uint32_t CreateSigningKey(int type) {
+  CreatePrimaryResult primary = App::Get()->CreatePrimary(
+      TPM2_RH_OWNER, type, /*restricted=*/0, /*decrypt=*/0, /*sign=*/1,
+      /*unique=*/"", /*user_auth=*/"", /*sensitive_data=*/"",
+      /*auth_policy=*/{});
+  assert(primary.rc == TPM2_RC_SUCCESS);
+  return primary.handle;
+}
+
+void BenchmarkSign(int type, const std::string &name) {
+  App *app = App::Get();
+  uint32_t key_handle = CreateSigningKey(type);
+  std::vector<std::string> messages;
+  for (int i = 0; i < kNumSignatures; ++i) {
+    messages.push_back("message " + std::to_string(i));
+  }
+  RunBenchmark(name, kNumSignatures, [&]() {
+    for (const std::string &message : messages) {
+      SignResult result = app->Sign(key_handle, type, message);
+      assert(result.rc == TPM2_RC_SUCCESS);
+      (void)result;
+    }
+  });
+  app->FlushContext(key_handle);
+}
+
+void BenchmarkSignMany(int type, const std::string &name) {
+  App *app = App::Get();
+  uint32_t key_handle = CreateSigningKey(type);
+  std::vector<uint8_t> digests(kNumSignatures * TPM2_SHA256_DIGEST_SIZE);
+  for (size_t i = 0; i < digests.size(); ++i) {
+    digests[i] = i * 31 + 7;
+  }
+  RunBenchmark(name, kNumSignatures, [&]() {
+    SignManyResult result = app->SignMany(key_handle, type, digests);
+    assert(result.count == kNumSignatures);
+    (void)result;
+  });
+  app->FlushContext(key_handle);
+}
+
+void BenchmarkVerifyQuotes(int type, const std::string &name) {
+  App *app = App::Get();
+  CreatePrimaryResult primary = app->CreatePrimary(
+      TPM2_RH_OWNER, type, /*restricted=*/1, /*decrypt=*/0, /*sign=*/1,
+      /*unique=*/"", /*user_auth=*/"", /*sensitive_data=*/"",
+      /*auth_policy=*/{});
+  assert(primary.rc == TPM2_RC_SUCCESS);
+  PublicKey key = {};
+  key.type = type;
+  key.rsa_public_n = primary.rsa_public_n;
+  key.ecc_public_x = primary.ecc_public_x;
+  key.ecc_public_y = primary.ecc_public_y;
+  key.ecc_curve_id = primary.ecc_curve_id;
+  QuoteVerifier verifier;
+
+  // The same quote over and over, as if from a fleet of identical machines.
+  const std::string kNonce = "nonce";
+  QuoteToVerify quote = {};
+  quote.key_index = verifier.AddKey(key);
+  quote.quote = app->Quote(primary.handle, kNonce);
+  for (int pcr = 0; pcr < 4; ++pcr) {
+    std::vector<uint8_t> value = Simulator::GetPcr(pcr);
+    quote.pcr_values.insert(quote.pcr_values.end(), value.begin(),
+                            value.end());
+  }
+  quote.nonce = std::vector<uint8_t>(kNonce.begin(), kNonce.end());
+  std::vector<QuoteToVerify> quotes(kNumQuotes, quote);
+  RunBenchmark(name, kNumQuotes, [&]() {
+    std::vector<int> verdicts = verifier.Verify(quotes);
+    assert(verdicts.back() == kQuoteValid);
+    (void)verdicts;
+  });
+  app->FlushContext(primary.handle);
+}
+
+// Hashes kHashMiB of data with sequence, one MiB per Update. Each operation
+// is one MiB.
+void BenchmarkHashSequence(HashSequence *sequence, const std::string &name) {
+  std::vector<uint8_t> data(1 << 20);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = i * 31 + 7;
+  }
+  RunBenchmark(name, kHashMiB, [&]() {
+    int rc = sequence->Start();
+    assert(rc == TPM2_RC_SUCCESS);
+    for (int i = 0; i < kHashMiB; ++i) {
+      rc = sequence->Update(data.data(), data.size());
+      assert(rc == TPM2_RC_SUCCESS);
+    }
+    SequenceCompleteResult result = sequence->Complete();
+    assert(result.rc == TPM2_RC_SUCCESS);
+    (void)rc;
+    (void)result;
+  });
+}
+
+void BenchmarkHmacSequence(const std::string &name) {
+  App *app = App::Get();
+  CreatePrimaryResult primary = app->CreatePrimary(
+      TPM2_RH_OWNER, TPM2_ALG_KEYEDHASH, /*restricted=*/0, /*decrypt=*/0,
+      /*sign=*/1, /*unique=*/"", /*user_auth=*/"", /*sensitive_data=*/"",
+      /*auth_policy=*/{});
+  assert(primary.rc == TPM2_RC_SUCCESS);
+  HmacSequence sequence(primary.handle);
+  BenchmarkHashSequence(&sequence, name);
+  app->FlushContext(primary.handle);
+}
+
+// Encrypts kCipherMiB of data in place with an AES key in mode, one MiB per
+// call. Each operation is one MiB.
+void BenchmarkEncryptDecrypt(int mode, const std::string &name) {
+  App *app = App::Get();
+  CreatePrimaryResult primary = app->CreatePrimary(
+      TPM2_RH_OWNER, TPM2_ALG_SYMCIPHER, /*restricted=*/0, /*decrypt=*/1,
+      /*sign=*/1, /*unique=*/"", /*user_auth=*/"", /*sensitive_data=*/"",
+      /*auth_policy=*/{});
+  assert(primary.rc == TPM2_RC_SUCCESS);
+  std::vector<uint8_t> data(1 << 20);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = i * 31 + 7;
+  }
+  std::vector<uint8_t> iv(16, 0);
+  RunBenchmark(name, kCipherMiB, [&]() {
+    for (int i = 0; i < kCipherMiB; ++i) {
+      int rc = app->EncryptDecryptStream(primary.handle, mode,
+                                         /*decrypt=*/false, &iv, data.data(),
+                                         data.size(), data.data());
+      assert(rc == TPM2_RC_SUCCESS);
+      (void)rc;
+    }
+  });
+  app->FlushContext(primary.handle);
+}
+
+// Gets 16 random bytes kNumCommands times through tss, straight from the
+// simulator.
+void BenchmarkGetRandom(TssAdapter *tss, const std::string &name) {
+  RunBenchmark(name, kNumCommands, [tss]() {
+    for (int i = 0; i < kNumCommands; ++i) {
+      TPM2B_DIGEST random = {};
+      TSS2_RC rc =
+          Tss2_Sys_GetRandom(tss->GetSysContext(), /*cmdAuthsArray=*/nullptr,
+                             16, &random, /*rspAuthsArray=*/nullptr);
+      assert(rc == TPM2_RC_SUCCESS);
+      (void)rc;
+    }
+  });
+}
+
+} // namespace
+} // namespace tpm_js
+
+int main() {
+  using namespace tpm_js;
+  ResetSimulator();
+  BenchmarkSign(TPM2_ALG_ECC, "Sign/ECC");
+  BenchmarkSignMany(TPM2_ALG_ECC, "SignMany/ECC");
+  BenchmarkSign(TPM2_ALG_RSA, "Sign/RSA");
+  BenchmarkSignMany(TPM2_ALG_RSA, "SignMany/RSA");
+  BenchmarkVerifyQuotes(TPM2_ALG_ECC, "QuoteVerifier/ECC");
+  BenchmarkVerifyQuotes(TPM2_ALG_RSA, "QuoteVerifier/RSA");
+  HashSequence hash_sequence;
+  BenchmarkHashSequence(&hash_sequence, "HashSequence/MiB");
+  BenchmarkHmacSequence("HmacSequence/MiB");
+  BenchmarkEncryptDecrypt(TPM2_ALG_CFB, "EncryptDecrypt/CFB/MiB");
+  BenchmarkEncryptDecrypt(TPM2_ALG_CTR, "EncryptDecrypt/CTR/MiB");
+  TssAdapter run_command_tss(&Simulator::ExecuteCommand);
+  BenchmarkGetRandom(&run_command_tss, "TssAdapter/RunCommand");
+  TssAdapter direct_tss(&Simulator::ExecuteRawCommand);
+  BenchmarkGetRandom(&direct_tss, "TssAdapter/Direct");
+  Simulator::PowerOff();
+  return 0;
+}
@@ -13,6 +13,9 @@
 // limitations under the License.
 
 #include "app.h"
+
+#include <algorithm>
+
 #include "simulator.h"
 #include "util.h"
 
@@ -68,6 +71,30 @@ TEST_F(AppTest, TestGetRandom) {
   EXPECT_NE(before, after);
 }
 
+TEST_F(AppTest, TestGetRandomStream) {
+  App *app = App::Get();
+  // Spans several TPM2_GetRandom commands and ends on a partial one.
+  const size_t kNumBytes = 1000;
+  const GetRandomStreamResult result = app->GetRandomStream(kNumBytes);
+  EXPECT_EQ(TPM2_RC_SUCCESS, result.rc);
+  EXPECT_EQ(kNumBytes, result.random_bytes.size());
+  EXPECT_NE(std::vector<uint8_t>(kNumBytes, 0), result.random_bytes);
+
+  std::vector<uint8_t> buffer(kNumBytes, 0);
+  size_t num_generated = 1;
+  EXPECT_EQ(TPM2_RC_SUCCESS,
+            app->GetRandomStream(buffer.data(), 0, &num_generated));
+  EXPECT_EQ(0u, num_generated);
+  EXPECT_EQ(std::vector<uint8_t>(kNumBytes, 0), buffer);
+
+  // Fails on the first command without Startup, with no bytes generated.
+  Simulator::PowerOff();
+  Simulator::PowerOn();
+  const GetRandomStreamResult failed = app->GetRandomStream(kNumBytes);
+  EXPECT_NE(TPM2_RC_SUCCESS, failed.rc);
+  EXPECT_TRUE(failed.random_bytes.empty());
+}
+
 TEST_F(AppTest, TestSelfTest) {
   App *app = App::Get();
   EXPECT_EQ(TPM2_RC_SUCCESS, app->SelfTest());
@@ -182,6 +209,66 @@ TEST_F(AppTest, TestCreatePrimaryRSADifferentTemplates) {
   EXPECT_NE(k1.name, k2.name);
 }
 
+TEST_F(AppTest, TestCreatePrimaryRSAFromCache) {
+  App *app = App::Get();
+  CreatePrimaryResult k1 =
+      app->CreatePrimary(TPM2_RH_OWNER, TPM2_ALG_RSA, /*restricted=*/1,
+                         /*decrypt=*/1, /*sign=*/0, /*unique=*/"",
+                         /*user_auth=*/"", /*sensitive_data=*/"",
+                         /*auth_policy=*/{});
+  EXPECT_EQ(TPM2_RC_SUCCESS, k1.rc);
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->FlushContext(k1.handle));
+  auto cache = Simulator::GetPrimaryKeyCache();
+
+  // Same key after a reboot.
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->Shutdown());
+  Simulator::PowerOff();
+  Simulator::PowerOn();
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->Startup());
+  EXPECT_TRUE(Simulator::SetPrimaryKeyCache(cache));
+  CreatePrimaryResult k2 =
+      app->CreatePrimary(TPM2_RH_OWNER, TPM2_ALG_RSA, /*restricted=*/1,
+                         /*decrypt=*/1, /*sign=*/0, /*unique=*/"",
+                         /*user_auth=*/"", /*sensitive_data=*/"",
+                         /*auth_policy=*/{});
+  EXPECT_EQ(TPM2_RC_SUCCESS, k2.rc);
+  EXPECT_EQ(k1.name, k2.name);
+  EXPECT_EQ(k1.rsa_public_n, k2.rsa_public_n);
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->FlushContext(k2.handle));
+
+  // New key once the owner seed changes.
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->Clear());
+  CreatePrimaryResult k3 =
+      app->CreatePrimary(TPM2_RH_OWNER, TPM2_ALG_RSA, /*restricted=*/1,
+                         /*decrypt=*/1, /*sign=*/0, /*unique=*/"",
+                         /*user_auth=*/"", /*sensitive_data=*/"",
+                         /*auth_policy=*/{});
+  EXPECT_EQ(TPM2_RC_SUCCESS, k3.rc);
+  EXPECT_NE(k1.name, k3.name);
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->FlushContext(k3.handle));
+
+  EXPECT_FALSE(Simulator::SetPrimaryKeyCache({1, 2, 3}));
+}
+
+TEST_F(AppTest, TestSignWithRSAPrimaryFromCache) {
+  App *app = App::Get();
+  for (int i = 0; i < 2; i++) {
+    // The second primary is a cache hit, with the private exponent of the
+    // first one.
+    CreatePrimaryResult primary =
+        app->CreatePrimary(TPM2_RH_OWNER, TPM2_ALG_RSA, /*restricted=*/0,
+                           /*decrypt=*/0, /*sign=*/1, /*unique=*/"",
+                           /*user_auth=*/"", /*sensitive_data=*/"",
+                           /*auth_policy=*/{});
+    ASSERT_EQ(TPM2_RC_SUCCESS, primary.rc);
+    SignResult result = app->Sign(primary.handle, TPM2_ALG_RSA, "Hello");
+    EXPECT_EQ(TPM2_RC_SUCCESS, result.rc);
+    EXPECT_EQ(TPM2_RC_SUCCESS,
+              app->VerifySignature(primary.handle, "Hello", result));
+    EXPECT_EQ(TPM2_RC_SUCCESS, app->FlushContext(primary.handle));
+  }
+}
+
 TEST_F(AppTest, TestCreatePrimaryECC) {
   App *app = App::Get();
   CreatePrimaryResult result =
@@ -382,6 +469,156 @@ TEST_F(AppTest, TestECCSignVerify) {
             app->VerifySignature(primary.handle, "!ello", result));
 }
 
+TEST_F(AppTest, TestECCSignMany) {
+  App *app = App::Get();
+  CreatePrimaryResult primary =
+      app->CreatePrimary(TPM2_RH_OWNER, TPM2_ALG_ECC, /*restricted=*/0,
+                         /*decrypt=*/0, /*sign=*/1, /*unique=*/"",
+                         /*user_auth=*/"", /*sensitive_data=*/"",
+                         /*auth_policy=*/{});
+  EXPECT_EQ(TPM2_RC_SUCCESS, primary.rc);
+  // SHA256 digests of "Hello" and "".
+  const std::vector<uint8_t> kDigests = {
+      0x18, 0x5f, 0x8d, 0xb3, 0x22, 0x71, 0xfe, 0x25,
+      0xf5, 0x61, 0xa6, 0xfc, 0x93, 0x8b, 0x2e, 0x26,
+      0x43, 0x06, 0xec, 0x30, 0x4e, 0xda, 0x51, 0x80,
+      0x07, 0xd1, 0x76, 0x48, 0x26, 0x38, 0x19, 0x69,
+      0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14,
+      0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+      0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c,
+      0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55,
+  };
+  const std::vector<std::string> kMessages = {"Hello", ""};
+  SignManyResult result = app->SignMany(primary.handle, TPM2_ALG_ECC, kDigests);
+  EXPECT_EQ(TPM2_RC_SUCCESS, result.rc);
+  EXPECT_EQ(2, result.count);
+  EXPECT_EQ(TPM2_ALG_ECDSA, result.sign_algo);
+  EXPECT_EQ(TPM2_ALG_SHA256, result.hash_algo);
+  EXPECT_EQ(64, result.signature_size);
+  ASSERT_EQ(2 * 64, result.signatures.size());
+  for (int i = 0; i < 2; ++i) {
+    auto sig = result.signatures.begin() + i * result.signature_size;
+    SignResult signature = {};
+    signature.sign_algo = result.sign_algo;
+    signature.hash_algo = result.hash_algo;
+    signature.ecdsa_r.assign(sig, sig + 32);
+    signature.ecdsa_s.assign(sig + 32, sig + 64);
+    EXPECT_EQ(TPM2_RC_SUCCESS,
+              app->VerifySignature(primary.handle, kMessages[i], signature));
+    EXPECT_NE(TPM2_RC_SUCCESS,
+              app->VerifySignature(primary.handle, kMessages[1 - i], signature));
+  }
+  // Signing stops at the first failure.
+  result = app->SignMany(primary.handle, TPM2_ALG_RSA, kDigests);
+  EXPECT_NE(TPM2_RC_SUCCESS, result.rc);
+  EXPECT_EQ(0, result.count);
+  EXPECT_EQ(0, result.signatures.size());
+}
+
+TEST_F(AppTest, TestHostVerifySignatures) {
+  App *app = App::Get();
+  std::vector<PublicKey> keys;
+  std::vector<SignatureToVerify> signatures;
+  const int kNumDigests = 4;
+  std::vector<uint8_t> digests(kNumDigests * 32);
+  for (size_t i = 0; i < digests.size(); ++i) {
+    digests[i] = i;
+  }
+  for (int type : {TPM2_ALG_RSA, TPM2_ALG_ECC}) {
+    CreatePrimaryResult primary =
+        app->CreatePrimary(TPM2_RH_OWNER, type, /*restricted=*/0,
+                           /*decrypt=*/0, /*sign=*/1, /*unique=*/"",
+                           /*user_auth=*/"", /*sensitive_data=*/"",
+                           /*auth_policy=*/{});
+    ASSERT_EQ(TPM2_RC_SUCCESS, primary.rc);
+    PublicKey key = {};
+    key.type = type;
+    key.rsa_public_n = primary.rsa_public_n;
+    key.ecc_public_x = primary.ecc_public_x;
+    key.ecc_public_y = primary.ecc_public_y;
+    key.ecc_curve_id = primary.ecc_curve_id;
+    keys.push_back(key);
+
+    SignManyResult result = app->SignMany(primary.handle, type, digests);
+    ASSERT_EQ(kNumDigests, result.count);
+    EXPECT_EQ(TPM2_RC_SUCCESS, app->FlushContext(primary.handle));
+    for (int i = 0; i < kNumDigests; ++i) {
+      auto sig = result.signatures.begin() + i * result.signature_size;
+      SignatureToVerify signature = {};
+      signature.key_index = keys.size() - 1;
+      signature.digest.assign(digests.begin() + i * 32,
+                              digests.begin() + (i + 1) * 32);
+      signature.sign_algo = result.sign_algo;
+      if (type == TPM2_ALG_RSA) {
+        signature.rsa_ssa_sig.assign(sig, sig + result.signature_size);
+      } else {
+        const int half = result.signature_size / 2;
+        signature.ecdsa_r.assign(sig, sig + half);
+        signature.ecdsa_s.assign(sig + half, sig + 2 * half);
+      }
+      signatures.push_back(signature);
+    }
+  }
+  std::vector<int> expected(signatures.size(), TPM2_RC_SUCCESS);
+  EXPECT_EQ(expected, Util::VerifySignatures(keys, signatures));
+
+  // Tampered digest, wrong key type, unknown key.
+  signatures[0].digest[0] ^= 1;
+  signatures[1].key_index = 1;
+  signatures[kNumDigests].key_index = 2;
+  expected[0] = TPM2_RC_SIGNATURE;
+  expected[1] = TPM2_RC_SCHEME;
+  expected[kNumDigests] = TPM2_RC_KEY;
+  EXPECT_EQ(expected, Util::VerifySignatures(keys, signatures));
+}
+
+TEST_F(AppTest, TestManyLoadedObjects) {
+  App *app = App::Get();
+  // More keys than the simulator has object slots.
+  const int kNumKeys = 8;
+  std::vector<uint32_t> handles;
+  for (int i = 0; i < kNumKeys; i++) {
+    CreatePrimaryResult primary = app->CreatePrimary(
+        TPM2_RH_OWNER, TPM2_ALG_ECC, /*restricted=*/0,
+        /*decrypt=*/0, /*sign=*/1, /*unique=*/"key" + std::to_string(i),
+        /*user_auth=*/"", /*sensitive_data=*/"", /*auth_policy=*/{});
+    EXPECT_EQ(TPM2_RC_SUCCESS, primary.rc);
+    handles.push_back(primary.handle);
+  }
+  for (int i = 0; i < kNumKeys; i++) {
+    SignResult result = app->Sign(handles[i], TPM2_ALG_ECC, "Hello");
+    EXPECT_EQ(TPM2_RC_SUCCESS, result.rc);
+    EXPECT_EQ(TPM2_RC_SUCCESS,
+              app->VerifySignature(handles[i], "Hello", result));
+    EXPECT_EQ(TPM2_RC_SIGNATURE + TPM2_RC_P + TPM2_RC_2,
+              app->VerifySignature(handles[(i + 1) % kNumKeys], "Hello",
+                                   result));
+  }
+  for (uint32_t handle : handles) {
+    EXPECT_EQ(TPM2_RC_SUCCESS, app->FlushContext(handle));
+  }
+}
+
+TEST_F(AppTest, TestManyActiveSessions) {
+  App *app = App::Get();
+  // More sessions than the simulator has session slots.
+  const int kNumSessions = 8;
+  std::vector<uint32_t> handles;
+  for (int i = 0; i < kNumSessions; i++) {
+    StartAuthSessionResult trial = app->StartAuthSession(true);
+    EXPECT_EQ(TPM2_RC_SUCCESS, trial.rc);
+    handles.push_back(trial.handle);
+  }
+  for (uint32_t handle : handles) {
+    EXPECT_EQ(TPM2_RC_SUCCESS, app->PolicyPassword(handle));
+  }
+  const std::vector<uint8_t> policy_digest = app->PolicyGetDigest(handles[0]);
+  for (uint32_t handle : handles) {
+    EXPECT_EQ(policy_digest, app->PolicyGetDigest(handle));
+    EXPECT_EQ(TPM2_RC_SUCCESS, app->FlushContext(handle));
+  }
+}
+
 TEST_F(AppTest, TestEncryptDecrypt) {
   App *app = App::Get();
   CreatePrimaryResult primary =
@@ -398,6 +635,58 @@ TEST_F(AppTest, TestEncryptDecrypt) {
   EXPECT_EQ(message, kOriginal);
 }
 
+TEST_F(AppTest, TestEncryptDecryptStream) {
+  App *app = App::Get();
+  CreatePrimaryResult primary =
+      app->CreatePrimary(TPM2_RH_OWNER, TPM2_ALG_SYMCIPHER, /*restricted=*/0,
+                         /*decrypt=*/1, /*sign=*/1, /*unique=*/"",
+                         /*user_auth=*/"", /*sensitive_data=*/"",
+                         /*auth_policy=*/{});
+  EXPECT_EQ(TPM2_RC_SUCCESS, primary.rc);
+
+  // Several TPM2B_MAX_BUFFER chunks and a partial block.
+  std::vector<uint8_t> original(5000);
+  for (size_t i = 0; i < original.size(); ++i) {
+    original[i] = i * 7;
+  }
+  const std::vector<uint8_t> kZeroIv(16, 0);
+  std::vector<uint8_t> encrypted = app->Encrypt(primary.handle, original);
+  EXPECT_EQ(original.size(), encrypted.size());
+  EXPECT_EQ(original, app->Decrypt(primary.handle, encrypted));
+
+  for (int mode : {TPM2_ALG_CFB, TPM2_ALG_CTR}) {
+    // Encrypt in two calls, continuing from the returned IV.
+    std::vector<uint8_t> iv = kZeroIv;
+    std::vector<uint8_t> streamed(original.size());
+    const size_t kSplit = 2048;
+    EXPECT_EQ(TPM2_RC_SUCCESS,
+              app->EncryptDecryptStream(primary.handle, mode,
+                                        /*decrypt=*/false, &iv,
+                                        original.data(), kSplit,
+                                        streamed.data()));
+    EXPECT_NE(kZeroIv, iv);
+    EXPECT_EQ(TPM2_RC_SUCCESS,
+              app->EncryptDecryptStream(
+                  primary.handle, mode, /*decrypt=*/false, &iv,
+                  original.data() + kSplit, original.size() - kSplit,
+                  streamed.data() + kSplit));
+    if (mode == TPM2_ALG_CFB) {
+      EXPECT_EQ(encrypted, streamed);
+    } else {
+      EXPECT_NE(encrypted, streamed);
+    }
+
+    // Decrypt in place in a single call.
+    iv = kZeroIv;
+    EXPECT_EQ(TPM2_RC_SUCCESS,
+              app->EncryptDecryptStream(primary.handle, mode,
+                                        /*decrypt=*/true, &iv,
+                                        streamed.data(), streamed.size(),
+                                        streamed.data()));
+    EXPECT_EQ(original, streamed);
+  }
+}
+
 TEST_F(AppTest, TestRSAEncryptDecrypt) {
   App *app = App::Get();
   CreatePrimaryResult primary =
@@ -455,6 +744,151 @@ TEST_F(AppTest, TestNvReadWrite) {
   EXPECT_EQ(read_result.data, kData);
 }
 
+TEST_F(AppTest, TestNvDefineSpaceWithAttributes) {
+  App *app = App::Get();
+  const std::vector<uint8_t> kData = {1, 2, 3, 4};
+  const uint32_t kNvIndex = 0x01c00003;
+  EXPECT_EQ(TPM2_RC_SUCCESS,
+            app->NvDefineSpace(kNvIndex, kData.size(),
+                               TPMA_NV_PPWRITE | TPMA_NV_PPREAD |
+                                   TPMA_NV_AUTHREAD | TPMA_NV_NO_DA |
+                                   TPMA_NV_PLATFORMCREATE));
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->NvWrite(kNvIndex, kData));
+  EXPECT_EQ(kData, app->NvRead(kNvIndex, kData.size(), 0).data);
+
+  // Not writable under platform auth.
+  const uint32_t kReadOnlyNvIndex = 0x01c00004;
+  EXPECT_EQ(TPM2_RC_SUCCESS,
+            app->NvDefineSpace(kReadOnlyNvIndex, kData.size(),
+                               TPMA_NV_AUTHWRITE | TPMA_NV_PPREAD |
+                                   TPMA_NV_AUTHREAD | TPMA_NV_NO_DA |
+                                   TPMA_NV_PLATFORMCREATE));
+  EXPECT_NE(TPM2_RC_SUCCESS, app->NvWrite(kReadOnlyNvIndex, kData));
+}
+
+TEST_F(AppTest, TestNvReadWriteStream) {
+  App *app = App::Get();
+  // Larger than the TPM takes per NV_Write or NV_Read command.
+  std::vector<uint8_t> data(2048);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = i * 7;
+  }
+  const uint32_t kNvIndex = 0x01c00002;
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->NvDefineSpace(kNvIndex, data.size()));
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->NvWrite(kNvIndex, data));
+  NvReadResult read_result = app->NvReadStream(kNvIndex, data.size(), 0);
+  EXPECT_EQ(TPM2_RC_SUCCESS, read_result.rc);
+  EXPECT_EQ(data, read_result.data);
+
+  // Overwrite a range that straddles the chunks.
+  const std::vector<uint8_t> kPatch(100, 0xAB);
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->NvWriteStream(kNvIndex, kPatch.data(),
+                                                kPatch.size(), 1000));
+  std::copy(kPatch.begin(), kPatch.end(), data.begin() + 1000);
+  std::vector<uint8_t> range(300);
+  EXPECT_EQ(TPM2_RC_SUCCESS,
+            app->NvReadStream(kNvIndex, range.data(), range.size(), 900));
+  EXPECT_EQ(std::vector<uint8_t>(data.begin() + 900, data.begin() + 1200),
+            range);
+
+  // Past the end of the index.
+  EXPECT_NE(TPM2_RC_SUCCESS, app->NvWriteStream(kNvIndex, kPatch.data(),
+                                                kPatch.size(), 2000));
+  read_result = app->NvReadStream(kNvIndex, 100, 2000);
+  EXPECT_NE(TPM2_RC_SUCCESS, read_result.rc);
+  EXPECT_TRUE(read_result.data.empty());
+}
+
+TEST_F(AppTest, TestEventLog) {
+  App *app = App::Get();
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->ExtendPcr(1, "hello"));
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->ExtendPcr(1, "world"));
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->ExtendPcr(3, "!"));
+
+  EventLog log;
+  ASSERT_TRUE(EventLog::Parse(app->GetEventLog(), &log));
+  EXPECT_EQ(3, log.GetEventCount());
+  ReplayResult result = log.Replay();
+  EXPECT_EQ(TPM2_RC_SUCCESS, result.rc);
+  for (int pcr = 0; pcr < 4; ++pcr) {
+    auto value = result.pcr_values.begin() + pcr * 32;
+    EXPECT_EQ(Simulator::GetPcr(pcr), std::vector<uint8_t>(value, value + 32));
+  }
+
+  // The PCRs and the log are reset after a reboot.
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->Shutdown());
+  Simulator::PowerOff();
+  Simulator::PowerOn();
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->Startup());
+  ASSERT_TRUE(EventLog::Parse(app->GetEventLog(), &log));
+  EXPECT_EQ(0, log.GetEventCount());
+}
+
+TEST_F(AppTest, TestExecuteBatch) {
+  App *app = App::Get();
+  const std::vector<uint8_t> kData = {1, 2, 3, 4};
+  const uint32_t kNvIndex = 0x01c00002;
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->NvDefineSpace(kNvIndex, kData.size()));
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->NvWrite(kNvIndex, kData));
+  CreatePrimaryResult primary =
+      app->CreatePrimary(TPM2_RH_OWNER, TPM2_ALG_ECC, /*restricted=*/0,
+                         /*decrypt=*/0, /*sign=*/1, /*unique=*/"",
+                         /*user_auth=*/"", /*sensitive_data=*/"",
+                         /*auth_policy=*/{});
+  EXPECT_EQ(TPM2_RC_SUCCESS, primary.rc);
+
+  const std::vector<uint8_t> kZeros(32, 0);
+  EXPECT_EQ(kZeros, Simulator::GetPcr(1));
+  std::vector<BatchOperation> operations = {
+      {kBatchExtendPcr, 1, 0, 0, "hello"},
+      {kBatchSign, primary.handle, TPM2_ALG_ECC, 0, "Hello"},
+      {kBatchNvRead, kNvIndex, 2, 1, ""},
+      {kBatchSign, primary.handle, TPM2_ALG_RSA, 0, "Hello"},
+  };
+  BatchResult result = app->ExecuteBatch(operations);
+  ASSERT_EQ(4, result.rc.size());
+  ASSERT_EQ(4, result.output_size.size());
+  EXPECT_NE(kZeros, Simulator::GetPcr(1));
+
+  EXPECT_EQ(TPM2_RC_SUCCESS, result.rc[0]);
+  EXPECT_EQ(0, result.output_size[0]);
+
+  EXPECT_EQ(TPM2_RC_SUCCESS, result.rc[1]);
+  SignResult signature = {};
+  signature.sign_algo = TPM2_ALG_ECDSA;
+  signature.hash_algo = TPM2_ALG_SHA256;
+  const int half = result.output_size[1] / 2;
+  signature.ecdsa_r.assign(result.output.begin(), result.output.begin() + half);
+  signature.ecdsa_s.assign(result.output.begin() + half,
+                           result.output.begin() + 2 * half);
+  EXPECT_EQ(TPM2_RC_SUCCESS,
+            app->VerifySignature(primary.handle, "Hello", signature));
+
+  EXPECT_EQ(TPM2_RC_SUCCESS, result.rc[2]);
+  EXPECT_EQ(2, result.output_size[2]);
+  EXPECT_EQ(std::vector<uint8_t>({2, 3}),
+            std::vector<uint8_t>(result.output.begin() + 2 * half,
+                                 result.output.end()));
+
+  // An RSASSA scheme does not match the ECC key.
+  EXPECT_NE(TPM2_RC_SUCCESS, result.rc[3]);
+  EXPECT_EQ(0, result.output_size[3]);
+
+  // Invalid operations fail on their own.
+  operations = {
+      {kBatchSign, primary.handle, /*param=*/12345, 0, "Hello"},
+      {kBatchNvRead, kNvIndex, /*param=*/-1, 0, ""},
+      {static_cast<BatchOperationType>(100), 0, 0, 0, ""},
+      {kBatchNvRead, kNvIndex, 2, 1, ""},
+  };
+  result = app->ExecuteBatch(operations);
+  EXPECT_EQ(std::vector<int>({TSS2_SYS_RC_BAD_VALUE, TSS2_SYS_RC_BAD_VALUE,
+                              TSS2_SYS_RC_BAD_VALUE, TPM2_RC_SUCCESS}),
+            result.rc);
+  EXPECT_EQ(std::vector<uint8_t>({2, 3}), result.output);
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->FlushContext(primary.handle));
+}
+
 TEST_F(AppTest, TestQuote) {
   App *app = App::Get();
   CreatePrimaryResult key =
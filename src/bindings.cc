@@ -13,15 +13,103 @@
 // limitations under the License.
 
 #include "app.h"
+#include "event_log.h"
+#include "hash_sequence.h"
 #include "keyed_hash.h"
+#include "quote_verifier.h"
 #include "simulator.h"
+#include "snapshot_data.h"
 #include "util.h"
 
 #include <emscripten/bind.h>
 #include <emscripten/html5.h>
+#include <emscripten/val.h>
 
 namespace e = emscripten;
 
+// BindingType and _embind_register_emval below are embind internals, not
+// public API, and change between emscripten releases. They are checked
+// against the emsdk version of the Dockerfile (EMSCRIPTEN_VERSION): when
+// updating it, check them against the new embind and update this pin.
+#if __EMSCRIPTEN_major__ != 1 || __EMSCRIPTEN_minor__ != 39 ||                 \
+    __EMSCRIPTEN_tiny__ != 15
+#error "The Uint8Array binding of std::vector<uint8_t> needs emsdk 1.39.15"
+#endif
+
+namespace emscripten {
+namespace internal {
+
+// Passes byte buffers as Uint8Arrays instead of StdVectorOfBytes objects,
+// with one bulk copy through a view of the module heap instead of one call
+// per byte. Arrays and other array-likes of bytes are accepted too. The type
+// is registered as such with _embind_register_emval in the bindings below.
+template <> struct BindingType<std::vector<uint8_t>> {
+  typedef EM_VAL WireType;
+
+  static WireType toWireType(const std::vector<uint8_t> &bytes) {
+    // Copy out of the heap: the view would not outlive bytes, which is
+    // usually a temporary, or a heap growth.
+    val view(typed_memory_view(bytes.size(), bytes.data()));
+    return BindingType<val>::toWireType(val::global("Uint8Array").new_(view));
+  }
+
+  static std::vector<uint8_t> fromWireType(WireType wire) {
+    val array = BindingType<val>::fromWireType(wire);
+    std::vector<uint8_t> bytes(array["length"].as<size_t>());
+    val(typed_memory_view(bytes.size(), bytes.data())).call<void>("set", array);
+    return bytes;
+  }
+};
+
+} // namespace internal
+} // namespace emscripten
+
+namespace {
+
+struct EncryptDecryptStreamResult {
+  int rc;
+  // IV to continue the stream with.
+  std::vector<uint8_t> iv;
+};
+
+// Calls App::EncryptDecryptStream on buffers in the module heap, e.g. from
+// Module._malloc. in and out are heap addresses.
+EncryptDecryptStreamResult
+EncryptDecryptStream(tpm_js::App &app, uint32_t key_handle, int mode,
+                     bool decrypt, const std::vector<uint8_t> &iv,
+                     uintptr_t in, size_t size, uintptr_t out) {
+  EncryptDecryptStreamResult result;
+  result.iv = iv;
+  result.rc = app.EncryptDecryptStream(
+      key_handle, mode, decrypt, &result.iv,
+      reinterpret_cast<const uint8_t *>(in), size,
+      reinterpret_cast<uint8_t *>(out));
+  return result;
+}
+
+// Calls App::NvWriteStream on a buffer in the module heap. data is a heap
+// address.
+int NvWriteStream(tpm_js::App &app, uint32_t nv_index, uintptr_t data,
+                  size_t size, size_t offset) {
+  return app.NvWriteStream(nv_index, reinterpret_cast<const uint8_t *>(data),
+                           size, offset);
+}
+
+// Calls HashSequence::Update on a buffer in the module heap. data is a heap
+// address.
+int HashSequenceUpdate(tpm_js::HashSequence &sequence, uintptr_t data,
+                       size_t size) {
+  return sequence.Update(reinterpret_cast<const uint8_t *>(data), size);
+}
+
+// Restores the snapshot taken at build time into the powered off simulator.
+bool RestoreBuiltInSnapshot() {
+  return tpm_js::Simulator::RestoreSnapshot(tpm_js::kBuiltInSnapshot,
+                                            tpm_js::kBuiltInSnapshotSize);
+}
+
+} // namespace
+
 // clang-format off
 EMSCRIPTEN_BINDINGS(TPM) {
   e::function("SimPowerOn", &tpm_js::Simulator::PowerOn);
@@ -36,8 +124,17 @@ EMSCRIPTEN_BINDINGS(TPM) {
   e::function("SimGetOwnerSeed", &tpm_js::Simulator::GetOwnerSeed);
   e::function("SimGetNullSeed", &tpm_js::Simulator::GetNullSeed);
   e::function("SimGetBootCounter", &tpm_js::Simulator::GetBootCounter);
+  e::function("SimGetPrimaryKeyCache", &tpm_js::Simulator::GetPrimaryKeyCache);
+  e::function("SimSetPrimaryKeyCache", &tpm_js::Simulator::SetPrimaryKeyCache);
+  e::function("SimRestoreBuiltInSnapshot", &RestoreBuiltInSnapshot);
+  e::function("SimGetNvBlockSize", &tpm_js::Simulator::GetNvBlockSize);
+  e::function("SimGetNvBlockCount", &tpm_js::Simulator::GetNvBlockCount);
+  e::function("SimTakeWrittenNvBlocks", &tpm_js::Simulator::TakeWrittenNvBlocks);
+  e::function("SimGetNvBlock", &tpm_js::Simulator::GetNvBlock);
+  e::function("SimRestoreNv", &tpm_js::Simulator::RestoreNv);
   e::function("UtilUnmarshalAttestBuffer", &tpm_js::Util::UnmarshalAttestBuffer);
   e::function("UtilKDFa", &tpm_js::Util::KDFa);
+  e::function("UtilVerifySignatures", &tpm_js::Util::VerifySignatures);
 
   e::class_<tpm_js::App>("App")
     .constructor(&tpm_js::App::Get, e::allow_raw_pointers())
@@ -45,7 +142,9 @@ EMSCRIPTEN_BINDINGS(TPM) {
     .function("Shutdown", &tpm_js::App::Shutdown)
     .function("Clear", &tpm_js::App::Clear)
     .function("ExtendPcr", &tpm_js::App::ExtendPcr)
+    .function("GetEventLog", &tpm_js::App::GetEventLog)
     .function("GetRandom", &tpm_js::App::GetRandom)
+    .function("GetRandomStream", e::select_overload<tpm_js::GetRandomStreamResult(size_t)>(&tpm_js::App::GetRandomStream))
     .function("SelfTest", &tpm_js::App::SelfTest)
     .function("GetTpmProperties", &tpm_js::App::GetTpmProperties)
     .function("TestHashParam", &tpm_js::App::TestHashParam)
@@ -55,16 +154,21 @@ EMSCRIPTEN_BINDINGS(TPM) {
     .function("Load", &tpm_js::App::Load)
     .function("FlushContext", &tpm_js::App::FlushContext)
     .function("Sign", &tpm_js::App::Sign)
+    .function("SignMany", &tpm_js::App::SignMany)
     .function("VerifySignature", &tpm_js::App::VerifySignature)
     .function("Encrypt", &tpm_js::App::Encrypt)
     .function("Decrypt", &tpm_js::App::Decrypt)
+    .function("EncryptDecryptStream", &EncryptDecryptStream)
     .function("RSAEncrypt", &tpm_js::App::RSAEncrypt)
     .function("RSADecrypt", &tpm_js::App::RSADecrypt)
     .function("EvictControl", &tpm_js::App::EvictControl)
-    .function("NvDefineSpace", &tpm_js::App::NvDefineSpace)
+    .function("NvDefineSpace", e::select_overload<int(uint32_t, size_t)>(&tpm_js::App::NvDefineSpace))
+    .function("NvDefineSpaceWithAttributes", e::select_overload<int(uint32_t, size_t, uint32_t)>(&tpm_js::App::NvDefineSpace))
     .function("NvWrite", &tpm_js::App::NvWrite)
+    .function("NvWriteStream", &NvWriteStream)
     .function("NvReadPublic", &tpm_js::App::NvReadPublic)
     .function("NvRead", &tpm_js::App::NvRead)
+    .function("NvReadStream", e::select_overload<tpm_js::NvReadResult(uint32_t, size_t, size_t)>(&tpm_js::App::NvReadStream))
     .function("Quote", &tpm_js::App::Quote)
     .function("HierarchyChangeAuth", &tpm_js::App::HierarchyChangeAuth)
     .function("SetAuthPassword", &tpm_js::App::SetAuthPassword)
@@ -77,6 +181,7 @@ EMSCRIPTEN_BINDINGS(TPM) {
     .function("SetSessionHandle", &tpm_js::App::SetSessionHandle)
     .function("DictionaryAttackLockReset", &tpm_js::App::DictionaryAttackLockReset)
     .function("Import", &tpm_js::App::Import)
+    .function("ExecuteBatch", &tpm_js::App::ExecuteBatch)
   ;
 
   e::value_object<tpm_js::TpmProperties>("TpmProperties")
@@ -123,6 +228,25 @@ EMSCRIPTEN_BINDINGS(TPM) {
     .field("ecdsa_s", &tpm_js::SignResult::ecdsa_s)
   ;
 
+  e::value_object<tpm_js::SignManyResult>("SignManyResult")
+    .field("rc", &tpm_js::SignManyResult::rc)
+    .field("count", &tpm_js::SignManyResult::count)
+    .field("sign_algo", &tpm_js::SignManyResult::sign_algo)
+    .field("hash_algo", &tpm_js::SignManyResult::hash_algo)
+    .field("signature_size", &tpm_js::SignManyResult::signature_size)
+    .field("signatures", &tpm_js::SignManyResult::signatures)
+  ;
+
+  e::value_object<EncryptDecryptStreamResult>("EncryptDecryptStreamResult")
+    .field("rc", &EncryptDecryptStreamResult::rc)
+    .field("iv", &EncryptDecryptStreamResult::iv)
+  ;
+
+  e::value_object<tpm_js::GetRandomStreamResult>("GetRandomStreamResult")
+    .field("rc", &tpm_js::GetRandomStreamResult::rc)
+    .field("random_bytes", &tpm_js::GetRandomStreamResult::random_bytes)
+  ;
+
   e::value_object<tpm_js::NvReadPublicResult>("NvReadPublicResult")
     .field("rc", &tpm_js::NvReadPublicResult::rc)
     .field("data_size", &tpm_js::NvReadPublicResult::data_size)
@@ -138,6 +262,8 @@ EMSCRIPTEN_BINDINGS(TPM) {
     .field("sign_algo", &tpm_js::QuoteResult::sign_algo)
     .field("hash_algo", &tpm_js::QuoteResult::hash_algo)
     .field("rsa_ssa_sig", &tpm_js::QuoteResult::rsa_ssa_sig)
+    .field("ecdsa_r", &tpm_js::QuoteResult::ecdsa_r)
+    .field("ecdsa_s", &tpm_js::QuoteResult::ecdsa_s)
     .field("tpm2b_attest", &tpm_js::QuoteResult::tpm2b_attest)
   ;
 
@@ -150,6 +276,23 @@ EMSCRIPTEN_BINDINGS(TPM) {
     .field("selected_pcr_digest", &tpm_js::AttestInfo::selected_pcr_digest)
   ;
 
+  e::value_object<tpm_js::PublicKey>("PublicKey")
+    .field("type", &tpm_js::PublicKey::type)
+    .field("rsa_public_n", &tpm_js::PublicKey::rsa_public_n)
+    .field("ecc_public_x", &tpm_js::PublicKey::ecc_public_x)
+    .field("ecc_public_y", &tpm_js::PublicKey::ecc_public_y)
+    .field("ecc_curve_id", &tpm_js::PublicKey::ecc_curve_id)
+  ;
+
+  e::value_object<tpm_js::SignatureToVerify>("SignatureToVerify")
+    .field("key_index", &tpm_js::SignatureToVerify::key_index)
+    .field("digest", &tpm_js::SignatureToVerify::digest)
+    .field("sign_algo", &tpm_js::SignatureToVerify::sign_algo)
+    .field("rsa_ssa_sig", &tpm_js::SignatureToVerify::rsa_ssa_sig)
+    .field("ecdsa_r", &tpm_js::SignatureToVerify::ecdsa_r)
+    .field("ecdsa_s", &tpm_js::SignatureToVerify::ecdsa_s)
+  ;
+
   e::value_object<tpm_js::UnsealResult>("UnsealResult")
     .field("rc", &tpm_js::UnsealResult::rc)
     .field("sensitive_data", &tpm_js::UnsealResult::sensitive_data)
@@ -167,6 +310,41 @@ EMSCRIPTEN_BINDINGS(TPM) {
     .field("tpm2b_public", &tpm_js::ImportResult::tpm2b_public)
   ;
 
+  e::enum_<tpm_js::BatchOperationType>("BatchOperationType")
+    .value("kBatchExtendPcr", tpm_js::kBatchExtendPcr)
+    .value("kBatchSign", tpm_js::kBatchSign)
+    .value("kBatchNvRead", tpm_js::kBatchNvRead)
+  ;
+
+  e::value_object<tpm_js::BatchOperation>("BatchOperation")
+    .field("type", &tpm_js::BatchOperation::type)
+    .field("handle", &tpm_js::BatchOperation::handle)
+    .field("param", &tpm_js::BatchOperation::param)
+    .field("offset", &tpm_js::BatchOperation::offset)
+    .field("data", &tpm_js::BatchOperation::data)
+  ;
+
+  e::value_object<tpm_js::BatchResult>("BatchResult")
+    .field("rc", &tpm_js::BatchResult::rc)
+    .field("output_size", &tpm_js::BatchResult::output_size)
+    .field("output", &tpm_js::BatchResult::output)
+  ;
+
+  e::value_object<tpm_js::ReplayResult>("ReplayResult")
+    .field("rc", &tpm_js::ReplayResult::rc)
+    .field("pcr_values", &tpm_js::ReplayResult::pcr_values)
+  ;
+
+  e::class_<tpm_js::EventLog>("EventLog")
+    .constructor<>()
+    .function("Append", &tpm_js::EventLog::Append)
+    .function("Clear", &tpm_js::EventLog::Clear)
+    .function("GetEventCount", &tpm_js::EventLog::GetEventCount)
+    .function("Serialize", &tpm_js::EventLog::Serialize)
+    .function("Replay", &tpm_js::EventLog::Replay)
+    .class_function("ReplayLogs", &tpm_js::EventLog::ReplayLogs)
+  ;
+
   e::class_<tpm_js::KeyedHash>("KeyedHash")
     .constructor<const std::string&>()
     .function("GetEncodedPrivate", &tpm_js::KeyedHash::GetEncodedPrivate)
@@ -174,6 +352,53 @@ EMSCRIPTEN_BINDINGS(TPM) {
     .function("GetEncodedPublicName", &tpm_js::KeyedHash::GetEncodedPublicName)
   ;
 
-  e::register_vector<unsigned char>("StdVectorOfBytes");
+  e::enum_<tpm_js::QuoteVerdict>("QuoteVerdict")
+    .value("kQuoteValid", tpm_js::kQuoteValid)
+    .value("kQuoteMalformed", tpm_js::kQuoteMalformed)
+    .value("kQuoteBadKey", tpm_js::kQuoteBadKey)
+    .value("kQuoteBadNonce", tpm_js::kQuoteBadNonce)
+    .value("kQuotePcrMismatch", tpm_js::kQuotePcrMismatch)
+    .value("kQuoteBadSignature", tpm_js::kQuoteBadSignature)
+  ;
+
+  e::value_object<tpm_js::QuoteToVerify>("QuoteToVerify")
+    .field("key_index", &tpm_js::QuoteToVerify::key_index)
+    .field("quote", &tpm_js::QuoteToVerify::quote)
+    .field("pcr_values", &tpm_js::QuoteToVerify::pcr_values)
+    .field("nonce", &tpm_js::QuoteToVerify::nonce)
+  ;
+
+  e::class_<tpm_js::QuoteVerifier>("QuoteVerifier")
+    .constructor<>()
+    .function("AddKey", &tpm_js::QuoteVerifier::AddKey)
+    .function("Verify", &tpm_js::QuoteVerifier::Verify)
+  ;
+
+  e::value_object<tpm_js::SequenceCompleteResult>("SequenceCompleteResult")
+    .field("rc", &tpm_js::SequenceCompleteResult::rc)
+    .field("result", &tpm_js::SequenceCompleteResult::result)
+  ;
+
+  e::class_<tpm_js::HashSequence>("HashSequence")
+    .constructor<>()
+    .function("Start", &tpm_js::HashSequence::Start)
+    .function("Update", &HashSequenceUpdate)
+    .function("Complete", &tpm_js::HashSequence::Complete)
+  ;
+
+  e::class_<tpm_js::HmacSequence, e::base<tpm_js::HashSequence>>("HmacSequence")
+    .constructor<uint32_t>()
+  ;
+
+  // Internal, see the emsdk version pin at the top.
+  e::internal::_embind_register_emval(
+      e::internal::TypeID<std::vector<uint8_t>>::get(), "Uint8Array");
+  e::register_vector<std::vector<uint8_t>>("StdVectorOfByteVectors");
+  e::register_vector<tpm_js::ReplayResult>("StdVectorOfReplayResults");
+  e::register_vector<int>("StdVectorOfInts");
+  e::register_vector<tpm_js::BatchOperation>("StdVectorOfBatchOperations");
+  e::register_vector<tpm_js::PublicKey>("StdVectorOfPublicKeys");
+  e::register_vector<tpm_js::SignatureToVerify>("StdVectorOfSignaturesToVerify");
+  e::register_vector<tpm_js::QuoteToVerify>("StdVectorOfQuotesToVerify");
 }
 // clang-format on
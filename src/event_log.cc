@@ -0,0 +1,303 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "event_log.h"
+
+#include <cstring>
+#include <map>
+
+#include "tss2_tpm2_types.h"
+
+#include "openssl/sha.h"
+
+#include "thread_pool.h"
+
+namespace tpm_js {
+namespace {
+
+// Signature of the TCG_EfiSpecIDEvent that starts a crypto-agile log.
+constexpr char kSpecIdSignature[16] = "Spec ID Event03";
+
+// Size of the SHA1 digest in the TCG_PCR_EVENT header of the log.
+constexpr size_t kSha1DigestSize = 20;
+
+// Little-endian writer of the log fields.
+void AppendUint8(uint8_t value, std::vector<uint8_t> *out) {
+  out->push_back(value);
+}
+
+void AppendUint16(uint16_t value, std::vector<uint8_t> *out) {
+  out->push_back(value);
+  out->push_back(value >> 8);
+}
+
+void AppendUint32(uint32_t value, std::vector<uint8_t> *out) {
+  AppendUint16(value, out);
+  AppendUint16(value >> 16, out);
+}
+
+void AppendBytes(const uint8_t *data, size_t size, std::vector<uint8_t> *out) {
+  out->insert(out->end(), data, data + size);
+}
+
+// Little-endian reader of the log fields. Reads fail past the end of the log.
+class Reader {
+public:
+  explicit Reader(const std::vector<uint8_t> &data)
+      : data_(data.data()), left_(data.size()) {}
+
+  bool Done() const { return left_ == 0; }
+
+  bool ReadUint8(uint8_t *value) {
+    if (left_ < 1) {
+      return false;
+    }
+    *value = data_[0];
+    Skip(1);
+    return true;
+  }
+
+  bool ReadUint16(uint16_t *value) {
+    if (left_ < 2) {
+      return false;
+    }
+    *value = data_[0] | (data_[1] << 8);
+    Skip(2);
+    return true;
+  }
+
+  bool ReadUint32(uint32_t *value) {
+    uint16_t low, high;
+    if (!ReadUint16(&low) || !ReadUint16(&high)) {
+      return false;
+    }
+    *value = low | (static_cast<uint32_t>(high) << 16);
+    return true;
+  }
+
+  bool ReadBytes(size_t size, std::vector<uint8_t> *bytes) {
+    if (left_ < size) {
+      return false;
+    }
+    bytes->assign(data_, data_ + size);
+    Skip(size);
+    return true;
+  }
+
+  bool SkipBytes(size_t size) {
+    if (left_ < size) {
+      return false;
+    }
+    Skip(size);
+    return true;
+  }
+
+private:
+  void Skip(size_t size) {
+    data_ += size;
+    left_ -= size;
+  }
+
+  const uint8_t *data_;
+  size_t left_;
+};
+
+// Parses the TCG_EfiSpecIDEvent data into digest sizes by algorithm.
+bool ParseSpecIdEvent(const std::vector<uint8_t> &data,
+                      std::map<uint16_t, uint16_t> *digest_sizes) {
+  Reader reader(data);
+  std::vector<uint8_t> signature;
+  uint32_t num_algorithms;
+  uint8_t vendor_info_size;
+  if (!reader.ReadBytes(sizeof(kSpecIdSignature), &signature) ||
+      memcmp(signature.data(), kSpecIdSignature, sizeof(kSpecIdSignature)) !=
+          0 ||
+      // platformClass, specVersionMinor, specVersionMajor, specErrata and
+      // uintnSize.
+      !reader.SkipBytes(8) || !reader.ReadUint32(&num_algorithms)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_algorithms; ++i) {
+    uint16_t algorithm, size;
+    if (!reader.ReadUint16(&algorithm) || !reader.ReadUint16(&size)) {
+      return false;
+    }
+    (*digest_sizes)[algorithm] = size;
+  }
+  return reader.ReadUint8(&vendor_info_size) &&
+         reader.SkipBytes(vendor_info_size) &&
+         digest_sizes->count(TPM2_ALG_SHA256) &&
+         (*digest_sizes)[TPM2_ALG_SHA256] == TPM2_SHA256_DIGEST_SIZE;
+}
+
+// Sets value to the initial value of pcr.
+void InitPcr(uint32_t pcr, uint8_t *value) {
+  memset(value, (pcr >= 17 && pcr <= 22) ? 0xFF : 0, TPM2_SHA256_DIGEST_SIZE);
+}
+
+} // namespace
+
+EventLog::EventLog() {}
+
+EventLog::~EventLog() {}
+
+int EventLog::Append(int pcr, uint32_t event_type,
+                     const std::vector<uint8_t> &digest,
+                     const std::vector<uint8_t> &event_data) {
+  // Also called from JavaScript, so invalid arguments are not asserted.
+  if (pcr < 0 || pcr >= kEventLogNumPcrs ||
+      digest.size() != TPM2_SHA256_DIGEST_SIZE) {
+    return TPM2_RC_VALUE;
+  }
+  events_.push_back({static_cast<uint32_t>(pcr), event_type, digest,
+                     event_data});
+  return TPM2_RC_SUCCESS;
+}
+
+void EventLog::Clear() { events_.clear(); }
+
+int EventLog::GetEventCount() const { return events_.size(); }
+
+std::vector<uint8_t> EventLog::Serialize() const {
+  std::vector<uint8_t> spec_id;
+  AppendBytes(reinterpret_cast<const uint8_t *>(kSpecIdSignature),
+              sizeof(kSpecIdSignature), &spec_id);
+  AppendUint32(0, &spec_id); // platformClass: client.
+  AppendUint8(0, &spec_id);  // specVersionMinor.
+  AppendUint8(2, &spec_id);  // specVersionMajor.
+  AppendUint8(0, &spec_id);  // specErrata.
+  AppendUint8(2, &spec_id);  // uintnSize: UINT64.
+  AppendUint32(1, &spec_id); // numberOfAlgorithms.
+  AppendUint16(TPM2_ALG_SHA256, &spec_id);
+  AppendUint16(TPM2_SHA256_DIGEST_SIZE, &spec_id);
+  AppendUint8(0, &spec_id); // vendorInfoSize.
+
+  std::vector<uint8_t> out;
+  // TCG_PCR_EVENT header.
+  AppendUint32(0, &out);
+  AppendUint32(kEventNoAction, &out);
+  out.resize(out.size() + kSha1DigestSize, 0);
+  AppendUint32(spec_id.size(), &out);
+  AppendBytes(spec_id.data(), spec_id.size(), &out);
+
+  for (const Event &event : events_) {
+    // TCG_PCR_EVENT2.
+    AppendUint32(event.pcr, &out);
+    AppendUint32(event.type, &out);
+    AppendUint32(1, &out);
+    AppendUint16(TPM2_ALG_SHA256, &out);
+    AppendBytes(event.digest.data(), event.digest.size(), &out);
+    AppendUint32(event.data.size(), &out);
+    AppendBytes(event.data.data(), event.data.size(), &out);
+  }
+  return out;
+}
+
+bool EventLog::Parse(const std::vector<uint8_t> &serialized, EventLog *log) {
+  log->Clear();
+  Reader reader(serialized);
+
+  uint32_t pcr, type, size;
+  std::vector<uint8_t> spec_id;
+  std::map<uint16_t, uint16_t> digest_sizes;
+  if (!reader.ReadUint32(&pcr) || !reader.ReadUint32(&type) ||
+      type != kEventNoAction || !reader.SkipBytes(kSha1DigestSize) ||
+      !reader.ReadUint32(&size) || !reader.ReadBytes(size, &spec_id) ||
+      !ParseSpecIdEvent(spec_id, &digest_sizes)) {
+    return false;
+  }
+
+  while (!reader.Done()) {
+    Event event;
+    uint32_t num_digests;
+    if (!reader.ReadUint32(&event.pcr) || event.pcr >= kEventLogNumPcrs ||
+        !reader.ReadUint32(&event.type) || !reader.ReadUint32(&num_digests)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < num_digests; ++i) {
+      uint16_t algorithm;
+      if (!reader.ReadUint16(&algorithm) || !digest_sizes.count(algorithm)) {
+        return false;
+      }
+      if (algorithm == TPM2_ALG_SHA256) {
+        if (!reader.ReadBytes(TPM2_SHA256_DIGEST_SIZE, &event.digest)) {
+          return false;
+        }
+      } else if (!reader.SkipBytes(digest_sizes[algorithm])) {
+        return false;
+      }
+    }
+    if (event.digest.empty() || !reader.ReadUint32(&size) ||
+        !reader.ReadBytes(size, &event.data)) {
+      return false;
+    }
+    log->events_.push_back(std::move(event));
+  }
+  return true;
+}
+
+void EventLog::ReplayPcr(uint32_t pcr, uint8_t *value) const {
+  for (const Event &event : events_) {
+    if (event.pcr != pcr || event.type == kEventNoAction) {
+      continue;
+    }
+    SHA256_CTX sha;
+    SHA256_Init(&sha);
+    SHA256_Update(&sha, value, TPM2_SHA256_DIGEST_SIZE);
+    SHA256_Update(&sha, event.digest.data(), event.digest.size());
+    SHA256_Final(value, &sha);
+  }
+}
+
+ReplayResult EventLog::Replay() const {
+  ReplayResult result;
+  result.rc = TPM2_RC_SUCCESS;
+  result.pcr_values.resize(kEventLogNumPcrs * TPM2_SHA256_DIGEST_SIZE);
+  ThreadPool::Get()->ParallelFor(kEventLogNumPcrs, [&](size_t pcr) {
+    uint8_t *value = &result.pcr_values[pcr * TPM2_SHA256_DIGEST_SIZE];
+    InitPcr(pcr, value);
+    ReplayPcr(pcr, value);
+  });
+  return result;
+}
+
+std::vector<ReplayResult>
+EventLog::ReplayLogs(const std::vector<std::vector<uint8_t>> &serialized_logs) {
+  std::vector<EventLog> logs(serialized_logs.size());
+  std::vector<ReplayResult> results(serialized_logs.size());
+  ThreadPool::Get()->ParallelFor(logs.size(), [&](size_t i) {
+    if (Parse(serialized_logs[i], &logs[i])) {
+      results[i].rc = TPM2_RC_SUCCESS;
+      results[i].pcr_values.resize(kEventLogNumPcrs * TPM2_SHA256_DIGEST_SIZE);
+    } else {
+      results[i].rc = TPM2_RC_VALUE;
+    }
+  });
+
+  ThreadPool::Get()->ParallelFor(
+      logs.size() * kEventLogNumPcrs, [&](size_t task) {
+        const size_t i = task / kEventLogNumPcrs;
+        const uint32_t pcr = task % kEventLogNumPcrs;
+        if (results[i].rc != TPM2_RC_SUCCESS) {
+          return;
+        }
+        uint8_t *value =
+            &results[i].pcr_values[pcr * TPM2_SHA256_DIGEST_SIZE];
+        InitPcr(pcr, value);
+        logs[i].ReplayPcr(pcr, value);
+      });
+  return results;
+}
+
+} // namespace tpm_js
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tpm_js {
+
+// Event types from the TCG PC Client Platform Firmware Profile.
+constexpr uint32_t kEventNoAction = 0x00000003;
+constexpr uint32_t kEventIpl = 0x0000000D;
+
+// Number of PCRs replayed by EventLog.
+constexpr int kEventLogNumPcrs = 24;
+
+struct ReplayResult {
+  // TPM2_RC_SUCCESS, or TPM2_RC_VALUE if the log does not parse.
+  int rc;
+  // Following fields are only valid if rc == TPM2_RC_SUCCESS.
+  // Expected SHA256 values of PCRs 0 to 23, back to back.
+  std::vector<uint8_t> pcr_values;
+};
+
+// Measurement log of SHA256 PCR extends, in the TCG crypto-agile format.
+class EventLog {
+public:
+  EventLog();
+  ~EventLog();
+
+  // Records an event whose SHA256 digest was extended into pcr. Returns
+  // TPM2_RC_SUCCESS, or TPM2_RC_VALUE without recording anything if pcr is
+  // not one of the kEventLogNumPcrs PCRs or digest is not a SHA256 digest.
+  int Append(int pcr, uint32_t event_type, const std::vector<uint8_t> &digest,
+             const std::vector<uint8_t> &event_data);
+
+  // Removes all events, e.g. when the PCRs are reset.
+  void Clear();
+
+  int GetEventCount() const;
+
+  // Returns the log as a Spec ID event followed by one TCG_PCR_EVENT2 per
+  // event, each with a single SHA256 digest.
+  std::vector<uint8_t> Serialize() const;
+
+  // Parses a crypto-agile log, e.g. from Serialize or from firmware, into
+  // log. Keeps only the SHA256 digest of each event. Returns false if the log
+  // is malformed or has no SHA256 digests.
+  static bool Parse(const std::vector<uint8_t> &serialized, EventLog *log);
+
+  // Returns the PCR values the events extend to, replaying PCRs in parallel.
+  // PCRs start at zero, except PCRs 17 to 22, which start at all ones as they
+  // do in the simulator. kEventNoAction events are not extended.
+  ReplayResult Replay() const;
+
+  // Parses and replays serialized logs, in parallel across logs and PCRs.
+  static std::vector<ReplayResult>
+  ReplayLogs(const std::vector<std::vector<uint8_t>> &serialized_logs);
+
+private:
+  struct Event {
+    uint32_t pcr;
+    uint32_t type;
+    std::vector<uint8_t> digest;
+    std::vector<uint8_t> data;
+  };
+
+  // Replays events of pcr into value, which holds the initial value.
+  void ReplayPcr(uint32_t pcr, uint8_t *value) const;
+
+  std::vector<Event> events_;
+};
+
+} // namespace tpm_js
@@ -0,0 +1,118 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "event_log.h"
+
+#include <vector>
+
+#include "tss2_tpm2_types.h"
+
+#include <gtest/gtest.h>
+
+namespace tpm_js {
+namespace {
+
+// SHA256 digest of "hello".
+const std::vector<uint8_t> kHelloDigest = {
+    0x2c, 0xf2, 0x4d, 0xba, 0x5f, 0xb0, 0xa3, 0x0e, 0x26, 0xe8, 0x3b,
+    0x2a, 0xc5, 0xb9, 0xe2, 0x9e, 0x1b, 0x16, 0x1e, 0x5c, 0x1f, 0xa7,
+    0x42, 0x5e, 0x73, 0x04, 0x33, 0x62, 0x93, 0x8b, 0x98, 0x24};
+
+// SHA256 of 32 zero bytes followed by kHelloDigest.
+const std::vector<uint8_t> kHelloPcr = {
+    0x98, 0x51, 0x31, 0x20, 0x28, 0x95, 0x25, 0x21, 0x51, 0x0e, 0x8e,
+    0xaa, 0xb5, 0xbe, 0x94, 0xe7, 0xdc, 0x24, 0xb5, 0xfc, 0x29, 0x2b,
+    0x2e, 0x97, 0x81, 0x17, 0x3c, 0xf1, 0x1f, 0xfa, 0x98, 0x78};
+
+std::vector<uint8_t> GetPcr(const ReplayResult &result, int pcr) {
+  auto begin = result.pcr_values.begin() + pcr * TPM2_SHA256_DIGEST_SIZE;
+  return std::vector<uint8_t>(begin, begin + TPM2_SHA256_DIGEST_SIZE);
+}
+
+TEST(EventLogTest, RejectsInvalidEvents) {
+  EventLog log;
+  EXPECT_EQ(TPM2_RC_VALUE, log.Append(-1, kEventIpl, kHelloDigest, {}));
+  EXPECT_EQ(TPM2_RC_VALUE,
+            log.Append(kEventLogNumPcrs, kEventIpl, kHelloDigest, {}));
+  EXPECT_EQ(TPM2_RC_VALUE, log.Append(0, kEventIpl, {1, 2, 3}, {}));
+  EXPECT_EQ(0, log.GetEventCount());
+}
+
+TEST(EventLogTest, ReplaysEvents) {
+  EventLog log;
+  EXPECT_EQ(TPM2_RC_SUCCESS,
+            log.Append(1, kEventIpl, kHelloDigest, {'h', 'e', 'l', 'l', 'o'}));
+  EXPECT_EQ(TPM2_RC_SUCCESS, log.Append(2, kEventNoAction, kHelloDigest, {}));
+  EXPECT_EQ(2, log.GetEventCount());
+
+  ReplayResult result = log.Replay();
+  EXPECT_EQ(TPM2_RC_SUCCESS, result.rc);
+  ASSERT_EQ(kEventLogNumPcrs * TPM2_SHA256_DIGEST_SIZE,
+            result.pcr_values.size());
+  const std::vector<uint8_t> kZeros(TPM2_SHA256_DIGEST_SIZE, 0);
+  const std::vector<uint8_t> kOnes(TPM2_SHA256_DIGEST_SIZE, 0xFF);
+  EXPECT_EQ(kZeros, GetPcr(result, 0));
+  EXPECT_EQ(kHelloPcr, GetPcr(result, 1));
+  EXPECT_EQ(kZeros, GetPcr(result, 2));
+  EXPECT_EQ(kOnes, GetPcr(result, 17));
+  EXPECT_EQ(kZeros, GetPcr(result, 23));
+}
+
+TEST(EventLogTest, SerializesAndParses) {
+  EventLog log;
+  for (int i = 0; i < 100; ++i) {
+    log.Append(i % 8, kEventIpl, kHelloDigest, std::vector<uint8_t>(i, i));
+  }
+  std::vector<uint8_t> serialized = log.Serialize();
+  // TCG_PCR_EVENT header of the Spec ID event.
+  EXPECT_EQ(kEventNoAction, serialized[4]);
+
+  EventLog parsed;
+  ASSERT_TRUE(EventLog::Parse(serialized, &parsed));
+  EXPECT_EQ(100, parsed.GetEventCount());
+  EXPECT_EQ(serialized, parsed.Serialize());
+  EXPECT_EQ(log.Replay().pcr_values, parsed.Replay().pcr_values);
+
+  serialized.pop_back();
+  EXPECT_FALSE(EventLog::Parse(serialized, &parsed));
+  EXPECT_FALSE(EventLog::Parse({}, &parsed));
+}
+
+TEST(EventLogTest, ReplaysLogsInBulk) {
+  std::vector<std::vector<uint8_t>> serialized_logs;
+  std::vector<ReplayResult> expected;
+  for (int i = 0; i < 10; ++i) {
+    EventLog log;
+    for (int j = 0; j < i; ++j) {
+      log.Append(j % 3, kEventIpl, kHelloDigest, {});
+    }
+    serialized_logs.push_back(log.Serialize());
+    expected.push_back(log.Replay());
+  }
+  serialized_logs[5].resize(10);
+
+  std::vector<ReplayResult> results = EventLog::ReplayLogs(serialized_logs);
+  ASSERT_EQ(10, results.size());
+  for (int i = 0; i < 10; ++i) {
+    if (i == 5) {
+      EXPECT_EQ(TPM2_RC_VALUE, results[i].rc);
+      continue;
+    }
+    EXPECT_EQ(TPM2_RC_SUCCESS, results[i].rc);
+    EXPECT_EQ(expected[i].pcr_values, results[i].pcr_values);
+  }
+}
+
+} // namespace
+} // namespace tpm_js
@@ -0,0 +1,119 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "hash_sequence.h"
+
+#include <algorithm>
+
+namespace tpm_js {
+namespace {
+
+// Size of the chunks sent with each TPM2_SequenceUpdate.
+constexpr size_t kChunkSize = sizeof(TPM2B_MAX_BUFFER::buffer);
+
+} // namespace
+
+HashSequence::HashSequence() : handle_(0) { pending_.reserve(kChunkSize); }
+
+HashSequence::~HashSequence() {
+  if (handle_) {
+    App::Get()->FlushContext(handle_);
+  }
+}
+
+int HashSequence::Fail(int rc) {
+  // Part of the input may have reached the TPM: the sequence cannot go on.
+  SetHandle(0);
+  return rc;
+}
+
+int HashSequence::Start() {
+  SequenceStartResult result = App::Get()->HashSequenceStart();
+  if (result.rc == TPM2_RC_SUCCESS) {
+    SetHandle(result.handle);
+  }
+  return result.rc;
+}
+
+void HashSequence::SetHandle(uint32_t handle) {
+  if (handle_) {
+    App::Get()->FlushContext(handle_);
+  }
+  handle_ = handle;
+  pending_.clear();
+}
+
+int HashSequence::Update(const uint8_t *data, size_t size) {
+  // Also called from JavaScript, so a sequence not started is not asserted.
+  if (!handle_) {
+    return TPM2_RC_SEQUENCE;
+  }
+  App *app = App::Get();
+  // Top up the held back chunk first, and send it once more input follows.
+  if (!pending_.empty() && pending_.size() < kChunkSize) {
+    const size_t fill = std::min(size, kChunkSize - pending_.size());
+    pending_.insert(pending_.end(), data, data + fill);
+    data += fill;
+    size -= fill;
+  }
+  if (size == 0) {
+    return TPM2_RC_SUCCESS;
+  }
+  if (!pending_.empty()) {
+    int rc = app->SequenceUpdate(handle_, pending_.data(), pending_.size());
+    pending_.clear();
+    if (rc != TPM2_RC_SUCCESS) {
+      return Fail(rc);
+    }
+  }
+  // Send all full chunks but the last one from data, without holding them
+  // back in pending_.
+  const size_t head_size = (size - 1) / kChunkSize * kChunkSize;
+  int rc = app->SequenceUpdate(handle_, data, head_size);
+  if (rc != TPM2_RC_SUCCESS) {
+    return Fail(rc);
+  }
+  pending_.assign(data + head_size, data + size);
+  return TPM2_RC_SUCCESS;
+}
+
+SequenceCompleteResult HashSequence::Complete() {
+  if (!handle_) {
+    SequenceCompleteResult result = {};
+    result.rc = TPM2_RC_SEQUENCE;
+    return result;
+  }
+  SequenceCompleteResult result =
+      App::Get()->SequenceComplete(handle_, pending_.data(), pending_.size());
+  // The TPM flushes the sequence once it completes.
+  if (result.rc == TPM2_RC_SUCCESS) {
+    handle_ = 0;
+    pending_.clear();
+  } else {
+    Fail(result.rc);
+  }
+  return result;
+}
+
+HmacSequence::HmacSequence(uint32_t key_handle) : key_handle_(key_handle) {}
+
+int HmacSequence::Start() {
+  SequenceStartResult result = App::Get()->HmacStart(key_handle_);
+  if (result.rc == TPM2_RC_SUCCESS) {
+    SetHandle(result.handle);
+  }
+  return result.rc;
+}
+
+} // namespace tpm_js
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "app.h"
+
+namespace tpm_js {
+
+// Streams input of any length into a TPM SHA256 hash sequence. Full
+// TPM2B_MAX_BUFFER sized chunks are passed on to App::SequenceUpdate as they
+// come. At most one chunk is held back, so the last chunk is sent along with
+// TPM2_SequenceComplete instead of in a TPM2_SequenceUpdate of its own.
+class HashSequence {
+public:
+  HashSequence();
+  // Flushes the sequence if it was started but not completed.
+  virtual ~HashSequence();
+
+  // Starts the sequence with App::HashSequenceStart.
+  virtual int Start();
+
+  // Feeds size bytes at data to the sequence. Stops at the first failing
+  // TPM2_SequenceUpdate and returns its rc. Returns TPM2_RC_SEQUENCE if the
+  // sequence is not started. A failure flushes the sequence, which must be
+  // started again.
+  int Update(const uint8_t *data, size_t size);
+
+  // Completes the sequence. Returns the SHA256 digest, or the HMAC for an
+  // HmacSequence, of all bytes fed to Update. The sequence may be started
+  // again afterwards. Returns TPM2_RC_SEQUENCE if the sequence is not started.
+  // A failure flushes the sequence too.
+  SequenceCompleteResult Complete();
+
+protected:
+  // Called by Start with the handle of the started sequence.
+  void SetHandle(uint32_t handle);
+
+private:
+  // Flushes the sequence after a failed TPM call and returns rc.
+  int Fail(int rc);
+
+  // Handle of the started sequence, or 0 if not started.
+  uint32_t handle_;
+  // Input not yet sent to the TPM, up to one chunk.
+  std::vector<uint8_t> pending_;
+};
+
+// Streams input of any length into a TPM HMAC sequence, the same way as
+// HashSequence.
+class HmacSequence : public HashSequence {
+public:
+  // key_handle should be a handle of a loaded TPM2_ALG_KEYEDHASH key created
+  // unrestricted with sign set and decrypt clear.
+  explicit HmacSequence(uint32_t key_handle);
+
+  // Starts the sequence with App::HmacStart.
+  int Start() override;
+
+private:
+  uint32_t key_handle_;
+};
+
+} // namespace tpm_js
@@ -0,0 +1,177 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "hash_sequence.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "app.h"
+#include "simulator.h"
+
+#include <gtest/gtest.h>
+
+namespace tpm_js {
+namespace {
+
+// SHA256 digest of "".
+const std::vector<uint8_t> kEmptyDigest = {
+    0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4,
+    0xc8, 0x99, 0x6f, 0xb9, 0x24, 0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b,
+    0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55};
+
+// SHA256 digest of one million 'a', from FIPS 180-2.
+const std::vector<uint8_t> kMillionADigest = {
+    0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1, 0xc7,
+    0xe2, 0x84, 0xd7, 0x3e, 0x67, 0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97,
+    0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0};
+
+// HashSequence that exposes its handle, to flush it behind its back.
+class ExposedHashSequence : public HashSequence {
+public:
+  int Start() override {
+    SequenceStartResult result = App::Get()->HashSequenceStart();
+    if (result.rc == TPM2_RC_SUCCESS) {
+      handle = result.handle;
+      SetHandle(result.handle);
+    }
+    return result.rc;
+  }
+
+  uint32_t handle = 0;
+};
+
+class HashSequenceTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Simulator::PowerOff();
+    Simulator::PowerOn();
+    Simulator::ManufactureReset();
+    EXPECT_EQ(TPM2_RC_SUCCESS, App::Get()->Startup());
+  }
+
+  void TearDown() override { Simulator::PowerOff(); }
+
+  // Feeds data to sequence in pieces of increasing sizes, which straddle the
+  // chunk boundaries in all sorts of ways, and completes it.
+  SequenceCompleteResult HashInPieces(HashSequence *sequence,
+                                      const std::vector<uint8_t> &data) {
+    EXPECT_EQ(TPM2_RC_SUCCESS, sequence->Start());
+    size_t offset = 0;
+    for (size_t piece = 0; offset < data.size(); piece = piece * 2 + 1) {
+      const size_t size = std::min(piece, data.size() - offset);
+      EXPECT_EQ(TPM2_RC_SUCCESS, sequence->Update(data.data() + offset, size));
+      offset += size;
+    }
+    return sequence->Complete();
+  }
+};
+
+TEST_F(HashSequenceTest, HashesInputOfAnySize) {
+  HashSequence sequence;
+  SequenceCompleteResult result = HashInPieces(&sequence, {});
+  EXPECT_EQ(TPM2_RC_SUCCESS, result.rc);
+  EXPECT_EQ(kEmptyDigest, result.result);
+
+  const std::vector<uint8_t> kMillionA(1000000, 'a');
+  result = HashInPieces(&sequence, kMillionA);
+  EXPECT_EQ(TPM2_RC_SUCCESS, result.rc);
+  EXPECT_EQ(kMillionADigest, result.result);
+
+  // A single update of the whole input.
+  EXPECT_EQ(TPM2_RC_SUCCESS, sequence.Start());
+  EXPECT_EQ(TPM2_RC_SUCCESS,
+            sequence.Update(kMillionA.data(), kMillionA.size()));
+  result = sequence.Complete();
+  EXPECT_EQ(TPM2_RC_SUCCESS, result.rc);
+  EXPECT_EQ(kMillionADigest, result.result);
+}
+
+TEST_F(HashSequenceTest, FailsWhenNotStarted) {
+  HashSequence sequence;
+  const uint8_t data[] = {1, 2, 3};
+  EXPECT_EQ(TPM2_RC_SEQUENCE, sequence.Update(data, sizeof(data)));
+  EXPECT_EQ(TPM2_RC_SEQUENCE, sequence.Complete().rc);
+
+  // Completing a sequence ends it.
+  EXPECT_EQ(TPM2_RC_SUCCESS, sequence.Start());
+  EXPECT_EQ(TPM2_RC_SUCCESS, sequence.Complete().rc);
+  EXPECT_EQ(TPM2_RC_SEQUENCE, sequence.Update(data, sizeof(data)));
+}
+
+TEST_F(HashSequenceTest, EndsOnFailure) {
+  ExposedHashSequence sequence;
+  const std::vector<uint8_t> data(3 * sizeof(TPM2B_MAX_BUFFER::buffer), 'a');
+
+  // A failed update ends the sequence instead of skipping input.
+  EXPECT_EQ(TPM2_RC_SUCCESS, sequence.Start());
+  EXPECT_EQ(TPM2_RC_SUCCESS, App::Get()->FlushContext(sequence.handle));
+  EXPECT_NE(TPM2_RC_SUCCESS, sequence.Update(data.data(), data.size()));
+  EXPECT_EQ(TPM2_RC_SEQUENCE, sequence.Update(data.data(), data.size()));
+  EXPECT_EQ(TPM2_RC_SEQUENCE, sequence.Complete().rc);
+
+  // So does a failed completion.
+  EXPECT_EQ(TPM2_RC_SUCCESS, sequence.Start());
+  EXPECT_EQ(TPM2_RC_SUCCESS, App::Get()->FlushContext(sequence.handle));
+  EXPECT_NE(TPM2_RC_SUCCESS, sequence.Complete().rc);
+  EXPECT_EQ(TPM2_RC_SEQUENCE, sequence.Complete().rc);
+
+  // The sequence starts over.
+  EXPECT_EQ(TPM2_RC_SUCCESS, sequence.Start());
+  SequenceCompleteResult result = sequence.Complete();
+  EXPECT_EQ(TPM2_RC_SUCCESS, result.rc);
+  EXPECT_EQ(kEmptyDigest, result.result);
+}
+
+TEST_F(HashSequenceTest, ComputesHmac) {
+  App *app = App::Get();
+  CreatePrimaryResult primary =
+      app->CreatePrimary(TPM2_RH_OWNER, TPM2_ALG_KEYEDHASH, /*restricted=*/0,
+                         /*decrypt=*/0, /*sign=*/1, /*unique=*/"",
+                         /*user_auth=*/"", /*sensitive_data=*/"",
+                         /*auth_policy=*/{});
+  ASSERT_EQ(TPM2_RC_SUCCESS, primary.rc);
+
+  std::vector<uint8_t> data(5000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = i * 7;
+  }
+  HmacSequence sequence(primary.handle);
+  SequenceCompleteResult pieces = HashInPieces(&sequence, data);
+  EXPECT_EQ(TPM2_RC_SUCCESS, pieces.rc);
+  EXPECT_EQ(TPM2_SHA256_DIGEST_SIZE, pieces.result.size());
+
+  EXPECT_EQ(TPM2_RC_SUCCESS, sequence.Start());
+  EXPECT_EQ(TPM2_RC_SUCCESS, sequence.Update(data.data(), data.size()));
+  SequenceCompleteResult whole = sequence.Complete();
+  EXPECT_EQ(TPM2_RC_SUCCESS, whole.rc);
+  EXPECT_EQ(pieces.result, whole.result);
+
+  // The HMAC depends on the key, unlike the digest.
+  HashSequence hash;
+  EXPECT_NE(HashInPieces(&hash, data).result, whole.result);
+
+  // Only signing keys can start an HMAC sequence.
+  CreatePrimaryResult sealed =
+      app->CreatePrimary(TPM2_RH_OWNER, TPM2_ALG_KEYEDHASH, /*restricted=*/0,
+                         /*decrypt=*/0, /*sign=*/0, /*unique=*/"",
+                         /*user_auth=*/"", /*sensitive_data=*/"secret-data",
+                         /*auth_policy=*/{});
+  ASSERT_EQ(TPM2_RC_SUCCESS, sealed.rc);
+  HmacSequence bad_sequence(sealed.handle);
+  EXPECT_NE(TPM2_RC_SUCCESS, bad_sequence.Start());
+}
+
+} // namespace
+} // namespace tpm_js
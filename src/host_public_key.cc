@@ -0,0 +1,115 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "host_public_key.h"
+
+#include "tss2_tpm2_types.h"
+
+#include "openssl/bn.h"
+#include "openssl/ecdsa.h"
+#include "openssl/nid.h"
+
+namespace tpm_js {
+namespace {
+
+constexpr uint32_t kDefaultRsaExponent = 65537;
+
+bssl::UniquePtr<RSA> NewRsaPublicKey(const std::vector<uint8_t> &n) {
+  bssl::UniquePtr<RSA> rsa(RSA_new());
+  bssl::UniquePtr<BIGNUM> bn_n(BN_bin2bn(n.data(), n.size(), nullptr));
+  bssl::UniquePtr<BIGNUM> bn_e(BN_new());
+  if (!rsa || !bn_n || !bn_e || !BN_set_word(bn_e.get(), kDefaultRsaExponent) ||
+      !RSA_set0_key(rsa.get(), bn_n.get(), bn_e.get(), /*d=*/nullptr)) {
+    return nullptr;
+  }
+  // rsa owns them now.
+  bn_n.release();
+  bn_e.release();
+  return rsa;
+}
+
+bssl::UniquePtr<EC_KEY> NewEcPublicKey(int curve_id,
+                                       const std::vector<uint8_t> &x,
+                                       const std::vector<uint8_t> &y) {
+  int nid;
+  switch (curve_id) {
+  case TPM2_ECC_NIST_P256:
+    nid = NID_X9_62_prime256v1;
+    break;
+  case TPM2_ECC_NIST_P384:
+    nid = NID_secp384r1;
+    break;
+  default:
+    return nullptr;
+  }
+  bssl::UniquePtr<EC_KEY> ec_key(EC_KEY_new_by_curve_name(nid));
+  bssl::UniquePtr<BIGNUM> bn_x(BN_bin2bn(x.data(), x.size(), nullptr));
+  bssl::UniquePtr<BIGNUM> bn_y(BN_bin2bn(y.data(), y.size(), nullptr));
+  if (!ec_key || !bn_x || !bn_y ||
+      !EC_KEY_set_public_key_affine_coordinates(ec_key.get(), bn_x.get(),
+                                                bn_y.get())) {
+    return nullptr;
+  }
+  return ec_key;
+}
+
+} // namespace
+
+HostPublicKey NewHostPublicKey(const PublicKey &key) {
+  HostPublicKey host_key;
+  if (key.type == TPM2_ALG_RSA) {
+    host_key.rsa = NewRsaPublicKey(key.rsa_public_n);
+  } else if (key.type == TPM2_ALG_ECC) {
+    host_key.ec_key =
+        NewEcPublicKey(key.ecc_curve_id, key.ecc_public_x, key.ecc_public_y);
+  }
+  return host_key;
+}
+
+int VerifyHostSignature(const HostPublicKey &key,
+                        const SignatureToVerify &signature) {
+  if (signature.digest.size() != TPM2_SHA256_DIGEST_SIZE) {
+    return TPM2_RC_SIZE;
+  }
+  if (signature.sign_algo == TPM2_ALG_RSASSA) {
+    if (!key.rsa) {
+      return key.ec_key ? TPM2_RC_SCHEME : TPM2_RC_KEY;
+    }
+    return RSA_verify(NID_sha256, signature.digest.data(),
+                      signature.digest.size(), signature.rsa_ssa_sig.data(),
+                      signature.rsa_ssa_sig.size(), key.rsa.get())
+               ? TPM2_RC_SUCCESS
+               : TPM2_RC_SIGNATURE;
+  }
+  if (signature.sign_algo == TPM2_ALG_ECDSA) {
+    if (!key.ec_key) {
+      return key.rsa ? TPM2_RC_SCHEME : TPM2_RC_KEY;
+    }
+    bssl::UniquePtr<ECDSA_SIG> sig(ECDSA_SIG_new());
+    if (!sig ||
+        !BN_bin2bn(signature.ecdsa_r.data(), signature.ecdsa_r.size(),
+                   sig->r) ||
+        !BN_bin2bn(signature.ecdsa_s.data(), signature.ecdsa_s.size(),
+                   sig->s)) {
+      return TPM2_RC_FAILURE;
+    }
+    return ECDSA_do_verify(signature.digest.data(), signature.digest.size(),
+                           sig.get(), key.ec_key.get())
+               ? TPM2_RC_SUCCESS
+               : TPM2_RC_SIGNATURE;
+  }
+  return TPM2_RC_SCHEME;
+}
+
+} // namespace tpm_js
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "openssl/ec_key.h"
+#include "openssl/rsa.h"
+
+#include "util.h"
+
+namespace tpm_js {
+
+// PublicKey in the form BoringSSL verifies with. At most one of rsa and
+// ec_key is set.
+struct HostPublicKey {
+  bssl::UniquePtr<RSA> rsa;
+  bssl::UniquePtr<EC_KEY> ec_key;
+};
+
+// Returns the host form of key. Neither field is set if key is unusable.
+HostPublicKey NewHostPublicKey(const PublicKey &key);
+
+// Verifies signature with key. Returns an rc as documented in
+// Util::VerifySignatures. Safe to call concurrently with the same key.
+int VerifyHostSignature(const HostPublicKey &key,
+                        const SignatureToVerify &signature);
+
+} // namespace tpm_js
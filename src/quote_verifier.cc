@@ -0,0 +1,121 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "quote_verifier.h"
+
+#include <cstring>
+
+#include "tss2_mu.h"
+
+#include "openssl/sha.h"
+
+#include "host_public_key.h"
+#include "thread_pool.h"
+
+namespace tpm_js {
+namespace {
+
+// Returns the number of PCRs selected in selection.
+size_t CountSelectedPcrs(const TPMS_PCR_SELECTION &selection) {
+  size_t count = 0;
+  for (int i = 0; i < selection.sizeofSelect; ++i) {
+    for (uint8_t bits = selection.pcrSelect[i]; bits != 0; bits &= bits - 1) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+} // namespace
+
+QuoteVerifier::QuoteVerifier() {}
+
+QuoteVerifier::~QuoteVerifier() {}
+
+int QuoteVerifier::AddKey(const PublicKey &key) {
+  keys_.emplace_back(new HostPublicKey(NewHostPublicKey(key)));
+  return keys_.size() - 1;
+}
+
+std::vector<int>
+QuoteVerifier::Verify(const std::vector<QuoteToVerify> &quotes) const {
+  std::vector<int> verdicts(quotes.size());
+  ThreadPool::Get()->ParallelFor(quotes.size(), [&](size_t i) {
+    verdicts[i] = VerifyQuote(quotes[i]);
+  });
+  return verdicts;
+}
+
+int QuoteVerifier::VerifyQuote(const QuoteToVerify &quote) const {
+  if (quote.quote.rc != TPM2_RC_SUCCESS) {
+    return kQuoteMalformed;
+  }
+  if (quote.key_index < 0 ||
+      static_cast<size_t>(quote.key_index) >= keys_.size()) {
+    return kQuoteBadKey;
+  }
+  const HostPublicKey &key = *keys_[quote.key_index];
+  if (!key.rsa && !key.ec_key) {
+    return kQuoteBadKey;
+  }
+
+  const std::vector<uint8_t> &attest_buffer = quote.quote.tpm2b_attest;
+  TPMS_ATTEST attest = {};
+  if (Tss2_MU_TPMS_ATTEST_Unmarshal(attest_buffer.data(), attest_buffer.size(),
+                                    nullptr, &attest) != TPM2_RC_SUCCESS ||
+      attest.magic != TPM2_GENERATED_VALUE ||
+      attest.type != TPM2_ST_ATTEST_QUOTE) {
+    return kQuoteMalformed;
+  }
+
+  if (attest.extraData.size != quote.nonce.size() ||
+      memcmp(attest.extraData.buffer, quote.nonce.data(),
+             quote.nonce.size()) != 0) {
+    return kQuoteBadNonce;
+  }
+
+  const TPML_PCR_SELECTION &pcr_select = attest.attested.quote.pcrSelect;
+  size_t num_pcrs = 0;
+  for (uint32_t i = 0; i < pcr_select.count; ++i) {
+    if (pcr_select.pcrSelections[i].hash != TPM2_ALG_SHA256) {
+      return kQuoteMalformed;
+    }
+    num_pcrs += CountSelectedPcrs(pcr_select.pcrSelections[i]);
+  }
+  const TPM2B_DIGEST &pcr_digest = attest.attested.quote.pcrDigest;
+  uint8_t expected_pcr_digest[SHA256_DIGEST_LENGTH];
+  SHA256(quote.pcr_values.data(), quote.pcr_values.size(),
+         expected_pcr_digest);
+  if (quote.pcr_values.size() != num_pcrs * TPM2_SHA256_DIGEST_SIZE ||
+      pcr_digest.size != sizeof(expected_pcr_digest) ||
+      memcmp(pcr_digest.buffer, expected_pcr_digest,
+             sizeof(expected_pcr_digest)) != 0) {
+    return kQuotePcrMismatch;
+  }
+
+  SignatureToVerify signature = {};
+  signature.digest.resize(SHA256_DIGEST_LENGTH);
+  SHA256(attest_buffer.data(), attest_buffer.size(), signature.digest.data());
+  signature.sign_algo = quote.quote.sign_algo;
+  signature.rsa_ssa_sig = quote.quote.rsa_ssa_sig;
+  signature.ecdsa_r = quote.quote.ecdsa_r;
+  signature.ecdsa_s = quote.quote.ecdsa_s;
+  if (quote.quote.hash_algo != TPM2_ALG_SHA256 ||
+      VerifyHostSignature(key, signature) != TPM2_RC_SUCCESS) {
+    return kQuoteBadSignature;
+  }
+  return kQuoteValid;
+}
+
+} // namespace tpm_js
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "app.h"
+#include "util.h"
+
+namespace tpm_js {
+
+struct HostPublicKey;
+
+// Verdicts of QuoteVerifier::Verify.
+enum QuoteVerdict {
+  kQuoteValid,
+  // The quote failed, tpm2b_attest does not unmarshal, is not a quote, or
+  // quotes a PCR bank other than SHA256.
+  kQuoteMalformed,
+  // key_index is unknown or the key is unusable.
+  kQuoteBadKey,
+  // The qualifying data is not the expected nonce.
+  kQuoteBadNonce,
+  // The quoted PCR digest does not match the expected PCR values.
+  kQuotePcrMismatch,
+  // The signature does not verify with the key.
+  kQuoteBadSignature,
+};
+
+struct QuoteToVerify {
+  // Index of the attestation key, as returned by QuoteVerifier::AddKey.
+  int key_index;
+  QuoteResult quote;
+  // Expected SHA256 values of the quoted PCRs, back to back, in the order of
+  // the PCR selection of the quote.
+  std::vector<uint8_t> pcr_values;
+  // Expected qualifying data of the quote.
+  std::vector<uint8_t> nonce;
+};
+
+// Verifies quotes on the host, spread over ThreadPool::Get(). Attestation keys
+// are added once and reused for every batch.
+class QuoteVerifier {
+public:
+  QuoteVerifier();
+  ~QuoteVerifier();
+
+  // Adds an attestation key and returns its index for QuoteToVerify.
+  int AddKey(const PublicKey &key);
+
+  // Unmarshals the TPMS_ATTEST of each quote, checks its nonce, recomputes
+  // its PCR digest from the expected PCR values and verifies its signature.
+  // Returns the QuoteVerdict of each quote, reporting the first failed check.
+  std::vector<int> Verify(const std::vector<QuoteToVerify> &quotes) const;
+
+private:
+  int VerifyQuote(const QuoteToVerify &quote) const;
+
+  std::vector<std::unique_ptr<HostPublicKey>> keys_;
+};
+
+} // namespace tpm_js
@@ -0,0 +1,110 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "quote_verifier.h"
+
+#include "app.h"
+#include "simulator.h"
+
+#include <gtest/gtest.h>
+
+namespace tpm_js {
+namespace {
+
+class QuoteVerifierTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Simulator::PowerOff();
+    Simulator::PowerOn();
+    Simulator::ManufactureReset();
+    EXPECT_EQ(TPM2_RC_SUCCESS, App::Get()->Startup());
+  }
+
+  void TearDown() override { Simulator::PowerOff(); }
+
+  // Creates a restricted signing key and adds it to verifier.
+  // Returns the key handle.
+  uint32_t CreateAttestationKey(int type, QuoteVerifier *verifier,
+                                int *key_index) {
+    CreatePrimaryResult primary =
+        App::Get()->CreatePrimary(TPM2_RH_OWNER, type, /*restricted=*/1,
+                                  /*decrypt=*/0, /*sign=*/1, /*unique=*/"",
+                                  /*user_auth=*/"", /*sensitive_data=*/"",
+                                  /*auth_policy=*/{});
+    EXPECT_EQ(TPM2_RC_SUCCESS, primary.rc);
+    PublicKey key = {};
+    key.type = type;
+    key.rsa_public_n = primary.rsa_public_n;
+    key.ecc_public_x = primary.ecc_public_x;
+    key.ecc_public_y = primary.ecc_public_y;
+    key.ecc_curve_id = primary.ecc_curve_id;
+    *key_index = verifier->AddKey(key);
+    return primary.handle;
+  }
+
+  // Returns the values of the PCRs App::Quote selects.
+  std::vector<uint8_t> GetQuotedPcrs() {
+    std::vector<uint8_t> pcrs;
+    for (int pcr = 0; pcr < 4; ++pcr) {
+      std::vector<uint8_t> value = Simulator::GetPcr(pcr);
+      pcrs.insert(pcrs.end(), value.begin(), value.end());
+    }
+    return pcrs;
+  }
+};
+
+TEST_F(QuoteVerifierTest, VerifiesQuotes) {
+  App *app = App::Get();
+  QuoteVerifier verifier;
+  int rsa_index, ecc_index;
+  uint32_t rsa_handle =
+      CreateAttestationKey(TPM2_ALG_RSA, &verifier, &rsa_index);
+  uint32_t ecc_handle =
+      CreateAttestationKey(TPM2_ALG_ECC, &verifier, &ecc_index);
+  EXPECT_EQ(TPM2_RC_SUCCESS, app->ExtendPcr(2, "boot"));
+
+  const std::string kNonce = "TestNonce";
+  QuoteToVerify quote = {};
+  quote.pcr_values = GetQuotedPcrs();
+  quote.nonce = std::vector<uint8_t>(kNonce.begin(), kNonce.end());
+  std::vector<QuoteToVerify> quotes;
+  quote.key_index = rsa_index;
+  quote.quote = app->Quote(rsa_handle, kNonce);
+  EXPECT_EQ(TPM2_ALG_RSASSA, quote.quote.sign_algo);
+  quotes.push_back(quote);
+  quote.key_index = ecc_index;
+  quote.quote = app->Quote(ecc_handle, kNonce);
+  EXPECT_EQ(TPM2_ALG_ECDSA, quote.quote.sign_algo);
+  quotes.push_back(quote);
+  EXPECT_EQ(std::vector<int>({kQuoteValid, kQuoteValid}),
+            verifier.Verify(quotes));
+
+  std::vector<QuoteToVerify> bad_quotes(6, quotes[0]);
+  bad_quotes[0].quote.tpm2b_attest.resize(10);
+  bad_quotes[1].key_index = 2;
+  bad_quotes[2].nonce.push_back('!');
+  bad_quotes[3].pcr_values[0] ^= 1;
+  bad_quotes[4].pcr_values.resize(32);
+  bad_quotes[5].key_index = ecc_index;
+  EXPECT_EQ(std::vector<int>({kQuoteMalformed, kQuoteBadKey, kQuoteBadNonce,
+                              kQuotePcrMismatch, kQuotePcrMismatch,
+                              kQuoteBadSignature}),
+            verifier.Verify(bad_quotes));
+
+  quotes[1].quote.ecdsa_s[0] ^= 1;
+  EXPECT_EQ(kQuoteBadSignature, verifier.Verify(quotes)[1]);
+}
+
+} // namespace
+} // namespace tpm_js
@@ -0,0 +1,434 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "resource_manager.h"
+
+#include <endian.h>
+#include <string.h>
+
+#include "log.h"
+
+namespace tpm_js {
+namespace {
+
+// Size of tag, size and command/response code.
+const size_t kHeaderSize = 10;
+
+// Virtual object handles live at the top of the transient range, away from
+// the handles the TPM assigns itself.
+const uint32_t kFirstVirtualHandle = 0x80ff0000;
+const uint32_t kLastVirtualHandle = 0x80ffffff;
+
+uint32_t ReadUint32(const std::vector<uint8_t> &buffer, size_t offset) {
+  uint32_t value;
+  memcpy(&value, buffer.data() + offset, sizeof(value));
+  return be32toh(value);
+}
+
+uint16_t ReadUint16(const std::vector<uint8_t> &buffer, size_t offset) {
+  uint16_t value;
+  memcpy(&value, buffer.data() + offset, sizeof(value));
+  return be16toh(value);
+}
+
+void WriteUint32(std::vector<uint8_t> *buffer, size_t offset, uint32_t value) {
+  value = htobe32(value);
+  memcpy(buffer->data() + offset, &value, sizeof(value));
+}
+
+void AppendUint32(std::vector<uint8_t> *buffer, uint32_t value) {
+  buffer->resize(buffer->size() + sizeof(value));
+  WriteUint32(buffer, buffer->size() - sizeof(value), value);
+}
+
+// Builds a command without sessions from its handle and parameter areas.
+std::vector<uint8_t> BuildCommand(TPM2_CC command_code,
+                                  const std::vector<uint8_t> &body) {
+  std::vector<uint8_t> command = {TPM2_ST_NO_SESSIONS >> 8,
+                                  TPM2_ST_NO_SESSIONS & 0xff};
+  AppendUint32(&command, kHeaderSize + body.size());
+  AppendUint32(&command, command_code);
+  command.insert(command.end(), body.begin(), body.end());
+  return command;
+}
+
+// Builds a response that carries nothing but rc.
+std::vector<uint8_t> BuildResponse(TPM2_RC rc) {
+  std::vector<uint8_t> response = {TPM2_ST_NO_SESSIONS >> 8,
+                                   TPM2_ST_NO_SESSIONS & 0xff};
+  AppendUint32(&response, kHeaderSize);
+  AppendUint32(&response, rc);
+  return response;
+}
+
+TPM2_RC GetResponseCode(const std::vector<uint8_t> &response) {
+  if (response.size() < kHeaderSize) {
+    return TPM2_RC_FAILURE;
+  }
+  return ReadUint32(response, 6);
+}
+
+bool IsTransientHandle(uint32_t handle) {
+  return (handle >> TPM2_HR_SHIFT) == TPM2_HT_TRANSIENT;
+}
+
+bool IsSessionHandle(uint32_t handle) {
+  return (handle >> TPM2_HR_SHIFT) == TPM2_HT_HMAC_SESSION ||
+         (handle >> TPM2_HR_SHIFT) == TPM2_HT_POLICY_SESSION;
+}
+
+// Appends the session handles of the authorization area that starts at
+// offset, and to closed_handles those of the sessions without
+// continueSession, which the TPM closes when the command succeeds. Returns
+// false if the area is malformed.
+bool ParseAuthSessions(const std::vector<uint8_t> &command, size_t offset,
+                       std::vector<uint32_t> *session_handles,
+                       std::vector<uint32_t> *closed_handles) {
+  if (command.size() < offset + sizeof(uint32_t)) {
+    return false;
+  }
+  const size_t end = offset + sizeof(uint32_t) + ReadUint32(command, offset);
+  if (end > command.size()) {
+    return false;
+  }
+  offset += sizeof(uint32_t);
+  while (offset < end) {
+    // sessionHandle, nonce, sessionAttributes and hmac.
+    if (end < offset + sizeof(uint32_t) + sizeof(uint16_t)) {
+      return false;
+    }
+    const uint32_t handle = ReadUint32(command, offset);
+    session_handles->push_back(handle);
+    offset += sizeof(uint32_t);
+    offset += sizeof(uint16_t) + ReadUint16(command, offset);
+    if (end < offset + sizeof(uint8_t) + sizeof(uint16_t)) {
+      return false;
+    }
+    if (!(command[offset] & TPMA_SESSION_CONTINUESESSION)) {
+      closed_handles->push_back(handle);
+    }
+    offset += sizeof(uint8_t);
+    offset += sizeof(uint16_t) + ReadUint16(command, offset);
+  }
+  return offset == end;
+}
+
+} // namespace
+
+ResourceManager::ResourceManager(TssAdapter::RunCommand runner)
+    : runner_(runner), attributes_unavailable_(false),
+      next_virtual_handle_(kFirstVirtualHandle), use_counter_(0) {}
+
+ResourceManager::~ResourceManager() {}
+
+std::vector<uint8_t>
+ResourceManager::ExecuteCommand(const std::vector<uint8_t> &command) {
+  if (command.size() < kHeaderSize) {
+    return runner_(command);
+  }
+  const uint32_t command_code = ReadUint32(command, 6);
+  if (command_code == TPM2_CC_Startup) {
+    std::vector<uint8_t> response = runner_(command);
+    // Previously saved contexts do not outlive the TPM reset they belong to.
+    if (GetResponseCode(response) == TPM2_RC_SUCCESS) {
+      objects_.clear();
+      sessions_.clear();
+      next_virtual_handle_ = kFirstVirtualHandle;
+    }
+    attributes_unavailable_ = false;
+    return response;
+  }
+  if (attributes_unavailable_ || !LoadCommandAttributes()) {
+    // The TPM cannot answer before Startup, so do not ask again until then.
+    attributes_unavailable_ = true;
+    return runner_(command);
+  }
+  auto attributes = command_attributes_.find(command_code);
+  if (attributes == command_attributes_.end()) {
+    return runner_(command);
+  }
+  if (command_code == TPM2_CC_FlushContext) {
+    return FlushContext(command);
+  }
+
+  // Collect the handles of the handle area and of the authorization area.
+  const size_t num_handles =
+      (attributes->second & TPMA_CC_CHANDLES_MASK) >> TPMA_CC_CHANDLES_SHIFT;
+  const size_t auth_offset = kHeaderSize + num_handles * sizeof(uint32_t);
+  if (command.size() < auth_offset) {
+    return runner_(command);
+  }
+  std::vector<uint32_t> handles;
+  for (size_t i = 0; i < num_handles; i++) {
+    handles.push_back(ReadUint32(command, kHeaderSize + i * sizeof(uint32_t)));
+  }
+  std::vector<uint32_t> session_handles;
+  std::vector<uint32_t> closed_handles;
+  if (ReadUint16(command, 0) == TPM2_ST_SESSIONS &&
+      !ParseAuthSessions(command, auth_offset, &session_handles,
+                         &closed_handles)) {
+    return runner_(command);
+  }
+
+  // Make sure everything the command references is loaded. Referenced
+  // contexts are pinned so that loading one does not evict another.
+  use_counter_++;
+  std::set<uint32_t> pinned(handles.begin(), handles.end());
+  pinned.insert(session_handles.begin(), session_handles.end());
+  std::vector<uint8_t> rewritten = command;
+  for (size_t i = 0; i < handles.size(); i++) {
+    auto object = objects_.find(handles[i]);
+    if (object != objects_.end()) {
+      TPM2_RC rc = LoadContext(&object->second, /*is_session=*/false, pinned);
+      if (rc != TPM2_RC_SUCCESS) {
+        return BuildResponse(rc);
+      }
+      object->second.last_used = use_counter_;
+      WriteUint32(&rewritten, kHeaderSize + i * sizeof(uint32_t),
+                  object->second.tpm_handle);
+    } else {
+      session_handles.push_back(handles[i]);
+    }
+  }
+  for (uint32_t handle : session_handles) {
+    auto session = sessions_.find(handle);
+    if (session == sessions_.end()) {
+      continue;
+    }
+    TPM2_RC rc = LoadContext(&session->second, /*is_session=*/true, pinned);
+    if (rc != TPM2_RC_SUCCESS) {
+      return BuildResponse(rc);
+    }
+    session->second.last_used = use_counter_;
+  }
+
+  // Commands that need a free slot fail without side effects, so retry them
+  // after making room.
+  std::vector<uint8_t> response;
+  while (true) {
+    response = runner_(rewritten);
+    const TPM2_RC rc = GetResponseCode(response);
+    if (rc == TPM2_RC_OBJECT_MEMORY &&
+        EvictLeastRecentlyUsed(&objects_, /*is_session=*/false, pinned)) {
+      continue;
+    }
+    if (rc == TPM2_RC_SESSION_MEMORY &&
+        EvictLeastRecentlyUsed(&sessions_, /*is_session=*/true, pinned)) {
+      continue;
+    }
+    break;
+  }
+  if (GetResponseCode(response) != TPM2_RC_SUCCESS) {
+    return response;
+  }
+
+  // Forget contexts that the command removed from the TPM.
+  if (attributes->second & TPMA_CC_FLUSHED) {
+    for (uint32_t handle : handles) {
+      objects_.erase(handle);
+    }
+  }
+  if (command_code == TPM2_CC_ContextSave && IsSessionHandle(handles[0])) {
+    sessions_.erase(handles[0]);
+  }
+  for (uint32_t handle : closed_handles) {
+    sessions_.erase(handle);
+  }
+
+  // Track the object or session the command created.
+  if ((attributes->second & TPMA_CC_RHANDLE) &&
+      response.size() >= kHeaderSize + sizeof(uint32_t)) {
+    const uint32_t tpm_handle = ReadUint32(response, kHeaderSize);
+    if (IsTransientHandle(tpm_handle)) {
+      const uint32_t virtual_handle = AllocateVirtualHandle();
+      objects_[virtual_handle] = {tpm_handle, true, {}, use_counter_};
+      WriteUint32(&response, kHeaderSize, virtual_handle);
+    } else if (IsSessionHandle(tpm_handle)) {
+      sessions_[tpm_handle] = {tpm_handle, true, {}, use_counter_};
+    }
+  }
+  return response;
+}
+
+size_t ResourceManager::GetObjectCount() const { return objects_.size(); }
+
+size_t ResourceManager::GetLoadedObjectCount() const {
+  size_t count = 0;
+  for (const auto &object : objects_) {
+    if (object.second.loaded) {
+      count++;
+    }
+  }
+  return count;
+}
+
+size_t ResourceManager::GetSessionCount() const { return sessions_.size(); }
+
+bool ResourceManager::LoadCommandAttributes() {
+  if (!command_attributes_.empty()) {
+    return true;
+  }
+  std::map<uint32_t, uint32_t> attributes;
+  uint32_t next_command = TPM2_CC_FIRST;
+  bool more_data = true;
+  while (more_data) {
+    std::vector<uint8_t> body;
+    AppendUint32(&body, TPM2_CAP_COMMANDS);
+    AppendUint32(&body, next_command);
+    AppendUint32(&body, TPM2_MAX_CAP_CC);
+    const std::vector<uint8_t> response =
+        runner_(BuildCommand(TPM2_CC_GetCapability, body));
+    if (GetResponseCode(response) != TPM2_RC_SUCCESS) {
+      return false;
+    }
+    // moreData, capability and TPML_CCA.
+    const size_t list_offset = kHeaderSize + sizeof(uint8_t) + sizeof(uint32_t);
+    if (response.size() < list_offset + sizeof(uint32_t)) {
+      return false;
+    }
+    more_data = response[kHeaderSize] != 0;
+    const uint32_t count = ReadUint32(response, list_offset);
+    if (response.size() < list_offset + (count + 1) * sizeof(uint32_t)) {
+      return false;
+    }
+    if (count == 0) {
+      break;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+      const uint32_t command_attributes =
+          ReadUint32(response, list_offset + (i + 1) * sizeof(uint32_t));
+      const uint32_t command_code =
+          command_attributes & (TPMA_CC_COMMANDINDEX_MASK | TPMA_CC_V);
+      attributes[command_code] = command_attributes;
+      next_command = command_code + 1;
+    }
+  }
+  command_attributes_.swap(attributes);
+  return !command_attributes_.empty();
+}
+
+std::vector<uint8_t>
+ResourceManager::FlushContext(const std::vector<uint8_t> &command) {
+  if (command.size() < kHeaderSize + sizeof(uint32_t)) {
+    return runner_(command);
+  }
+  const uint32_t handle = ReadUint32(command, kHeaderSize);
+  auto object = objects_.find(handle);
+  if (object == objects_.end()) {
+    // Either the TPM flushes the session, loaded or saved, or it no longer
+    // has it.
+    sessions_.erase(handle);
+    return runner_(command);
+  }
+  if (!object->second.loaded) {
+    // The TPM no longer holds the object, dropping the saved context is enough.
+    objects_.erase(object);
+    return BuildResponse(TPM2_RC_SUCCESS);
+  }
+  std::vector<uint8_t> rewritten = command;
+  WriteUint32(&rewritten, kHeaderSize, object->second.tpm_handle);
+  std::vector<uint8_t> response = runner_(rewritten);
+  if (GetResponseCode(response) == TPM2_RC_SUCCESS) {
+    objects_.erase(object);
+  }
+  return response;
+}
+
+TPM2_RC ResourceManager::LoadContext(Context *context, bool is_session,
+                                     const std::set<uint32_t> &pinned) {
+  if (context->loaded) {
+    return TPM2_RC_SUCCESS;
+  }
+  ContextMap *contexts = is_session ? &sessions_ : &objects_;
+  const TPM2_RC memory_rc =
+      is_session ? TPM2_RC_SESSION_MEMORY : TPM2_RC_OBJECT_MEMORY;
+  while (true) {
+    const std::vector<uint8_t> response =
+        runner_(BuildCommand(TPM2_CC_ContextLoad, context->saved_context));
+    const TPM2_RC rc = GetResponseCode(response);
+    if (rc == memory_rc &&
+        EvictLeastRecentlyUsed(contexts, is_session, pinned)) {
+      continue;
+    }
+    if (rc != TPM2_RC_SUCCESS) {
+      LOG1("ResourceManager: ContextLoad failed: 0x%x\n", rc);
+      return rc;
+    }
+    if (response.size() < kHeaderSize + sizeof(uint32_t)) {
+      return TPM2_RC_FAILURE;
+    }
+    context->tpm_handle = ReadUint32(response, kHeaderSize);
+    context->loaded = true;
+    context->saved_context.clear();
+    LOG2("ResourceManager: loaded 0x%x\n", context->tpm_handle);
+    return TPM2_RC_SUCCESS;
+  }
+}
+
+bool ResourceManager::EvictLeastRecentlyUsed(ContextMap *contexts,
+                                             bool is_session,
+                                             const std::set<uint32_t> &pinned) {
+  while (true) {
+    auto victim = contexts->end();
+    for (auto it = contexts->begin(); it != contexts->end(); ++it) {
+      if (!it->second.loaded || pinned.count(it->first)) {
+        continue;
+      }
+      if (victim == contexts->end() ||
+          it->second.last_used < victim->second.last_used) {
+        victim = it;
+      }
+    }
+    if (victim == contexts->end()) {
+      return false;
+    }
+
+    std::vector<uint8_t> handle;
+    AppendUint32(&handle, victim->second.tpm_handle);
+    const std::vector<uint8_t> response =
+        runner_(BuildCommand(TPM2_CC_ContextSave, handle));
+    if (GetResponseCode(response) != TPM2_RC_SUCCESS) {
+      // The TPM already dropped it, e.g. a session used without
+      // continueSession. It did not hold a slot, so look for another one.
+      LOG1("ResourceManager: ContextSave of 0x%x failed: 0x%x\n",
+           victim->second.tpm_handle, GetResponseCode(response));
+      contexts->erase(victim);
+      continue;
+    }
+    victim->second.saved_context.assign(response.begin() + kHeaderSize,
+                                        response.end());
+    // Saving a session frees its slot, saving an object does not.
+    if (!is_session) {
+      runner_(BuildCommand(TPM2_CC_FlushContext, handle));
+    }
+    victim->second.loaded = false;
+    LOG2("ResourceManager: saved 0x%x\n", victim->second.tpm_handle);
+    return true;
+  }
+}
+
+uint32_t ResourceManager::AllocateVirtualHandle() {
+  while (objects_.count(next_virtual_handle_)) {
+    next_virtual_handle_ = next_virtual_handle_ == kLastVirtualHandle
+                               ? kFirstVirtualHandle
+                               : next_virtual_handle_ + 1;
+  }
+  const uint32_t handle = next_virtual_handle_;
+  next_virtual_handle_ = next_virtual_handle_ == kLastVirtualHandle
+                             ? kFirstVirtualHandle
+                             : next_virtual_handle_ + 1;
+  return handle;
+}
+
+} // namespace tpm_js
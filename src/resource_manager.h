@@ -0,0 +1,105 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "tss_adapter.h"
+
+namespace tpm_js {
+
+// In-process resource manager between TssAdapter and the simulator.
+//
+// The TPM only has a few slots for transient objects and sessions. Transient
+// objects are handed out to clients as virtual handles and are swapped in and
+// out of the TPM with ContextSave/ContextLoad, evicting the least recently used
+// one whenever the TPM runs out of memory. Sessions keep their TPM handles,
+// which stay valid across a context save, and are swapped the same way.
+class ResourceManager {
+public:
+  explicit ResourceManager(TssAdapter::RunCommand runner);
+  ~ResourceManager();
+
+  // Runs command on the TPM. Loads every object and session the command
+  // references, translates virtual object handles to TPM handles in the
+  // command and TPM handles to virtual handles in the response.
+  std::vector<uint8_t> ExecuteCommand(const std::vector<uint8_t> &command);
+
+  // Returns the number of virtual object handles, loaded or saved.
+  size_t GetObjectCount() const;
+
+  // Returns the number of objects currently loaded in the TPM.
+  size_t GetLoadedObjectCount() const;
+
+  // Returns the number of sessions, loaded or saved.
+  size_t GetSessionCount() const;
+
+private:
+  // Transient object or session tracked by the resource manager.
+  struct Context {
+    // TPM handle while loaded. Sessions keep their handle while saved.
+    uint32_t tpm_handle;
+    bool loaded;
+    // Marshaled TPMS_CONTEXT from ContextSave. Only valid while not loaded.
+    std::vector<uint8_t> saved_context;
+    // Value of use_counter_ when the context was last referenced.
+    uint64_t last_used;
+  };
+
+  using ContextMap = std::map<uint32_t, Context>;
+
+  // Reads TPMA_CC of every implemented command with Tss2_Sys_GetCapability.
+  // Returns false if the TPM cannot answer yet, e.g. before Startup.
+  bool LoadCommandAttributes();
+
+  // Handles TPM2_CC_FlushContext, whose handle is a parameter.
+  std::vector<uint8_t> FlushContext(const std::vector<uint8_t> &command);
+
+  // Loads context into the TPM if it was saved, evicting unpinned contexts of
+  // the same kind as needed.
+  TPM2_RC LoadContext(Context *context, bool is_session,
+                      const std::set<uint32_t> &pinned);
+
+  // Saves the least recently used loaded context in contexts that is not in
+  // pinned. Returns false if there is nothing left to evict.
+  bool EvictLeastRecentlyUsed(ContextMap *contexts, bool is_session,
+                              const std::set<uint32_t> &pinned);
+
+  // Returns an unused virtual object handle.
+  uint32_t AllocateVirtualHandle();
+
+  TssAdapter::RunCommand runner_;
+
+  // Set when LoadCommandAttributes() failed, until the next Startup. Commands
+  // go straight to the TPM meanwhile.
+  bool attributes_unavailable_;
+
+  // TPMA_CC of each command, keyed by command code.
+  std::map<uint32_t, uint32_t> command_attributes_;
+
+  // Transient objects, keyed by virtual handle.
+  ContextMap objects_;
+  // Sessions, keyed by TPM handle.
+  ContextMap sessions_;
+
+  uint32_t next_virtual_handle_;
+  uint64_t use_counter_;
+};
+
+} // namespace tpm_js
@@ -0,0 +1,156 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "resource_manager.h"
+
+#include "simulator.h"
+
+#include <gtest/gtest.h>
+
+namespace tpm_js {
+namespace {
+
+TEST(ResourceManagerTest, PassesCommandsThroughBeforeStartup) {
+  const std::vector<uint8_t> kGetRandom = {0x80, 0x01, 0x00, 0x00, 0x00, 0x0C,
+                                           0x00, 0x00, 0x01, 0x7B, 0x00, 0x10};
+  const std::vector<uint8_t> kInitialize = {0x80, 0x01, 0x00, 0x00, 0x00,
+                                            0x0A, 0x00, 0x00, 0x01, 0x00};
+  std::vector<std::vector<uint8_t>> commands;
+  ResourceManager rm([&commands, &kInitialize](const std::vector<uint8_t> &cmd) {
+    commands.push_back(cmd);
+    return kInitialize;
+  });
+  // Command attributes cannot be read yet, so the command goes out unchanged.
+  EXPECT_EQ(kInitialize, rm.ExecuteCommand(kGetRandom));
+  ASSERT_EQ(2, commands.size());
+  EXPECT_EQ(kGetRandom, commands.back());
+  EXPECT_EQ(0, rm.GetObjectCount());
+
+  // The TPM is not asked for them again until Startup.
+  EXPECT_EQ(kInitialize, rm.ExecuteCommand(kGetRandom));
+  ASSERT_EQ(3, commands.size());
+  EXPECT_EQ(kGetRandom, commands.back());
+}
+
+TEST(ResourceManagerTest, PassesMalformedCommandsThrough) {
+  const std::vector<uint8_t> kTruncated = {0x80, 0x01, 0x00};
+  const std::vector<uint8_t> kFailure = {0x80, 0x01, 0x00, 0x00, 0x00,
+                                         0x0A, 0x00, 0x00, 0x01, 0x01};
+  ResourceManager rm([&kTruncated, &kFailure](const std::vector<uint8_t> &cmd) {
+    EXPECT_EQ(kTruncated, cmd);
+    return kFailure;
+  });
+  EXPECT_EQ(kFailure, rm.ExecuteCommand(kTruncated));
+}
+
+// Raw commands without sessions.
+const std::vector<uint8_t> kStartupClear = {0x80, 0x01, 0x00, 0x00, 0x00, 0x0C,
+                                            0x00, 0x00, 0x01, 0x44, 0x00, 0x00};
+
+std::vector<uint8_t> BuildCommand(uint32_t command_code,
+                                  const std::vector<uint8_t> &body) {
+  const uint32_t size = 10 + body.size();
+  std::vector<uint8_t> command = {
+      0x80,
+      0x01,
+      static_cast<uint8_t>(size >> 24),
+      static_cast<uint8_t>(size >> 16),
+      static_cast<uint8_t>(size >> 8),
+      static_cast<uint8_t>(size),
+      static_cast<uint8_t>(command_code >> 24),
+      static_cast<uint8_t>(command_code >> 16),
+      static_cast<uint8_t>(command_code >> 8),
+      static_cast<uint8_t>(command_code)};
+  command.insert(command.end(), body.begin(), body.end());
+  return command;
+}
+
+std::vector<uint8_t> HandleBody(uint32_t handle) {
+  return {static_cast<uint8_t>(handle >> 24),
+          static_cast<uint8_t>(handle >> 16),
+          static_cast<uint8_t>(handle >> 8), static_cast<uint8_t>(handle)};
+}
+
+uint32_t GetResponseCode(const std::vector<uint8_t> &response) {
+  EXPECT_LE(10, response.size());
+  return response.size() < 10 ? TPM2_RC_FAILURE
+                              : (response[6] << 24) | (response[7] << 16) |
+                                    (response[8] << 8) | response[9];
+}
+
+// Starts a policy session with TPM2_StartAuthSession. Returns its handle.
+uint32_t StartPolicySession(ResourceManager *rm) {
+  std::vector<uint8_t> body = {
+      0x40, 0x00, 0x00, 0x07, // tpmKey: TPM2_RH_NULL.
+      0x40, 0x00, 0x00, 0x07, // bind: TPM2_RH_NULL.
+      0x00, 0x10,             // nonceCaller: 16 bytes.
+  };
+  body.resize(body.size() + 16, 0x5A);
+  body.insert(body.end(), {
+                              0x00, 0x00, // encryptedSalt: empty.
+                              0x01,       // sessionType: TPM2_SE_POLICY.
+                              0x00, 0x10, // symmetric: TPM2_ALG_NULL.
+                              0x00, 0x0B, // authHash: TPM2_ALG_SHA256.
+                          });
+  std::vector<uint8_t> response =
+      rm->ExecuteCommand(BuildCommand(TPM2_CC_StartAuthSession, body));
+  EXPECT_EQ(TPM2_RC_SUCCESS, GetResponseCode(response));
+  EXPECT_LE(14, response.size());
+  return (response[10] << 24) | (response[11] << 16) | (response[12] << 8) |
+         response[13];
+}
+
+TEST(ResourceManagerTest, SavesAndLoadsSessionsAroundFlushedOnes) {
+  Simulator::PowerOff();
+  Simulator::PowerOn();
+  Simulator::ManufactureReset();
+  ResourceManager rm(&Simulator::ExecuteCommand);
+  ASSERT_EQ(TPM2_RC_SUCCESS, GetResponseCode(rm.ExecuteCommand(kStartupClear)));
+
+  // More sessions than the simulator has session slots, so that the first
+  // ones are saved.
+  const int kNumSessions = 8;
+  std::vector<uint32_t> sessions;
+  for (int i = 0; i < kNumSessions; i++) {
+    sessions.push_back(StartPolicySession(&rm));
+  }
+  EXPECT_EQ(kNumSessions, rm.GetSessionCount());
+
+  // Flush a saved session and a loaded one.
+  for (uint32_t session : {sessions.front(), sessions.back()}) {
+    EXPECT_EQ(TPM2_RC_SUCCESS,
+              GetResponseCode(rm.ExecuteCommand(
+                  BuildCommand(TPM2_CC_FlushContext, HandleBody(session)))));
+  }
+  EXPECT_EQ(kNumSessions - 2, rm.GetSessionCount());
+
+  // The remaining sessions are still swapped in and out as they are used, and
+  // flushed ones are gone.
+  for (int i = 0; i < kNumSessions; i++) {
+    const TPM2_RC rc = GetResponseCode(rm.ExecuteCommand(
+        BuildCommand(TPM2_CC_PolicyGetDigest, HandleBody(sessions[i]))));
+    if (i == 0 || i == kNumSessions - 1) {
+      EXPECT_NE(TPM2_RC_SUCCESS, rc);
+    } else {
+      EXPECT_EQ(TPM2_RC_SUCCESS, rc);
+    }
+  }
+  EXPECT_EQ(kNumSessions - 2, rm.GetSessionCount());
+  StartPolicySession(&rm);
+  EXPECT_EQ(kNumSessions - 1, rm.GetSessionCount());
+  Simulator::PowerOff();
+}
+
+} // namespace
+} // namespace tpm_js
@@ -0,0 +1,56 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "response_cache.h"
+
+namespace tpm_js {
+
+ResponseCache::ResponseCache(StateGeneration state_generation)
+    : state_generation_(state_generation), generation_(state_generation()) {}
+
+ResponseCache::~ResponseCache() {}
+
+void ResponseCache::DropStaleResponses() {
+  uint64_t generation = state_generation_();
+  if (generation != generation_) {
+    responses_.clear();
+    generation_ = generation;
+  }
+}
+
+const std::vector<uint8_t> *ResponseCache::Find(const uint8_t *command,
+                                                size_t command_size) {
+  DropStaleResponses();
+  auto it =
+      responses_.find(std::vector<uint8_t>(command, command + command_size));
+  return it == responses_.end() ? nullptr : &it->second;
+}
+
+uint64_t ResponseCache::GetGeneration() const { return state_generation_(); }
+
+void ResponseCache::Insert(const uint8_t *command, size_t command_size,
+                           const uint8_t *response, size_t response_size,
+                           uint64_t generation) {
+  DropStaleResponses();
+  if (generation != generation_) {
+    return;
+  }
+  if (responses_.size() >= kMaxEntries) {
+    responses_.clear();
+  }
+  responses_[std::vector<uint8_t>(command, command + command_size)]
+      .assign(response, response + response_size);
+}
+
+} // namespace tpm_js
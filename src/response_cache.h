@@ -0,0 +1,66 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace tpm_js {
+
+// Responses to commands that left the TPM state unchanged, e.g.
+// TPM2_GetCapability or TPM2_PCR_Read, keyed by the command bytes. A cached
+// response is only returned while the state is still the same, so it is the
+// response the TPM would give.
+class ResponseCache {
+public:
+  // Returns a value that changes whenever the TPM state may have changed, e.g.
+  // Simulator::GetStateGeneration.
+  using StateGeneration = uint64_t (*)();
+
+  // Maximum number of cached responses. The cache is emptied when full.
+  static constexpr size_t kMaxEntries = 64;
+
+  explicit ResponseCache(StateGeneration state_generation);
+  ~ResponseCache();
+
+  // Returns the response cached for the command_size bytes at command, or
+  // nullptr. The response is valid until the next call.
+  const std::vector<uint8_t> *Find(const uint8_t *command, size_t command_size);
+
+  // Returns the current state generation. Read it before executing a command,
+  // and pass it to Insert once the command has executed.
+  uint64_t GetGeneration() const;
+
+  // Caches the response to command if the state is still at generation, i.e.
+  // the command did not change it.
+  void Insert(const uint8_t *command, size_t command_size,
+              const uint8_t *response, size_t response_size,
+              uint64_t generation);
+
+private:
+  // Empties the cache if the state changed since the responses were cached.
+  void DropStaleResponses();
+
+  const StateGeneration state_generation_;
+  // Generation of the state the cached responses were given in.
+  uint64_t generation_;
+  std::map<std::vector<uint8_t>, std::vector<uint8_t>> responses_;
+};
+
+} // namespace tpm_js
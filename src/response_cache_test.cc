@@ -0,0 +1,100 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "response_cache.h"
+
+#include "simulator.h"
+#include "tss_adapter.h"
+
+#include <gtest/gtest.h>
+
+namespace tpm_js {
+namespace {
+
+uint64_t fake_generation = 0;
+
+uint64_t GetFakeGeneration() { return fake_generation; }
+
+TEST(ResponseCacheTest, CachesUntilStateChanges) {
+  const std::vector<uint8_t> kCommand = {1, 2, 3};
+  const std::vector<uint8_t> kResponse = {4, 5};
+  ResponseCache cache(&GetFakeGeneration);
+  EXPECT_EQ(nullptr, cache.Find(kCommand.data(), kCommand.size()));
+
+  uint64_t generation = cache.GetGeneration();
+  cache.Insert(kCommand.data(), kCommand.size(), kResponse.data(),
+               kResponse.size(), generation);
+  const std::vector<uint8_t> *cached =
+      cache.Find(kCommand.data(), kCommand.size());
+  ASSERT_NE(nullptr, cached);
+  EXPECT_EQ(kResponse, *cached);
+
+  ++fake_generation;
+  EXPECT_EQ(nullptr, cache.Find(kCommand.data(), kCommand.size()));
+
+  // The command changed the state while it ran.
+  generation = cache.GetGeneration();
+  ++fake_generation;
+  cache.Insert(kCommand.data(), kCommand.size(), kResponse.data(),
+               kResponse.size(), generation);
+  EXPECT_EQ(nullptr, cache.Find(kCommand.data(), kCommand.size()));
+}
+
+class ResponseCacheSimulatorTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Simulator::PowerOff();
+    Simulator::PowerOn();
+    Simulator::ManufactureReset();
+  }
+
+  void TearDown() override { Simulator::PowerOff(); }
+};
+
+TEST_F(ResponseCacheSimulatorTest, SkipsSimulatorForReadOnlyCommands) {
+  int num_executed = 0;
+  TssAdapter tss([&num_executed](const std::vector<uint8_t> &command) {
+    ++num_executed;
+    return Simulator::ExecuteCommand(command);
+  });
+  tss.EnableResponseCache(&Simulator::GetStateGeneration);
+  ASSERT_EQ(TPM2_RC_SUCCESS,
+            Tss2_Sys_Startup(tss.GetSysContext(), TPM2_SU_CLEAR));
+
+  auto get_capability = [&tss]() {
+    TPMS_CAPABILITY_DATA capability_data = {};
+    TPMI_YES_NO more;
+    TPM2_RC rc = Tss2_Sys_GetCapability(
+        tss.GetSysContext(), /*cmdAuthsArray=*/nullptr,
+        TPM2_CAP_TPM_PROPERTIES, TPM2_PT_MANUFACTURER, /*propertyCount=*/1,
+        &more, &capability_data, /*rspAuthsArray=*/nullptr);
+    EXPECT_EQ(TPM2_RC_SUCCESS, rc);
+    return capability_data.data.tpmProperties.tpmProperty[0].value;
+  };
+  num_executed = 0;
+  uint32_t manufacturer = get_capability();
+  EXPECT_EQ(manufacturer, get_capability());
+  EXPECT_EQ(manufacturer, get_capability());
+  EXPECT_EQ(1, num_executed);
+
+  TPM2B_DIGEST random = {};
+  EXPECT_EQ(TPM2_RC_SUCCESS,
+            Tss2_Sys_GetRandom(tss.GetSysContext(), /*cmdAuthsArray=*/nullptr,
+                               16, &random, /*rspAuthsArray=*/nullptr));
+  EXPECT_EQ(manufacturer, get_capability());
+  EXPECT_EQ(3, num_executed);
+}
+
+} // namespace
+} // namespace tpm_js
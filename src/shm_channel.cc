@@ -0,0 +1,227 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "shm_channel.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "log.h"
+
+namespace tpm_js {
+namespace {
+
+// Rings are shared across processes, so their atomics must not use locks.
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "uint32_t atomics are not lock-free");
+
+// Tells a ShmChannel from other shared memory and other layouts.
+constexpr uint32_t kChannelMagic = 0x54504d31; // "TPM1"
+
+// Number of times Pop polls an empty ring before it sleeps. Polling keeps
+// the latency of back to back commands at that of a cache line transfer.
+constexpr int kSpinCount = 4000;
+
+// Futexes are not FUTEX_PRIVATE_FLAG, so that they work across processes.
+long Futex(std::atomic<uint32_t> *word, int op, uint32_t value,
+           const timespec *timeout) {
+  return syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), op, value,
+                 timeout, nullptr, 0);
+}
+
+} // namespace
+
+ShmRing::ShmRing()
+    : head_(0), closed_(0), wakeups_(0), tail_(0), sleeping_(0) {}
+
+bool ShmRing::Push(const uint8_t *data, size_t size) {
+  if (size > kMaxFrameSize || IsClosed()) {
+    return false;
+  }
+  // Only the producer writes head_.
+  const uint32_t head = head_.load(std::memory_order_relaxed);
+  const uint32_t tail = tail_.load(std::memory_order_acquire);
+  const uint32_t frame_size = size;
+  if (kCapacity - (head - tail) < sizeof(frame_size) + size) {
+    return false;
+  }
+  Write(head, reinterpret_cast<const uint8_t *>(&frame_size),
+        sizeof(frame_size));
+  Write(head + sizeof(frame_size), data, size);
+  head_.store(head + sizeof(frame_size) + size);
+  Wake();
+  return true;
+}
+
+ShmStatus ShmRing::Pop(uint8_t *buffer, size_t *size, int timeout_ms) {
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(std::max(timeout_ms, 0));
+  // Only the consumer writes tail_.
+  const uint32_t tail = tail_.load(std::memory_order_relaxed);
+  int spins = 0;
+  while (head_.load(std::memory_order_acquire) == tail) {
+    if (IsClosed()) {
+      return kShmClosed;
+    }
+    if (spins < kSpinCount) {
+      ++spins;
+      continue;
+    }
+    const auto left = deadline - std::chrono::steady_clock::now();
+    if (timeout_ms >= 0 && left <= left.zero()) {
+      return kShmTimeout;
+    }
+    // Wake reads sleeping_ after it writes head_ or closed_, and Pop reads
+    // them after it writes sleeping_. So either Pop sees the change, or Wake
+    // sees sleeping_ and changes wakeups_, which fails or ends the wait.
+    sleeping_.store(1);
+    const uint32_t wakeups = wakeups_.load();
+    if (head_.load() == tail && !IsClosed()) {
+      timespec timeout = {};
+      if (timeout_ms >= 0) {
+        const auto ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+        timeout.tv_sec = ns / 1000000000;
+        timeout.tv_nsec = ns % 1000000000;
+      }
+      Futex(&wakeups_, FUTEX_WAIT, wakeups,
+            timeout_ms >= 0 ? &timeout : nullptr);
+    }
+    sleeping_.store(0, std::memory_order_relaxed);
+  }
+
+  uint32_t frame_size;
+  Read(tail, reinterpret_cast<uint8_t *>(&frame_size), sizeof(frame_size));
+  if (frame_size > *size) {
+    *size = frame_size;
+    return kShmBufferTooSmall;
+  }
+  Read(tail + sizeof(frame_size), buffer, frame_size);
+  tail_.store(tail + sizeof(frame_size) + frame_size,
+              std::memory_order_release);
+  *size = frame_size;
+  return kShmOk;
+}
+
+void ShmRing::Close() {
+  closed_.store(1);
+  Wake();
+}
+
+bool ShmRing::IsClosed() const { return closed_.load() != 0; }
+
+void ShmRing::Write(uint32_t pos, const uint8_t *data, size_t size) {
+  const uint32_t offset = pos & (kCapacity - 1);
+  const size_t first = std::min<size_t>(size, kCapacity - offset);
+  memcpy(data_ + offset, data, first);
+  memcpy(data_, data + first, size - first);
+}
+
+void ShmRing::Read(uint32_t pos, uint8_t *data, size_t size) {
+  const uint32_t offset = pos & (kCapacity - 1);
+  const size_t first = std::min<size_t>(size, kCapacity - offset);
+  memcpy(data, data_ + offset, first);
+  memcpy(data + first, data_, size - first);
+}
+
+void ShmRing::Wake() {
+  if (sleeping_.exchange(0) != 0) {
+    wakeups_.fetch_add(1);
+    Futex(&wakeups_, FUTEX_WAKE, 1, nullptr);
+  }
+}
+
+struct ShmChannel::Memory {
+  // kChannelMagic once the creator has constructed the rings.
+  std::atomic<uint32_t> magic;
+  ShmRing commands;
+  ShmRing responses;
+};
+
+std::unique_ptr<ShmChannel> ShmChannel::Create(const std::string &name) {
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    LOG1("Cannot create %s: %s\n", name.c_str(), strerror(errno));
+    return nullptr;
+  }
+  void *address = MAP_FAILED;
+  if (ftruncate(fd, sizeof(Memory)) == 0) {
+    address = mmap(nullptr, sizeof(Memory), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (address == MAP_FAILED) {
+    LOG1("Cannot map %s: %s\n", name.c_str(), strerror(errno));
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+  Memory *memory = new (address) Memory();
+  memory->magic.store(kChannelMagic, std::memory_order_release);
+  return std::unique_ptr<ShmChannel>(new ShmChannel(name, true, memory));
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::Open(const std::string &name) {
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    LOG1("Cannot open %s: %s\n", name.c_str(), strerror(errno));
+    return nullptr;
+  }
+  struct stat st;
+  void *address = MAP_FAILED;
+  if (fstat(fd, &st) == 0 &&
+      static_cast<size_t>(st.st_size) == sizeof(Memory)) {
+    address = mmap(nullptr, sizeof(Memory), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (address == MAP_FAILED) {
+    LOG1("Cannot map %s\n", name.c_str());
+    return nullptr;
+  }
+  Memory *memory = static_cast<Memory *>(address);
+  if (memory->magic.load(std::memory_order_acquire) != kChannelMagic) {
+    LOG1("%s is not a channel\n", name.c_str());
+    munmap(address, sizeof(Memory));
+    return nullptr;
+  }
+  return std::unique_ptr<ShmChannel>(new ShmChannel(name, false, memory));
+}
+
+ShmChannel::ShmChannel(const std::string &name, bool owner, Memory *memory)
+    : name_(name), owner_(owner), memory_(memory) {}
+
+ShmChannel::~ShmChannel() {
+  if (owner_) {
+    // Peers that still use the channel see it closed.
+    memory_->commands.Close();
+    memory_->responses.Close();
+    shm_unlink(name_.c_str());
+  }
+  munmap(memory_, sizeof(Memory));
+}
+
+ShmRing *ShmChannel::GetCommands() { return &memory_->commands; }
+
+ShmRing *ShmChannel::GetResponses() { return &memory_->responses; }
+
+} // namespace tpm_js
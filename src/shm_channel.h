@@ -0,0 +1,117 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace tpm_js {
+
+// Outcome of ShmRing::Pop.
+enum ShmStatus {
+  kShmOk,
+  // No frame arrived before the timeout.
+  kShmTimeout,
+  // The frame is larger than the buffer. It stays in the ring.
+  kShmBufferTooSmall,
+  // The ring is closed and has no frames left.
+  kShmClosed,
+};
+
+// Single-producer single-consumer ring of frames, placed in shared memory by
+// ShmChannel. Frames are a UINT32 size followed by as many bytes.
+//
+// A consumer with nothing to pop spins for a while before sleeping on a
+// futex, and a producer only makes the futex wake call when the consumer
+// sleeps. Under load, frames are exchanged without system calls.
+class ShmRing {
+public:
+  // Bytes of frames the ring holds. A power of two.
+  static constexpr uint32_t kCapacity = 1 << 16;
+
+  // Largest frame, e.g. a TPM command or response.
+  static constexpr uint32_t kMaxFrameSize = kCapacity / 4;
+
+  ShmRing();
+
+  // Appends a frame of size bytes. Returns false if size is over
+  // kMaxFrameSize, the ring is full or closed.
+  bool Push(const uint8_t *data, size_t size);
+
+  // Pops the next frame into buffer, which holds *size bytes, and sets *size
+  // to the size of the frame. Waits for up to timeout_ms, or forever if
+  // negative.
+  ShmStatus Pop(uint8_t *buffer, size_t *size, int timeout_ms);
+
+  // Makes Push fail and Pop return kShmClosed once the ring is empty.
+  void Close();
+
+  bool IsClosed() const;
+
+private:
+  // Copies size bytes at position pos of the ring from or to data.
+  void Write(uint32_t pos, const uint8_t *data, size_t size);
+  void Read(uint32_t pos, uint8_t *data, size_t size);
+
+  // Wakes the consumer if it sleeps, or is about to.
+  void Wake();
+
+  // Positions only grow and wrap around at 2^32, so that head - tail is the
+  // number of bytes in the ring.
+  alignas(64) std::atomic<uint32_t> head_;
+  std::atomic<uint32_t> closed_;
+  // Futex the consumer sleeps on. Changes on each wakeup.
+  std::atomic<uint32_t> wakeups_;
+  alignas(64) std::atomic<uint32_t> tail_;
+  // Non-zero while the consumer sleeps, or is about to.
+  std::atomic<uint32_t> sleeping_;
+  alignas(64) uint8_t data_[kCapacity];
+};
+
+// POSIX shared memory object holding a command ring from a client to a
+// server, and a response ring back. Client and server may be in different
+// processes. A channel serves one client at a time.
+class ShmChannel {
+public:
+  // Creates the shared memory object name, e.g. "/tpm-js", replacing any
+  // stale object of the same name. The object is removed when the channel is
+  // destroyed. Returns nullptr on failure.
+  static std::unique_ptr<ShmChannel> Create(const std::string &name);
+
+  // Opens an object made by Create. Returns nullptr on failure.
+  static std::unique_ptr<ShmChannel> Open(const std::string &name);
+
+  ~ShmChannel();
+
+  ShmRing *GetCommands();
+  ShmRing *GetResponses();
+
+private:
+  struct Memory;
+
+  ShmChannel(const std::string &name, bool owner, Memory *memory);
+
+  std::string name_;
+  // True if the channel created the object.
+  bool owner_;
+  Memory *memory_;
+};
+
+} // namespace tpm_js
@@ -0,0 +1,194 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "shm_channel.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "shm_server.h"
+#include "shm_tcti.h"
+#include "simulator.h"
+
+#include <gtest/gtest.h>
+
+namespace tpm_js {
+namespace {
+
+const char kChannelName[] = "/tpm-js-shm-channel-test";
+
+// TPM2_Startup(TPM2_SU_CLEAR).
+const std::vector<uint8_t> kStartup = {0x80, 0x01, 0x00, 0x00, 0x00, 0x0c,
+                                       0x00, 0x00, 0x01, 0x44, 0x00, 0x00};
+
+// TPM2_GetRandom of 16 bytes.
+const std::vector<uint8_t> kGetRandom = {0x80, 0x01, 0x00, 0x00, 0x00, 0x0c,
+                                         0x00, 0x00, 0x01, 0x7b, 0x00, 0x10};
+
+std::vector<uint8_t> MakeFrame(size_t size, uint8_t seed) {
+  std::vector<uint8_t> frame(size);
+  for (size_t i = 0; i < size; ++i) {
+    frame[i] = seed + i;
+  }
+  return frame;
+}
+
+// Pops a frame of up to kMaxFrameSize bytes, waiting forever.
+std::vector<uint8_t> PopFrame(ShmRing *ring) {
+  std::vector<uint8_t> frame(ShmRing::kMaxFrameSize);
+  size_t size = frame.size();
+  EXPECT_EQ(kShmOk, ring->Pop(frame.data(), &size, /*timeout_ms=*/-1));
+  frame.resize(size);
+  return frame;
+}
+
+TEST(ShmRingTest, PushesAndPopsFrames) {
+  std::unique_ptr<ShmRing> ring(new ShmRing());
+  // Enough frames to wrap around the ring several times.
+  for (int i = 0; i < 1000; ++i) {
+    std::vector<uint8_t> frame = MakeFrame(i * 37 % 5000, i);
+    ASSERT_TRUE(ring->Push(frame.data(), frame.size()));
+    if (i % 2 == 1) {
+      EXPECT_EQ(MakeFrame((i - 1) * 37 % 5000, i - 1), PopFrame(ring.get()));
+      EXPECT_EQ(frame, PopFrame(ring.get()));
+    }
+  }
+
+  std::vector<uint8_t> frame = MakeFrame(100, 0);
+  size_t size = 10;
+  EXPECT_EQ(kShmTimeout, ring->Pop(frame.data(), &size, /*timeout_ms=*/0));
+  EXPECT_EQ(kShmTimeout, ring->Pop(frame.data(), &size, /*timeout_ms=*/10));
+  EXPECT_TRUE(ring->Push(frame.data(), frame.size()));
+  EXPECT_EQ(kShmBufferTooSmall, ring->Pop(frame.data(), &size, 0));
+  EXPECT_EQ(100, size);
+  EXPECT_FALSE(ring->Push(frame.data(), ShmRing::kMaxFrameSize + 1));
+
+  ring->Close();
+  EXPECT_FALSE(ring->Push(frame.data(), frame.size()));
+  EXPECT_EQ(MakeFrame(100, 0), PopFrame(ring.get()));
+  EXPECT_EQ(kShmClosed, ring->Pop(frame.data(), &size, -1));
+}
+
+TEST(ShmRingTest, PassesFramesAcrossThreads) {
+  std::unique_ptr<ShmRing> ring(new ShmRing());
+  const int kNumFrames = 10000;
+  std::thread producer([&ring]() {
+    for (int i = 0; i < kNumFrames; ++i) {
+      std::vector<uint8_t> frame = MakeFrame(i % 300, i);
+      while (!ring->Push(frame.data(), frame.size())) {
+        std::this_thread::yield();
+      }
+    }
+    ring->Close();
+  });
+  for (int i = 0; i < kNumFrames; ++i) {
+    ASSERT_EQ(MakeFrame(i % 300, i), PopFrame(ring.get()));
+  }
+  std::vector<uint8_t> frame(1);
+  size_t size = frame.size();
+  EXPECT_EQ(kShmClosed, ring->Pop(frame.data(), &size, -1));
+  producer.join();
+}
+
+TEST(ShmChannelTest, OpensChannel) {
+  EXPECT_EQ(nullptr, ShmChannel::Open(kChannelName));
+  std::unique_ptr<ShmChannel> server = ShmChannel::Create(kChannelName);
+  ASSERT_NE(nullptr, server);
+  std::unique_ptr<ShmChannel> client = ShmChannel::Open(kChannelName);
+  ASSERT_NE(nullptr, client);
+
+  std::vector<uint8_t> frame = MakeFrame(10, 1);
+  EXPECT_TRUE(client->GetCommands()->Push(frame.data(), frame.size()));
+  EXPECT_EQ(frame, PopFrame(server->GetCommands()));
+  EXPECT_TRUE(server->GetResponses()->Push(frame.data(), frame.size()));
+  EXPECT_EQ(frame, PopFrame(client->GetResponses()));
+
+  server.reset();
+  EXPECT_TRUE(client->GetCommands()->IsClosed());
+  EXPECT_EQ(nullptr, ShmChannel::Open(kChannelName));
+}
+
+class ShmServerTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Simulator::PowerOff();
+    Simulator::PowerOn();
+    Simulator::ManufactureReset();
+    channel_ = ShmChannel::Create(kChannelName);
+    ASSERT_NE(nullptr, channel_);
+    server_.reset(new ShmServer(channel_.get()));
+    thread_ = std::thread([this]() { server_->Run(); });
+  }
+
+  void TearDown() override {
+    server_->Stop();
+    thread_.join();
+    Simulator::PowerOff();
+  }
+
+  std::unique_ptr<ShmChannel> channel_;
+  std::unique_ptr<ShmServer> server_;
+  std::thread thread_;
+};
+
+TEST_F(ShmServerTest, ExecutesCommands) {
+  std::unique_ptr<ShmChannel> client = ShmChannel::Open(kChannelName);
+  ASSERT_NE(nullptr, client);
+  ShmRing *commands = client->GetCommands();
+  ASSERT_TRUE(commands->Push(kStartup.data(), kStartup.size()));
+  EXPECT_EQ(std::vector<uint8_t>({0x80, 0x01, 0x00, 0x00, 0x00, 0x0a, 0x00,
+                                  0x00, 0x00, 0x00}),
+            PopFrame(client->GetResponses()));
+
+  // Pipelined commands.
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(commands->Push(kGetRandom.data(), kGetRandom.size()));
+  }
+  for (int i = 0; i < 10; ++i) {
+    std::vector<uint8_t> response = PopFrame(client->GetResponses());
+    ASSERT_EQ(10 + 2 + 16, response.size());
+    EXPECT_EQ(0, response[9]);
+  }
+}
+
+TEST_F(ShmServerTest, StopsWhenResponsesAreNotRead) {
+  std::unique_ptr<ShmChannel> client = ShmChannel::Open(kChannelName);
+  ASSERT_NE(nullptr, client);
+  // More commands than the response ring has room for responses, but fewer
+  // than both rings together, so that all of them can be pushed.
+  ShmRing *commands = client->GetCommands();
+  for (int i = 0; i < 6000; ++i) {
+    while (!commands->Push(kGetRandom.data(), kGetRandom.size())) {
+      std::this_thread::yield();
+    }
+  }
+  // TearDown stops the server, which waits for room in the response ring.
+}
+
+TEST_F(ShmServerTest, ServesTcti) {
+  std::unique_ptr<ShmChannel> client = ShmChannel::Open(kChannelName);
+  ASSERT_NE(nullptr, client);
+  ShmTcti tcti(client.get());
+  EXPECT_EQ(TPM2_RC_SUCCESS,
+            Tss2_Sys_Startup(tcti.GetSysContext(), TPM2_SU_CLEAR));
+  TPM2B_DIGEST random = {};
+  EXPECT_EQ(TPM2_RC_SUCCESS,
+            Tss2_Sys_GetRandom(tcti.GetSysContext(), /*cmdAuthsArray=*/nullptr,
+                               16, &random, /*rspAuthsArray=*/nullptr));
+  EXPECT_EQ(16, random.size);
+}
+
+} // namespace
+} // namespace tpm_js
@@ -0,0 +1,70 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "shm_server.h"
+
+#include <thread>
+
+extern "C" {
+// clang-format off
+#include "Tpm.h"
+#include "TpmTcpProtocol.h"
+#include "Simulator_fp.h"
+// clang-format on
+}
+
+namespace tpm_js {
+
+ShmServer::ShmServer(ShmChannel *channel)
+    : channel_(channel), command_(ShmRing::kMaxFrameSize),
+      response_(MAX_RESPONSE_SIZE) {}
+
+ShmServer::~ShmServer() {}
+
+void ShmServer::Run() {
+  ShmRing *commands = channel_->GetCommands();
+  ShmRing *responses = channel_->GetResponses();
+  for (;;) {
+    size_t size = command_.size();
+    ShmStatus status =
+        commands->Pop(command_.data(), &size, /*timeout_ms=*/-1);
+    if (status == kShmClosed) {
+      return;
+    }
+    if (status != kShmOk) {
+      // Only kShmBufferTooSmall, since Pop waits forever: the client wrote a
+      // frame over kMaxFrameSize, which stays in the ring. Closes the channel
+      // instead of popping it again and again.
+      commands->Close();
+      responses->Close();
+      return;
+    }
+    _IN_BUFFER in_buffer = {static_cast<uint32_t>(size), command_.data()};
+    _OUT_BUFFER out_buffer = {static_cast<uint32_t>(response_.size()),
+                              response_.data()};
+    _rpc__Send_Command(/*locality=*/0, in_buffer, &out_buffer);
+    // The response ring only fills up if the client sends commands without
+    // receiving responses. Waits for it to catch up, or for Stop.
+    while (!responses->Push(out_buffer.Buffer, out_buffer.BufferSize)) {
+      if (responses->IsClosed() || commands->IsClosed()) {
+        return;
+      }
+      std::this_thread::yield();
+    }
+  }
+}
+
+void ShmServer::Stop() { channel_->GetCommands()->Close(); }
+
+} // namespace tpm_js
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "shm_channel.h"
+
+namespace tpm_js {
+
+// Executes the commands of a ShmChannel on the simulator, in the order they
+// arrive, and sends back the responses. Commands run at locality 0.
+class ShmServer {
+public:
+  explicit ShmServer(ShmChannel *channel);
+  ~ShmServer();
+
+  // Serves commands until Stop is called or the channel is destroyed. A
+  // command over ShmRing::kMaxFrameSize closes the channel.
+  void Run();
+
+  // Makes Run return once the commands received so far are executed, or
+  // right away if the client does not read their responses. Closes the
+  // command ring of the channel for good. May be called from any thread.
+  void Stop();
+
+private:
+  ShmChannel *channel_;
+  std::vector<uint8_t> command_;
+  // Buffer the simulator writes responses to.
+  std::vector<uint8_t> response_;
+};
+
+} // namespace tpm_js
@@ -0,0 +1,71 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "shm_tcti.h"
+
+#include <cassert>
+
+namespace tpm_js {
+
+ShmTcti::ShmTcti(ShmChannel *channel)
+    : channel_(channel), tcti_context_({}), sys_context_(nullptr) {
+  tcti_context_.common.magic = 0;
+  tcti_context_.common.version = 1;
+  tcti_context_.common.transmit = &ShmTcti::Transmit;
+  tcti_context_.common.receive = &ShmTcti::Receive;
+  tcti_context_.common.finalize = nullptr;
+  tcti_context_.common.cancel = nullptr;
+  tcti_context_.common.getPollHandles = nullptr;
+  tcti_context_.common.setLocality = nullptr;
+  tcti_context_.opaque = this;
+  sys_context_ = CreateSysContext(
+      reinterpret_cast<TSS2_TCTI_CONTEXT *>(&tcti_context_.common));
+  assert(sys_context_ != nullptr);
+}
+
+ShmTcti::~ShmTcti() { DestroySysContext(sys_context_); }
+
+TSS2_SYS_CONTEXT *ShmTcti::GetSysContext() { return sys_context_; }
+
+TSS2_RC ShmTcti::Transmit(TSS2_TCTI_CONTEXT *tcti_context,
+                          size_t command_size, uint8_t const *command_buffer) {
+  ShmTcti *that = reinterpret_cast<ShmTcti *>(GetTctiOpaque(tcti_context));
+  ShmRing *commands = that->channel_->GetCommands();
+  if (!commands->Push(command_buffer, command_size)) {
+    return commands->IsClosed() ? TSS2_TCTI_RC_NO_CONNECTION
+                                : TSS2_TCTI_RC_IO_ERROR;
+  }
+  return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC ShmTcti::Receive(TSS2_TCTI_CONTEXT *tcti_context,
+                         size_t *response_size, uint8_t *response_buffer,
+                         int32_t timeout) {
+  ShmTcti *that = reinterpret_cast<ShmTcti *>(GetTctiOpaque(tcti_context));
+  // TSS2_TCTI_TIMEOUT_BLOCK is negative, which Pop takes as forever.
+  switch (that->channel_->GetResponses()->Pop(response_buffer, response_size,
+                                              timeout)) {
+  case kShmOk:
+    return TSS2_RC_SUCCESS;
+  case kShmTimeout:
+    return TSS2_TCTI_RC_TRY_AGAIN;
+  case kShmBufferTooSmall:
+    return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+  case kShmClosed:
+    return TSS2_TCTI_RC_NO_CONNECTION;
+  }
+  return TSS2_TCTI_RC_GENERAL_FAILURE;
+}
+
+} // namespace tpm_js
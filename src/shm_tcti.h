@@ -0,0 +1,48 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "shm_channel.h"
+#include "tss_adapter.h"
+
+namespace tpm_js {
+
+// TCTI that sends commands through a ShmChannel to a ShmServer, possibly in
+// another process. Commands are copied once, from the TSS buffer into the
+// command ring, and responses once, from the response ring into the TSS
+// buffer.
+class ShmTcti {
+public:
+  explicit ShmTcti(ShmChannel *channel);
+  ~ShmTcti();
+
+  TSS2_SYS_CONTEXT *GetSysContext();
+
+private:
+  static TSS2_RC Transmit(TSS2_TCTI_CONTEXT *tcti_context, size_t command_size,
+                          uint8_t const *command_buffer);
+
+  static TSS2_RC Receive(TSS2_TCTI_CONTEXT *tcti_context,
+                         size_t *response_size, uint8_t *response_buffer,
+                         int32_t timeout);
+
+  ShmChannel *channel_;
+  TSS2_TCTI_CONTEXT_ADAPTER tcti_context_;
+  TSS2_SYS_CONTEXT *sys_context_;
+};
+
+} // namespace tpm_js
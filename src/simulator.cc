@@ -14,7 +14,9 @@
 
 #include "simulator.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 #include "log.h"
 
@@ -23,6 +25,7 @@ extern "C" {
 #include "Tpm.h"
 #include "TpmTcpProtocol.h"
 #include "Simulator_fp.h"
+#include "PlatformData.h"
 // clang-format on
 }
 
@@ -49,6 +52,7 @@ void Simulator::ManufactureReset() {
   LOG1("ManufactureReset\n");
   TPM_RC result = TPM_Manufacture(/*firstTime=*/TRUE);
   assert(result == TPM_RC_SUCCESS);
+  _plat__StateChanged();
 }
 
 int Simulator::IsPoweredOn() { return s_isPowerOn; }
@@ -92,17 +96,122 @@ std::vector<uint8_t> Simulator::GetNullSeed() {
 
 int Simulator::GetBootCounter() { return gp.totalResetCount; }
 
+std::vector<uint8_t> Simulator::GetPrimaryKeyCache() {
+  std::vector<uint8_t> cache(PrimaryCacheSave(nullptr, 0));
+  PrimaryCacheSave(cache.data(), cache.size());
+  return cache;
+}
+
+bool Simulator::SetPrimaryKeyCache(const std::vector<uint8_t> &cache) {
+  return PrimaryCacheRestore(const_cast<uint8_t *>(cache.data()),
+                             cache.size());
+}
+
+namespace {
+
+// Header of a snapshot, followed by the NV image and the primary key cache.
+struct SnapshotHeader {
+  uint32_t nv_size;
+  uint32_t primary_key_cache_size;
+};
+
+} // namespace
+
+std::vector<uint8_t> Simulator::GetSnapshot() {
+  assert(!s_isPowerOn);
+  std::vector<uint8_t> cache = GetPrimaryKeyCache();
+  SnapshotHeader header = {NV_MEMORY_SIZE,
+                           static_cast<uint32_t>(cache.size())};
+  std::vector<uint8_t> snapshot(sizeof(header) + NV_MEMORY_SIZE);
+  memcpy(snapshot.data(), &header, sizeof(header));
+  _plat__NvMemoryRead(0, NV_MEMORY_SIZE, &snapshot[sizeof(header)]);
+  snapshot.insert(snapshot.end(), cache.begin(), cache.end());
+  return snapshot;
+}
+
+bool Simulator::RestoreSnapshot(const uint8_t *snapshot, size_t size) {
+  LOG1("RestoreSnapshot\n");
+  SnapshotHeader header;
+  if (s_isPowerOn || size < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, snapshot, sizeof(header));
+  if (header.nv_size != NV_MEMORY_SIZE ||
+      header.primary_key_cache_size != PrimaryCacheSave(nullptr, 0) ||
+      size != sizeof(header) + header.nv_size + header.primary_key_cache_size) {
+    return false;
+  }
+  const uint8_t *nv = snapshot + sizeof(header);
+  if (_plat__NvMemoryRestore(nv, header.nv_size) != 0) {
+    return false;
+  }
+  PrimaryCacheRestore(const_cast<uint8_t *>(nv + header.nv_size),
+                      header.primary_key_cache_size);
+  g_manufactured = TRUE;
+  return true;
+}
+
+int Simulator::GetNvBlockSize() { return NV_BLOCK_SIZE; }
+
+int Simulator::GetNvBlockCount() { return NV_BLOCK_COUNT; }
+
+std::vector<int> Simulator::TakeWrittenNvBlocks() {
+  unsigned int blocks[NV_BLOCK_COUNT];
+  unsigned int count = _plat__NvTakeWrittenBlocks(blocks);
+  return std::vector<int>(blocks, blocks + count);
+}
+
+std::vector<uint8_t> Simulator::GetNvBlock(int index) {
+  assert(index >= 0 && index < NV_BLOCK_COUNT);
+  const unsigned int start = index * NV_BLOCK_SIZE;
+  std::vector<uint8_t> block(
+      std::min<unsigned int>(NV_BLOCK_SIZE, NV_MEMORY_SIZE - start));
+  _plat__NvMemoryRead(start, block.size(), block.data());
+  return block;
+}
+
+bool Simulator::RestoreNv(const std::vector<uint8_t> &nv) {
+  LOG1("RestoreNv\n");
+  if (s_isPowerOn || _plat__NvMemoryRestore(nv.data(), nv.size()) != 0) {
+    return false;
+  }
+  g_manufactured = TRUE;
+  return true;
+}
+
+int Simulator::SetNvCommitDeferred(bool deferred) {
+  LOG1("SetNvCommitDeferred %d\n", deferred);
+  return _plat__NvDeferCommit(deferred);
+}
+
+uint64_t Simulator::GetStateGeneration() {
+  return _plat__GetStateGeneration();
+}
+
 std::vector<uint8_t>
 Simulator::ExecuteCommand(const std::vector<uint8_t> &command) {
   // Reserve space for response.
   std::vector<uint8_t> response(MAX_RESPONSE_SIZE);
-  uint32_t response_size = MAX_RESPONSE_SIZE;
-  uint8_t *request_ptr = const_cast<uint8_t *>(command.data());
-  uint8_t *response_ptr = response.data();
-  _plat__RunCommand(command.size(), request_ptr, &response_size, &response_ptr);
+  size_t response_size = response.size();
+  ExecuteRawCommand(command.data(), command.size(), response.data(),
+                    &response_size);
   // Resize to match actual response size.
   response.resize(response_size);
   return response;
 }
 
+void Simulator::ExecuteRawCommand(const uint8_t *command, size_t command_size,
+                                  uint8_t *response, size_t *response_size) {
+  uint32_t size = *response_size;
+  uint8_t *response_ptr = response;
+  _plat__RunCommand(command_size, const_cast<uint8_t *>(command), &size,
+                    &response_ptr);
+  // In failure mode, the simulator responds from a buffer of its own.
+  if (response_ptr != response) {
+    size = std::min<size_t>(size, *response_size);
+    memcpy(response, response_ptr, size);
+  }
+  *response_size = size;
+}
+
 } // namespace tpm_js
@@ -38,9 +38,61 @@ public:
   static std::vector<uint8_t> GetNullSeed();
   static int GetBootCounter();
 
+  // Returns the primary key cache of the simulator. Primary objects are kept
+  // there when created, so that creating them again with the same seed and
+  // template is a lookup. The cache can be restored with SetPrimaryKeyCache()
+  // after the simulator is restarted with the same NV state.
+  static std::vector<uint8_t> GetPrimaryKeyCache();
+  // Replaces the primary key cache. Returns false if cache was not produced by
+  // GetPrimaryKeyCache() of the same build.
+  static bool SetPrimaryKeyCache(const std::vector<uint8_t> &cache);
+
+  // Returns the NV state and the primary key cache of the simulator, which
+  // must be powered off. E.g. right after it is manufactured, started up and
+  // shut down.
+  static std::vector<uint8_t> GetSnapshot();
+  // Restores a snapshot taken with GetSnapshot() by the same build, into a
+  // powered off simulator. Once powered on, the simulator is in the state of
+  // the snapshot, with no need to manufacture it. Returns false if the
+  // simulator is powered on or snapshot does not match the build.
+  static bool RestoreSnapshot(const uint8_t *snapshot, size_t size);
+
+  // NV is split in GetNvBlockCount() blocks of GetNvBlockSize() bytes, the
+  // last one possibly shorter, so that it can be persisted block by block.
+  static int GetNvBlockSize();
+  static int GetNvBlockCount();
+  // Returns the indices of the NV blocks written since the last call, e.g. to
+  // persist only those. Restoring NV marks all blocks as written.
+  static std::vector<int> TakeWrittenNvBlocks();
+  // Returns the current content of NV block index.
+  static std::vector<uint8_t> GetNvBlock(int index);
+  // Replaces the NV state of a powered off simulator with nv, e.g. assembled
+  // from the persisted blocks of a simulator of the same build. Once powered
+  // on, the simulator is in that state, with an empty primary key cache.
+  // Returns false if the simulator is powered on or nv is not the size of NV.
+  static bool RestoreNv(const std::vector<uint8_t> &nv);
+
+  // While deferred, NV writes of commands stay in RAM instead of being
+  // committed after each command. Resuming commits the writes made in the
+  // meantime, at once. Returns 0 on success, non-zero if the commit fails.
+  static int SetNvCommitDeferred(bool deferred);
+
+  // Returns a value that changes whenever the TPM state may have changed.
+  // Successful TPM2_GetCapability, TPM2_ReadPublic, TPM2_NV_ReadPublic and
+  // TPM2_PCR_Read commands without sessions leave it unchanged, so their
+  // responses stay valid until it changes. See ResponseCache.
+  static uint64_t GetStateGeneration();
+
   static std::vector<uint8_t>
   ExecuteCommand(const std::vector<uint8_t> &command);
 
+  // Executes the command_size bytes at command, and has the simulator write
+  // the response straight to response, which holds *response_size bytes.
+  // Sets *response_size to the size of the response. response should hold
+  // MAX_RESPONSE_SIZE bytes, e.g. TPM2_MAX_COMMAND_SIZE.
+  static void ExecuteRawCommand(const uint8_t *command, size_t command_size,
+                                uint8_t *response, size_t *response_size);
+
 private:
   // static only
   ~Simulator();
@@ -38,5 +38,62 @@ TEST(SimulatorTest, TestManufactureResetGeneratesNewSeeds) {
   EXPECT_NE(eseed_before, eseed_after);
 }
 
+TEST(SimulatorTest, TestRestoreSnapshot) {
+  Simulator::PowerOn();
+  Simulator::ManufactureReset();
+  auto eseed = Simulator::GetEndorsementSeed();
+  auto cache = Simulator::GetPrimaryKeyCache();
+  Simulator::PowerOff();
+  std::vector<uint8_t> snapshot = Simulator::GetSnapshot();
+
+  Simulator::PowerOn();
+  Simulator::ManufactureReset();
+  EXPECT_NE(eseed, Simulator::GetEndorsementSeed());
+  EXPECT_FALSE(Simulator::RestoreSnapshot(snapshot.data(), snapshot.size()));
+  Simulator::PowerOff();
+  EXPECT_FALSE(
+      Simulator::RestoreSnapshot(snapshot.data(), snapshot.size() - 1));
+
+  ASSERT_TRUE(Simulator::RestoreSnapshot(snapshot.data(), snapshot.size()));
+  Simulator::PowerOn();
+  EXPECT_EQ(Simulator::IsManufactured(), true);
+  EXPECT_EQ(eseed, Simulator::GetEndorsementSeed());
+  EXPECT_EQ(cache, Simulator::GetPrimaryKeyCache());
+  Simulator::PowerOff();
+}
+
+TEST(SimulatorTest, TestRestoreNvFromBlocks) {
+  Simulator::PowerOn();
+  Simulator::ManufactureReset();
+  auto eseed = Simulator::GetEndorsementSeed();
+  Simulator::PowerOff();
+  EXPECT_FALSE(Simulator::TakeWrittenNvBlocks().empty());
+  EXPECT_TRUE(Simulator::TakeWrittenNvBlocks().empty());
+
+  std::vector<uint8_t> nv;
+  for (int i = 0; i < Simulator::GetNvBlockCount(); ++i) {
+    std::vector<uint8_t> block = Simulator::GetNvBlock(i);
+    EXPECT_LE(block.size(),
+              static_cast<size_t>(Simulator::GetNvBlockSize()));
+    nv.insert(nv.end(), block.begin(), block.end());
+  }
+
+  Simulator::PowerOn();
+  Simulator::ManufactureReset();
+  EXPECT_NE(eseed, Simulator::GetEndorsementSeed());
+  EXPECT_FALSE(Simulator::RestoreNv(nv));
+  Simulator::PowerOff();
+  EXPECT_FALSE(Simulator::RestoreNv({1, 2, 3}));
+
+  Simulator::TakeWrittenNvBlocks();
+  ASSERT_TRUE(Simulator::RestoreNv(nv));
+  EXPECT_EQ(Simulator::GetNvBlockCount(),
+            Simulator::TakeWrittenNvBlocks().size());
+  Simulator::PowerOn();
+  EXPECT_EQ(Simulator::IsManufactured(), true);
+  EXPECT_EQ(eseed, Simulator::GetEndorsementSeed());
+  Simulator::PowerOff();
+}
+
 } // namespace
 } // namespace tpm_js
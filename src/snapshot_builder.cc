@@ -0,0 +1,82 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Manufactures and starts up the simulator, and writes a C++ source file that
+// defines its snapshot as kBuiltInSnapshot (snapshot_data.h). The NV layout
+// depends on the build, so this runs at build time with the build of the
+// simulator that embeds the snapshot, e.g. with node for WebAssembly.
+//
+// Usage: snapshot_builder OUTPUT
+
+#include <cstdio>
+#include <vector>
+
+#include "app.h"
+#include "simulator.h"
+
+int main(int argc, char **argv) {
+  using namespace tpm_js;
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s OUTPUT\n", argv[0]);
+    return 1;
+  }
+  App *app = App::Get();
+  Simulator::PowerOn();
+  Simulator::ManufactureReset();
+  if (app->Startup() != TPM2_RC_SUCCESS) {
+    fprintf(stderr, "Startup failed\n");
+    return 1;
+  }
+  // The default primary key of the page and the endorsement key take seconds
+  // to create in the browser. Create them here, so that creating them again is
+  // a lookup in the primary key cache of the snapshot.
+  CreatePrimaryResult primary = app->CreatePrimary(
+      TPM2_RH_OWNER, TPM2_ALG_RSA, /*restricted=*/1, /*decrypt=*/1,
+      /*sign=*/0, /*unique=*/"", /*user_auth=*/"", /*sensitive_data=*/"",
+      /*auth_policy=*/{});
+  CreatePrimaryResult endorsement_key = app->CreatePrimaryEndorsementKey();
+  if (primary.rc != TPM2_RC_SUCCESS || endorsement_key.rc != TPM2_RC_SUCCESS) {
+    fprintf(stderr, "CreatePrimary failed\n");
+    return 1;
+  }
+  app->FlushContext(primary.handle);
+  app->FlushContext(endorsement_key.handle);
+  app->Shutdown();
+  Simulator::PowerOff();
+  std::vector<uint8_t> snapshot = Simulator::GetSnapshot();
+  // The simulator keeps its NV in this file.
+  remove("NVChip");
+
+  FILE *out = fopen(argv[1], "w");
+  if (out == nullptr) {
+    perror(argv[1]);
+    return 1;
+  }
+  fprintf(out, "// Generated by snapshot_builder. Do not edit.\n\n"
+               "#include \"snapshot_data.h\"\n\n"
+               "namespace tpm_js {\n\n"
+               "const uint8_t kBuiltInSnapshot[] = {");
+  for (size_t i = 0; i < snapshot.size(); ++i) {
+    fprintf(out, "%s0x%02x,", i % 12 == 0 ? "\n   " : " ", snapshot[i]);
+  }
+  fprintf(out, "\n};\n\n"
+               "const size_t kBuiltInSnapshotSize =\n"
+               "    sizeof(kBuiltInSnapshot);\n\n"
+               "} // namespace tpm_js\n");
+  if (fclose(out) != 0) {
+    perror(argv[1]);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,106 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace tpm_js {
+
+ThreadPool::ThreadPool(int num_threads)
+    : stop_(false), generation_(0), busy_workers_(0), fn_(nullptr), count_(0),
+      next_(0) {
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+}
+
+ThreadPool *ThreadPool::Get() {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  // Wasm without pthreads cannot start threads.
+  static ThreadPool pool(0);
+#else
+  // The calling thread runs iterations as well.
+  static ThreadPool pool(
+      std::max(1u, std::thread::hardware_concurrency()) - 1);
+#endif
+  return &pool;
+}
+
+int ThreadPool::GetNumThreads() const { return workers_.size(); }
+
+void ThreadPool::ParallelFor(size_t count,
+                             const std::function<void(size_t)> &fn) {
+  if (workers_.empty() || count < 2) {
+    for (size_t i = 0; i < count; ++i) {
+      fn(i);
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> run_lock(run_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fn_ = &fn;
+    count_ = count;
+    next_ = 0;
+    busy_workers_ = workers_.size();
+    ++generation_;
+  }
+  work_cv_.notify_all();
+  RunIterations();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return busy_workers_ == 0; });
+  fn_ = nullptr;
+}
+
+void ThreadPool::RunIterations() {
+  for (size_t i = next_++; i < count_; i = next_++) {
+    (*fn_)(i);
+  }
+}
+
+void ThreadPool::WorkerLoop() {
+  uint64_t generation = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this, generation] {
+      return stop_ || generation_ != generation;
+    });
+    if (stop_) {
+      return;
+    }
+    generation = generation_;
+    lock.unlock();
+    RunIterations();
+    lock.lock();
+    if (--busy_workers_ == 0) {
+      done_cv_.notify_one();
+    }
+  }
+}
+
+} // namespace tpm_js
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tpm_js {
+
+// Fixed set of worker threads for data-parallel loops on the host, e.g.
+// verifying many signatures. Never used to call into the simulator, which is
+// single-threaded.
+class ThreadPool {
+public:
+  // Starts num_threads workers. With no workers ParallelFor runs every
+  // iteration on the calling thread.
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  // Returns a process-wide pool with one worker per additional hardware
+  // thread, or no workers where threads are not available.
+  static ThreadPool *Get();
+
+  // Returns the number of worker threads.
+  int GetNumThreads() const;
+
+  // Calls fn(i) for every i in [0, count) on the workers and the calling
+  // thread, and returns when all calls have returned. fn must be safe to call
+  // concurrently. Calls from several threads are serialized.
+  void ParallelFor(size_t count, const std::function<void(size_t)> &fn);
+
+private:
+  // Runs iterations of the current loop until there are none left.
+  void RunIterations();
+
+  void WorkerLoop();
+
+  std::vector<std::thread> workers_;
+
+  // Serializes ParallelFor calls.
+  std::mutex run_mutex_;
+
+  // Guards the fields below, except next_.
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  bool stop_;
+  // Incremented for every loop handed to the workers.
+  uint64_t generation_;
+  // Workers that have not finished the current loop.
+  size_t busy_workers_;
+  const std::function<void(size_t)> *fn_;
+  size_t count_;
+  // Next iteration of the current loop.
+  std::atomic<size_t> next_;
+};
+
+} // namespace tpm_js
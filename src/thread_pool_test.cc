@@ -0,0 +1,52 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "thread_pool.h"
+
+#include <atomic>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace tpm_js {
+namespace {
+
+TEST(ThreadPoolTest, RunsEveryIterationOnce) {
+  for (int num_threads : {0, 1, 4}) {
+    ThreadPool pool(num_threads);
+    EXPECT_EQ(num_threads, pool.GetNumThreads());
+    for (size_t count : {0, 1, 2, 1000}) {
+      std::vector<std::atomic<int>> calls(count);
+      for (auto &call : calls) {
+        call = 0;
+      }
+      pool.ParallelFor(count, [&calls](size_t i) { ++calls[i]; });
+      for (size_t i = 0; i < count; ++i) {
+        EXPECT_EQ(1, calls[i]) << "threads " << num_threads << " index " << i;
+      }
+    }
+  }
+}
+
+TEST(ThreadPoolTest, RunsLoopsBackToBack) {
+  ThreadPool pool(3);
+  std::atomic<int> sum(0);
+  for (int loop = 0; loop < 100; ++loop) {
+    pool.ParallelFor(10, [&sum](size_t i) { sum += i; });
+  }
+  EXPECT_EQ(100 * 45, sum);
+}
+
+} // namespace
+} // namespace tpm_js
@@ -0,0 +1,514 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tpm_server.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "log.h"
+
+extern "C" {
+// clang-format off
+#include "Tpm.h"
+#include "TpmTcpProtocol.h"
+#include "Simulator_fp.h"
+// clang-format on
+}
+
+namespace tpm_js {
+namespace {
+
+// Version reported to TPM_REMOTE_HANDSHAKE, as by the reference server.
+constexpr uint32_t kServerVersion = 1;
+
+// Largest variable size field of a request, as in the reference server.
+constexpr uint32_t kMaxBufferSize = 1 << 20;
+
+// Number of bytes read from a socket at a time.
+constexpr size_t kReceiveSize = 1 << 16;
+
+// Number of events handled per epoll_wait.
+constexpr int kMaxEvents = 64;
+
+// Reads big-endian fields of a request. Reads fail past the received bytes.
+class RequestReader {
+public:
+  RequestReader(const uint8_t *data, size_t size)
+      : data_(data), left_(size), offset_(0) {}
+
+  size_t GetOffset() const { return offset_; }
+
+  bool ReadUint8(uint8_t *value) {
+    if (left_ < 1) {
+      return false;
+    }
+    *value = data_[offset_];
+    Skip(1);
+    return true;
+  }
+
+  bool ReadUint32(uint32_t *value) {
+    if (left_ < 4) {
+      return false;
+    }
+    const uint8_t *p = data_ + offset_;
+    *value = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    Skip(4);
+    return true;
+  }
+
+  // Reads a UINT32 size followed by as many bytes. Fails if the size is over
+  // kMaxBufferSize, which *too_large tells apart from missing bytes.
+  bool ReadVarBytes(const uint8_t **bytes, uint32_t *size, bool *too_large) {
+    *too_large = false;
+    if (!ReadUint32(size)) {
+      return false;
+    }
+    if (*size > kMaxBufferSize) {
+      *too_large = true;
+      return false;
+    }
+    if (left_ < *size) {
+      return false;
+    }
+    *bytes = data_ + offset_;
+    Skip(*size);
+    return true;
+  }
+
+private:
+  void Skip(size_t size) {
+    offset_ += size;
+    left_ -= size;
+  }
+
+  const uint8_t *data_;
+  size_t left_;
+  size_t offset_;
+};
+
+void AppendUint32(uint32_t value, std::vector<uint8_t> *out) {
+  out->push_back(value >> 24);
+  out->push_back(value >> 16);
+  out->push_back(value >> 8);
+  out->push_back(value);
+}
+
+void AppendVarBytes(const uint8_t *data, uint32_t size,
+                    std::vector<uint8_t> *out) {
+  AppendUint32(size, out);
+  out->insert(out->end(), data, data + size);
+}
+
+} // namespace
+
+TpmServer::TpmServer()
+    : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)), command_fd_(-1),
+      platform_fd_(-1), stop_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      stopping_(false), sizes_({}), response_(MAX_RESPONSE_SIZE) {
+  assert(epoll_fd_ >= 0);
+  assert(stop_fd_ >= 0);
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = stop_fd_;
+  int rc = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_fd_, &event);
+  assert(rc == 0);
+  (void)rc;
+}
+
+TpmServer::~TpmServer() {
+  while (!connections_.empty()) {
+    Close(connections_.begin()->second.get());
+  }
+  for (int fd : {command_fd_, platform_fd_, stop_fd_, epoll_fd_}) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+bool TpmServer::Listen(const std::string &address, int command_port,
+                       int platform_port) {
+  command_fd_ = CreateListenSocket(address, command_port);
+  platform_fd_ = CreateListenSocket(address, platform_port);
+  return command_fd_ >= 0 && platform_fd_ >= 0;
+}
+
+int TpmServer::CreateListenSocket(const std::string &address, int port) {
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+    LOG1("Invalid address %s\n", address.c_str());
+    return -1;
+  }
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  const int kOne = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &kOne, sizeof(kOne));
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+      listen(fd, SOMAXCONN) != 0 ||
+      epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+    LOG1("Cannot listen on %s:%d: %s\n", address.c_str(), port,
+         strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int TpmServer::GetCommandPort() const {
+  sockaddr_in addr = {};
+  socklen_t size = sizeof(addr);
+  getsockname(command_fd_, reinterpret_cast<sockaddr *>(&addr), &size);
+  return ntohs(addr.sin_port);
+}
+
+int TpmServer::GetPlatformPort() const {
+  sockaddr_in addr = {};
+  socklen_t size = sizeof(addr);
+  getsockname(platform_fd_, reinterpret_cast<sockaddr *>(&addr), &size);
+  return ntohs(addr.sin_port);
+}
+
+int TpmServer::GetNumConnections() const { return connections_.size(); }
+
+bool TpmServer::Run() {
+  epoll_event events[kMaxEvents];
+  stopping_ = false;
+  while (!stopping_) {
+    int num_events = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+    if (num_events < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    for (int i = 0; i < num_events && !stopping_; ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == stop_fd_) {
+        uint64_t count;
+        (void)read(stop_fd_, &count, sizeof(count));
+        stopping_ = true;
+      } else if (fd == command_fd_ || fd == platform_fd_) {
+        Accept(fd, fd == platform_fd_);
+      } else {
+        // The connection may have been closed by an earlier event.
+        auto it = connections_.find(fd);
+        if (it == connections_.end()) {
+          continue;
+        }
+        Connection *connection = it->second.get();
+        bool ok = !(events[i].events & EPOLLERR);
+        if (ok && (events[i].events & (EPOLLIN | EPOLLHUP))) {
+          ok = Receive(connection);
+        }
+        if (ok && (events[i].events & EPOLLOUT)) {
+          ok = Send(connection);
+        }
+        if (!ok) {
+          Close(connection);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+void TpmServer::Stop() {
+  const uint64_t kOne = 1;
+  (void)write(stop_fd_, &kOne, sizeof(kOne));
+}
+
+void TpmServer::Accept(int listen_fd, bool platform) {
+  for (;;) {
+    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      // EAGAIN once all pending connections are accepted.
+      return;
+    }
+    // Requests and responses are small and strictly alternate.
+    const int kOne = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &kOne, sizeof(kOne));
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+      close(fd);
+      continue;
+    }
+    LOG1("Accepted %s client %d\n", platform ? "platform" : "command", fd);
+    std::unique_ptr<Connection> connection(new Connection());
+    connection->fd = fd;
+    connection->platform = platform;
+    connection->out_offset = 0;
+    connection->writing = false;
+    connections_[fd] = std::move(connection);
+  }
+}
+
+bool TpmServer::Receive(Connection *connection) {
+  bool open = true;
+  for (;;) {
+    const size_t size = connection->in.size();
+    connection->in.resize(size + kReceiveSize);
+    ssize_t received =
+        recv(connection->fd, connection->in.data() + size, kReceiveSize, 0);
+    connection->in.resize(size + std::max<ssize_t>(received, 0));
+    if (received > 0) {
+      continue;
+    }
+    if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+      // The client is gone. There is no one to respond to.
+      open = false;
+    }
+    break;
+  }
+
+  std::vector<uint8_t> &in = connection->in;
+  size_t offset = 0;
+  while (open && offset < in.size()) {
+    size_t size = 0;
+    RequestStatus status =
+        connection->platform
+            ? HandlePlatformRequest(in.data() + offset, in.size() - offset,
+                                    &connection->out, &size)
+            : HandleCommandRequest(in.data() + offset, in.size() - offset,
+                                   &connection->out, &size);
+    if (status == kRequestIncomplete) {
+      break;
+    } else if (status == kRequestClose) {
+      open = false;
+    } else if (status == kRequestStop) {
+      stopping_ = true;
+      open = false;
+    }
+    offset += size;
+  }
+  in.erase(in.begin(), in.begin() + offset);
+  if (!open) {
+    // Best effort, e.g. for the error code of an unrecognized request.
+    Send(connection);
+    return false;
+  }
+  return Send(connection);
+}
+
+TpmServer::RequestStatus
+TpmServer::HandleCommandRequest(const uint8_t *data, size_t data_size,
+                                std::vector<uint8_t> *out, size_t *size) {
+  RequestReader reader(data, data_size);
+  uint32_t command;
+  if (!reader.ReadUint32(&command)) {
+    return kRequestIncomplete;
+  }
+  const uint8_t *bytes;
+  uint32_t bytes_size;
+  bool too_large;
+  switch (command) {
+  case TPM_SIGNAL_HASH_START:
+    _rpc__Signal_Hash_Start();
+    break;
+  case TPM_SIGNAL_HASH_END:
+    _rpc__Signal_HashEnd();
+    break;
+  case TPM_SIGNAL_HASH_DATA: {
+    if (!reader.ReadVarBytes(&bytes, &bytes_size, &too_large)) {
+      return too_large ? kRequestClose : kRequestIncomplete;
+    }
+    _IN_BUFFER in_buffer = {bytes_size, const_cast<uint8_t *>(bytes)};
+    _rpc__Signal_Hash_Data(in_buffer);
+    break;
+  }
+  case TPM_SEND_COMMAND: {
+    uint8_t locality;
+    if (!reader.ReadUint8(&locality)) {
+      return kRequestIncomplete;
+    }
+    if (!reader.ReadVarBytes(&bytes, &bytes_size, &too_large)) {
+      return too_large ? kRequestClose : kRequestIncomplete;
+    }
+    _IN_BUFFER in_buffer = {bytes_size, const_cast<uint8_t *>(bytes)};
+    _OUT_BUFFER out_buffer = {static_cast<uint32_t>(response_.size()),
+                              response_.data()};
+    _rpc__Send_Command(locality, in_buffer, &out_buffer);
+    // Command and response codes are kept in wire order, as by the
+    // reference server.
+    if (bytes_size > sizes_.largest_command_size && bytes_size >= 10) {
+      sizes_.largest_command_size = bytes_size;
+      memcpy(&sizes_.largest_command, bytes + 6, sizeof(uint32_t));
+    }
+    if (out_buffer.BufferSize > sizes_.largest_response_size &&
+        out_buffer.BufferSize >= 10) {
+      sizes_.largest_response_size = out_buffer.BufferSize;
+      memcpy(&sizes_.largest_response, out_buffer.Buffer + 6,
+             sizeof(uint32_t));
+    }
+    AppendVarBytes(out_buffer.Buffer, out_buffer.BufferSize, out);
+    break;
+  }
+  case TPM_REMOTE_HANDSHAKE: {
+    uint32_t client_version;
+    if (!reader.ReadUint32(&client_version)) {
+      return kRequestIncomplete;
+    }
+    if (client_version == 0) {
+      LOG1("Unsupported client version (0)\n");
+      return kRequestClose;
+    }
+    AppendUint32(kServerVersion, out);
+    AppendUint32(tpmInRawMode | tpmPlatformAvailable | tpmSupportsPP, out);
+    break;
+  }
+  case TPM_SET_ALTERNATIVE_RESULT: {
+    uint32_t result;
+    if (!reader.ReadUint32(&result)) {
+      return kRequestIncomplete;
+    }
+    // Alternative result is not applicable to the simulator.
+    break;
+  }
+  case TPM_SESSION_END:
+    return kRequestClose;
+  case TPM_STOP:
+    return kRequestStop;
+  default:
+    LOG1("Unrecognized TPM interface command %08x\n", command);
+    return kRequestClose;
+  }
+  AppendUint32(0, out);
+  *size = reader.GetOffset();
+  return kRequestDone;
+}
+
+TpmServer::RequestStatus
+TpmServer::HandlePlatformRequest(const uint8_t *data, size_t data_size,
+                                 std::vector<uint8_t> *out, size_t *size) {
+  RequestReader reader(data, data_size);
+  uint32_t command;
+  if (!reader.ReadUint32(&command)) {
+    return kRequestIncomplete;
+  }
+  switch (command) {
+  case TPM_SIGNAL_POWER_ON:
+    _rpc__Signal_PowerOn(/*isReset=*/FALSE);
+    break;
+  case TPM_SIGNAL_POWER_OFF:
+    _rpc__Signal_PowerOff();
+    break;
+  case TPM_SIGNAL_RESET:
+    _rpc__Signal_PowerOn(/*isReset=*/TRUE);
+    break;
+  case TPM_SIGNAL_RESTART:
+    _rpc__Signal_Restart();
+    break;
+  case TPM_SIGNAL_PHYS_PRES_ON:
+    _rpc__Signal_PhysicalPresenceOn();
+    break;
+  case TPM_SIGNAL_PHYS_PRES_OFF:
+    _rpc__Signal_PhysicalPresenceOff();
+    break;
+  case TPM_SIGNAL_CANCEL_ON:
+    _rpc__Signal_CancelOn();
+    break;
+  case TPM_SIGNAL_CANCEL_OFF:
+    _rpc__Signal_CancelOff();
+    break;
+  case TPM_SIGNAL_NV_ON:
+    _rpc__Signal_NvOn();
+    break;
+  case TPM_SIGNAL_NV_OFF:
+    _rpc__Signal_NvOff();
+    break;
+  case TPM_SIGNAL_KEY_CACHE_ON:
+    _rpc__RsaKeyCacheControl(TRUE);
+    break;
+  case TPM_SIGNAL_KEY_CACHE_OFF:
+    _rpc__RsaKeyCacheControl(FALSE);
+    break;
+  case TPM_TEST_FAILURE_MODE:
+    _rpc__ForceFailureMode();
+    break;
+  case TPM_GET_COMMAND_RESPONSE_SIZES:
+    AppendVarBytes(reinterpret_cast<const uint8_t *>(&sizes_), sizeof(sizes_),
+                   out);
+    sizes_ = {};
+    break;
+  case TPM_SESSION_END:
+    return kRequestClose;
+  case TPM_STOP:
+    return kRequestStop;
+  default:
+    LOG1("Unrecognized platform interface command %d\n", command);
+    AppendUint32(1, out);
+    return kRequestClose;
+  }
+  AppendUint32(0, out);
+  *size = reader.GetOffset();
+  return kRequestDone;
+}
+
+bool TpmServer::Send(Connection *connection) {
+  std::vector<uint8_t> &out = connection->out;
+  while (connection->out_offset < out.size()) {
+    ssize_t sent = send(connection->fd, out.data() + connection->out_offset,
+                        out.size() - connection->out_offset, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        return false;
+      }
+      break;
+    }
+    connection->out_offset += sent;
+  }
+  const bool writing = connection->out_offset < out.size();
+  if (!writing) {
+    out.clear();
+    connection->out_offset = 0;
+  }
+  if (writing != connection->writing) {
+    epoll_event event = {};
+    event.events = writing ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.fd = connection->fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection->fd, &event) != 0) {
+      return false;
+    }
+    connection->writing = writing;
+  }
+  return true;
+}
+
+void TpmServer::Close(Connection *connection) {
+  LOG1("Closing client %d\n", connection->fd);
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection->fd, nullptr);
+  close(connection->fd);
+  connections_.erase(connection->fd);
+}
+
+} // namespace tpm_js
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tpm_js {
+
+// Serves the simulator over the TCP protocol of the reference simulator
+// (third_party/ibmswtpm2/src/TpmTcpProtocol.h), as spoken by the mssim TCTI:
+// TPM commands on the command port, and power, NV and other signals on the
+// platform port. Any number of clients may connect to either port. They are
+// served from one epoll event loop and share the simulator, which runs their
+// requests one at a time in the order they arrive. Linux only.
+class TpmServer {
+public:
+  TpmServer();
+  ~TpmServer();
+
+  // Listens on command_port and platform_port of address, e.g. "127.0.0.1".
+  // A port of 0 picks a free port. Returns false on failure.
+  bool Listen(const std::string &address, int command_port,
+              int platform_port);
+
+  // Ports listened on, once Listen succeeds.
+  int GetCommandPort() const;
+  int GetPlatformPort() const;
+
+  int GetNumConnections() const;
+
+  // Serves clients until one sends TPM_STOP or Stop is called. Returns false
+  // if the event loop fails.
+  bool Run();
+
+  // Makes Run return. May be called from any thread.
+  void Stop();
+
+private:
+  struct Connection {
+    int fd;
+    // True for connections to the platform port.
+    bool platform;
+    // Received bytes not handled yet.
+    std::vector<uint8_t> in;
+    // Responses not sent yet, from out_offset on.
+    std::vector<uint8_t> out;
+    size_t out_offset;
+    // True while the event loop waits for the socket to be writable.
+    bool writing;
+  };
+
+  // Outcome of handling a request.
+  enum RequestStatus {
+    // The request is not fully received yet.
+    kRequestIncomplete,
+    kRequestDone,
+    // The connection is to be closed.
+    kRequestClose,
+    // The server is to stop.
+    kRequestStop,
+  };
+
+  // Largest command and response seen, for TPM_GET_COMMAND_RESPONSE_SIZES.
+  // Fields are in host byte order, as with the reference server.
+  struct CommandResponseSizes {
+    uint32_t largest_command_size;
+    uint32_t largest_command;
+    uint32_t largest_response_size;
+    uint32_t largest_response;
+  };
+
+  // Creates a non-blocking socket listening on address and port, and adds it
+  // to the event loop. Returns the socket, or -1 on failure.
+  int CreateListenSocket(const std::string &address, int port);
+
+  // Accepts all pending connections of listen_fd.
+  void Accept(int listen_fd, bool platform);
+
+  // Reads what connection received and handles all complete requests.
+  // Returns false if the connection is to be closed.
+  bool Receive(Connection *connection);
+
+  // Handles the request at the start of the data_size bytes at data, and
+  // appends the response to out. Sets *size to the size of the request, unless
+  // it is incomplete.
+  RequestStatus HandleCommandRequest(const uint8_t *data, size_t data_size,
+                                     std::vector<uint8_t> *out, size_t *size);
+  RequestStatus HandlePlatformRequest(const uint8_t *data, size_t data_size,
+                                      std::vector<uint8_t> *out, size_t *size);
+
+  // Sends as much of connection->out as the socket takes, and waits for the
+  // socket to be writable if some is left. Returns false on failure.
+  bool Send(Connection *connection);
+
+  void Close(Connection *connection);
+
+  int epoll_fd_;
+  int command_fd_;
+  int platform_fd_;
+  // eventfd that Stop signals.
+  int stop_fd_;
+  bool stopping_;
+  std::map<int, std::unique_ptr<Connection>> connections_;
+  CommandResponseSizes sizes_;
+  // Buffer the simulator writes responses to.
+  std::vector<uint8_t> response_;
+};
+
+} // namespace tpm_js
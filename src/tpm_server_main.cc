@@ -0,0 +1,106 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Serves the simulator over TCP, e.g. to tpm2-tools with
+// --tcti=mssim:host=localhost,port=2321.
+//
+// Usage: tpm_server [-port N] [-shm NAME] [-rm]
+//   -port N    Command port. The platform port is N + 1. Defaults to 2321.
+//   -shm NAME  Serves the ShmChannel NAME, e.g. /tpm-js, instead of TCP, to a
+//              ShmTcti on the same host. The TPM is powered on.
+//   -rm        Manufactures the TPM again, erasing its NV state.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include "shm_channel.h"
+#include "shm_server.h"
+#include "simulator.h"
+#include "tpm_server.h"
+
+namespace {
+
+// Default command port of the reference simulator.
+constexpr int kDefaultPort = 2321;
+
+// Returns true if the simulator has NV state from an earlier run.
+bool HasNvState() {
+  FILE *file = fopen("NVChip", "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  fclose(file);
+  return true;
+}
+
+void PrintUsage(const char *program) {
+  fprintf(stderr, "Usage: %s [-port N] [-shm NAME] [-rm]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  using namespace tpm_js;
+  int port = kDefaultPort;
+  const char *shm_name = nullptr;
+  bool manufacture = false;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-port") == 0 && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-shm") == 0 && i + 1 < argc) {
+      shm_name = argv[++i];
+    } else if (strcmp(argv[i], "-rm") == 0) {
+      manufacture = true;
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (port <= 0 || port >= 0xFFFF) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  // As the reference simulator, manufactures the TPM the first time it runs,
+  // and leaves it powered off for the platform port to power on.
+  manufacture = manufacture || !HasNvState();
+  Simulator::PowerOn();
+  if (manufacture) {
+    Simulator::ManufactureReset();
+  }
+
+  if (shm_name != nullptr) {
+    // Shared memory clients have no platform port to power on the TPM.
+    std::unique_ptr<ShmChannel> channel = ShmChannel::Create(shm_name);
+    if (channel == nullptr) {
+      return 1;
+    }
+    printf("TPM command server serving %s\n", shm_name);
+    fflush(stdout);
+    ShmServer(channel.get()).Run();
+    return 0;
+  }
+  Simulator::PowerOff();
+
+  TpmServer server;
+  if (!server.Listen("127.0.0.1", port, port + 1)) {
+    return 1;
+  }
+  printf("TPM command server listening on port %d\n", server.GetCommandPort());
+  printf("Platform server listening on port %d\n", server.GetPlatformPort());
+  fflush(stdout);
+  return server.Run() ? 0 : 1;
+}
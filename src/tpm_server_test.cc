@@ -0,0 +1,201 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tpm_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "simulator.h"
+
+#include <gtest/gtest.h>
+
+namespace tpm_js {
+namespace {
+
+// Requests of TpmTcpProtocol.h.
+const uint32_t kSignalPowerOn = 1;
+const uint32_t kSignalNvOn = 11;
+const uint32_t kSendCommand = 8;
+const uint32_t kRemoteHandshake = 15;
+const uint32_t kSessionEnd = 20;
+const uint32_t kStop = 21;
+
+// TPM2_Startup(TPM2_SU_CLEAR).
+const std::vector<uint8_t> kStartup = {0x80, 0x01, 0x00, 0x00, 0x00, 0x0c,
+                                       0x00, 0x00, 0x01, 0x44, 0x00, 0x00};
+
+// TPM2_GetRandom of 16 bytes.
+const std::vector<uint8_t> kGetRandom = {0x80, 0x01, 0x00, 0x00, 0x00, 0x0c,
+                                         0x00, 0x00, 0x01, 0x7b, 0x00, 0x10};
+
+// Blocking client of TpmServer.
+class Client {
+public:
+  explicit Client(int port) : fd_(socket(AF_INET, SOCK_STREAM, 0)) {
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    EXPECT_EQ(0, connect(fd_, reinterpret_cast<sockaddr *>(&addr),
+                         sizeof(addr)));
+  }
+
+  ~Client() { close(fd_); }
+
+  void Write(const std::vector<uint8_t> &data) {
+    EXPECT_EQ(data.size(), send(fd_, data.data(), data.size(), 0));
+  }
+
+  void WriteUint32(uint32_t value) {
+    Write({static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+           static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)});
+  }
+
+  // Returns the TPM_SEND_COMMAND request of command at locality 0.
+  static std::vector<uint8_t>
+  SendCommandRequest(const std::vector<uint8_t> &command) {
+    std::vector<uint8_t> request = {0, 0, 0, kSendCommand, /*locality=*/0, 0,
+                                    0, 0, static_cast<uint8_t>(command.size())};
+    request.insert(request.end(), command.begin(), command.end());
+    return request;
+  }
+
+  // Returns 0xFFFFFFFF if the server closed the connection.
+  uint32_t ReadUint32() {
+    uint8_t bytes[4];
+    if (!Read(bytes, sizeof(bytes))) {
+      return 0xFFFFFFFF;
+    }
+    return (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+  }
+
+  std::vector<uint8_t> ReadVarBytes() {
+    std::vector<uint8_t> bytes(ReadUint32());
+    EXPECT_TRUE(Read(bytes.data(), bytes.size()));
+    return bytes;
+  }
+
+  // Sends command and returns the response.
+  std::vector<uint8_t> SendCommand(const std::vector<uint8_t> &command) {
+    Write(SendCommandRequest(command));
+    std::vector<uint8_t> response = ReadVarBytes();
+    EXPECT_EQ(0, ReadUint32());
+    return response;
+  }
+
+private:
+  bool Read(uint8_t *data, size_t size) {
+    while (size > 0) {
+      ssize_t received = recv(fd_, data, size, 0);
+      if (received <= 0) {
+        return false;
+      }
+      data += received;
+      size -= received;
+    }
+    return true;
+  }
+
+  int fd_;
+};
+
+// Returns the response code of a TPM response.
+uint32_t GetResponseCode(const std::vector<uint8_t> &response) {
+  EXPECT_LE(10, response.size());
+  return (response[6] << 24) | (response[7] << 16) | (response[8] << 8) |
+         response[9];
+}
+
+class TpmServerTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Simulator::PowerOff();
+    Simulator::PowerOn();
+    Simulator::ManufactureReset();
+    Simulator::PowerOff();
+    ASSERT_TRUE(server_.Listen("127.0.0.1", 0, 0));
+    thread_ = std::thread([this]() { EXPECT_TRUE(server_.Run()); });
+  }
+
+  void TearDown() override {
+    if (thread_.joinable()) {
+      server_.Stop();
+      thread_.join();
+    }
+    Simulator::PowerOff();
+  }
+
+  TpmServer server_;
+  std::thread thread_;
+};
+
+TEST_F(TpmServerTest, ServesManyClients) {
+  Client platform(server_.GetPlatformPort());
+  platform.WriteUint32(kSignalPowerOn);
+  EXPECT_EQ(0, platform.ReadUint32());
+  platform.WriteUint32(kSignalNvOn);
+  EXPECT_EQ(0, platform.ReadUint32());
+
+  std::vector<std::unique_ptr<Client>> clients;
+  for (int i = 0; i < 8; ++i) {
+    clients.emplace_back(new Client(server_.GetCommandPort()));
+    clients.back()->WriteUint32(kRemoteHandshake);
+    clients.back()->WriteUint32(/*client_version=*/1);
+    EXPECT_EQ(1, clients.back()->ReadUint32());
+    EXPECT_NE(0, clients.back()->ReadUint32());
+    EXPECT_EQ(0, clients.back()->ReadUint32());
+  }
+  EXPECT_EQ(0, GetResponseCode(clients[0]->SendCommand(kStartup)));
+
+  // Requests of all clients in flight at once.
+  for (auto &client : clients) {
+    client->Write(Client::SendCommandRequest(kGetRandom));
+  }
+  for (auto &client : clients) {
+    std::vector<uint8_t> response = client->ReadVarBytes();
+    EXPECT_EQ(0, client->ReadUint32());
+    EXPECT_EQ(0, GetResponseCode(response));
+    EXPECT_EQ(10 + 2 + 16, response.size());
+  }
+
+  // A request that arrives a byte at a time.
+  for (uint8_t byte : Client::SendCommandRequest(kGetRandom)) {
+    clients[1]->Write({byte});
+  }
+  std::vector<uint8_t> response = clients[1]->ReadVarBytes();
+  EXPECT_EQ(0, clients[1]->ReadUint32());
+  EXPECT_EQ(0, GetResponseCode(response));
+
+  // Ending a session only closes that connection.
+  clients[2]->WriteUint32(kSessionEnd);
+  EXPECT_EQ(0xFFFFFFFF, clients[2]->ReadUint32());
+  EXPECT_EQ(0, GetResponseCode(clients[3]->SendCommand(kGetRandom)));
+}
+
+TEST_F(TpmServerTest, StopsOnRequest) {
+  Client client(server_.GetCommandPort());
+  client.WriteUint32(kStop);
+  thread_.join();
+  EXPECT_EQ(0xFFFFFFFF, client.ReadUint32());
+}
+
+} // namespace
+} // namespace tpm_js
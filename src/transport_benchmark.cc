@@ -0,0 +1,185 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of the round trip of small commands through each transport to
+// the simulator. Prints the time per command of each benchmark.
+
+#include <arpa/inet.h>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "shm_channel.h"
+#include "shm_server.h"
+#include "simulator.h"
+#include "tpm_server.h"
+
+namespace tpm_js {
+namespace {
+
+// Number of commands per benchmark.
+const int kNumCommands = 20000;
+
+// TPM2_Startup(TPM2_SU_CLEAR).
+const std::vector<uint8_t> kStartup = {0x80, 0x01, 0x00, 0x00, 0x00, 0x0c,
+                                       0x00, 0x00, 0x01, 0x44, 0x00, 0x00};
+
+// TPM2_GetRandom of 16 bytes.
+const std::vector<uint8_t> kGetRandom = {0x80, 0x01, 0x00, 0x00, 0x00, 0x0c,
+                                         0x00, 0x00, 0x01, 0x7b, 0x00, 0x10};
+
+// TPM2_PCR_Read of SHA256 PCR 0.
+const std::vector<uint8_t> kPcrRead = {0x80, 0x01, 0x00, 0x00, 0x00, 0x14, 0x00,
+                                       0x00, 0x01, 0x7e, 0x00, 0x00, 0x00, 0x01,
+                                       0x00, 0x0b, 0x03, 0x01, 0x00, 0x00};
+
+// Sends a command and returns its response.
+using RoundTrip = std::function<std::vector<uint8_t>(
+    const std::vector<uint8_t> &)>;
+
+// Runs kNumCommands round trips of command, and prints the time per command.
+void RunBenchmark(const std::string &name, const std::vector<uint8_t> &command,
+                  const RoundTrip &round_trip) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kNumCommands; ++i) {
+    std::vector<uint8_t> response = round_trip(command);
+    assert(response.size() >= 10 && response[9] == 0);
+    (void)response;
+  }
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  printf("%-32s %8d ops %12.1f us/op\n", name.c_str(), kNumCommands,
+         elapsed.count() / kNumCommands);
+}
+
+void RunBenchmarks(const std::string &transport, const RoundTrip &round_trip) {
+  RunBenchmark(transport + "/GetRandom", kGetRandom, round_trip);
+  RunBenchmark(transport + "/PCR_Read", kPcrRead, round_trip);
+}
+
+void BenchmarkDirect() {
+  RunBenchmarks("Direct", Simulator::ExecuteCommand);
+}
+
+void BenchmarkShm() {
+  const std::string kName = "/tpm-js-transport-benchmark";
+  std::unique_ptr<ShmChannel> channel = ShmChannel::Create(kName);
+  assert(channel != nullptr);
+  ShmServer server(channel.get());
+  std::thread thread([&server]() { server.Run(); });
+
+  std::unique_ptr<ShmChannel> client = ShmChannel::Open(kName);
+  assert(client != nullptr);
+  std::vector<uint8_t> response(ShmRing::kMaxFrameSize);
+  RunBenchmarks("Shm", [&](const std::vector<uint8_t> &command) {
+    bool pushed = client->GetCommands()->Push(command.data(), command.size());
+    assert(pushed);
+    (void)pushed;
+    size_t size = response.size();
+    ShmStatus status = client->GetResponses()->Pop(response.data(), &size,
+                                                   /*timeout_ms=*/-1);
+    assert(status == kShmOk);
+    (void)status;
+    return std::vector<uint8_t>(response.begin(), response.begin() + size);
+  });
+  server.Stop();
+  thread.join();
+}
+
+// Sends all of data to fd.
+void SendAll(int fd, const uint8_t *data, size_t size) {
+  while (size > 0) {
+    ssize_t sent = send(fd, data, size, 0);
+    assert(sent > 0);
+    data += sent;
+    size -= sent;
+  }
+}
+
+// Receives size bytes from fd into data.
+void ReceiveAll(int fd, uint8_t *data, size_t size) {
+  while (size > 0) {
+    ssize_t received = recv(fd, data, size, 0);
+    assert(received > 0);
+    data += received;
+    size -= received;
+  }
+}
+
+uint32_t ReadUint32(const uint8_t *p) {
+  return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+void BenchmarkTcp() {
+  TpmServer server;
+  bool listening = server.Listen("127.0.0.1", 0, 0);
+  assert(listening);
+  (void)listening;
+  std::thread thread([&server]() { server.Run(); });
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(server.GetCommandPort());
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  int rc = connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+  assert(rc == 0);
+  (void)rc;
+  const int kOne = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &kOne, sizeof(kOne));
+  RunBenchmarks("Tcp", [fd](const std::vector<uint8_t> &command) {
+    // TPM_SEND_COMMAND, locality 0, and the command.
+    std::vector<uint8_t> request = {0, 0, 0, 8, 0, 0, 0, 0,
+                                    static_cast<uint8_t>(command.size())};
+    request.insert(request.end(), command.begin(), command.end());
+    SendAll(fd, request.data(), request.size());
+    uint8_t size[4];
+    ReceiveAll(fd, size, sizeof(size));
+    std::vector<uint8_t> response(ReadUint32(size));
+    ReceiveAll(fd, response.data(), response.size());
+    uint8_t ack[4];
+    ReceiveAll(fd, ack, sizeof(ack));
+    return response;
+  });
+  close(fd);
+  server.Stop();
+  thread.join();
+}
+
+} // namespace
+} // namespace tpm_js
+
+int main() {
+  using namespace tpm_js;
+  Simulator::PowerOff();
+  Simulator::PowerOn();
+  Simulator::ManufactureReset();
+  std::vector<uint8_t> response = Simulator::ExecuteCommand(kStartup);
+  assert(response.size() == 10 && response[9] == 0);
+  (void)response;
+  BenchmarkDirect();
+  BenchmarkShm();
+  BenchmarkTcp();
+  Simulator::PowerOff();
+  return 0;
+}
@@ -15,11 +15,17 @@
 #include "tss_adapter.h"
 
 #include <cassert>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string.h>
 
+#ifndef BUILDING_WASM
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 #include "debug.h"
 #include "log.h"
 
@@ -28,41 +34,6 @@
 namespace tpm_js {
 namespace {
 
-//
-// Initialize a SAPI context using the TCTI context provided by the caller.
-// This function allocates memory for the SAPI context and returns it to the
-// caller. This memory must be freed by the caller.
-//
-TSS2_SYS_CONTEXT *sapi_init_from_tcti_ctx(TSS2_TCTI_CONTEXT *tcti_ctx) {
-  TSS2_SYS_CONTEXT *sapi_ctx;
-  TSS2_RC rc;
-  size_t size;
-  TSS2_ABI_VERSION abi_version = TSS2_ABI_VERSION_CURRENT;
-
-  size = Tss2_Sys_GetContextSize(0);
-  sapi_ctx = (TSS2_SYS_CONTEXT *)calloc(1, size);
-  if (sapi_ctx == NULL) {
-    fprintf(stderr, "Failed to allocate 0x%zx bytes for the SAPI context\n",
-            size);
-    return NULL;
-  }
-  rc = Tss2_Sys_Initialize(sapi_ctx, size, tcti_ctx, &abi_version);
-  if (rc != TSS2_RC_SUCCESS) {
-    fprintf(stderr, "Failed to initialize SAPI context: 0x%x\n", rc);
-    free(sapi_ctx);
-    return NULL;
-  }
-  return sapi_ctx;
-}
-
-//
-// Teardown and free the resources associated with a SAPI context structure.
-//
-void sapi_teardown(TSS2_SYS_CONTEXT *sapi_context) {
-  Tss2_Sys_Finalize(sapi_context);
-  free(sapi_context);
-}
-
 std::string HexDumpBuffer(const std::vector<uint8_t> &buffer) {
   std::stringstream outstream;
   uint8_t buff[17];
@@ -131,8 +102,53 @@ uint32_t UnmarshalCodeFromHeader(const std::vector<uint8_t> &buffer) {
 
 } // namespace
 
-TssAdapter::TssAdapter(RunCommand runner)
-    : runner_(runner), tcti_context_({}), sys_context_(nullptr) {
+void *GetTctiOpaque(TSS2_TCTI_CONTEXT *tcti_context) {
+  TSS2_TCTI_CONTEXT_ADAPTER *context =
+      reinterpret_cast<TSS2_TCTI_CONTEXT_ADAPTER *>(
+          reinterpret_cast<char *>(tcti_context) -
+          offsetof(TSS2_TCTI_CONTEXT_ADAPTER, common));
+  return context->opaque;
+}
+
+//
+// Initialize a SAPI context using the TCTI context provided by the caller.
+// This function allocates memory for the SAPI context and returns it to the
+// caller. This memory must be freed with DestroySysContext.
+//
+TSS2_SYS_CONTEXT *CreateSysContext(TSS2_TCTI_CONTEXT *tcti_ctx) {
+  TSS2_SYS_CONTEXT *sapi_ctx;
+  TSS2_RC rc;
+  size_t size;
+  TSS2_ABI_VERSION abi_version = TSS2_ABI_VERSION_CURRENT;
+
+  size = Tss2_Sys_GetContextSize(0);
+  sapi_ctx = (TSS2_SYS_CONTEXT *)calloc(1, size);
+  if (sapi_ctx == NULL) {
+    fprintf(stderr, "Failed to allocate 0x%zx bytes for the SAPI context\n",
+            size);
+    return NULL;
+  }
+  rc = Tss2_Sys_Initialize(sapi_ctx, size, tcti_ctx, &abi_version);
+  if (rc != TSS2_RC_SUCCESS) {
+    fprintf(stderr, "Failed to initialize SAPI context: 0x%x\n", rc);
+    free(sapi_ctx);
+    return NULL;
+  }
+  return sapi_ctx;
+}
+
+//
+// Teardown and free the resources associated with a SAPI context structure.
+//
+void DestroySysContext(TSS2_SYS_CONTEXT *sapi_context) {
+  Tss2_Sys_Finalize(sapi_context);
+  free(sapi_context);
+}
+
+TssAdapter::TssAdapter(RunCommand runner, Mode mode)
+    : runner_(runner), execute_(nullptr), mode_(mode), tcti_context_({}),
+      sys_context_(nullptr), set_nv_commit_deferred_(nullptr), stop_(false),
+      command_queued_(false), response_ready_(false), poll_fd_(-1) {
   // Init TCTI adapter
   tcti_context_.common.magic = 0;
   tcti_context_.common.version = 1;
@@ -143,46 +159,227 @@ TssAdapter::TssAdapter(RunCommand runner)
   tcti_context_.common.getPollHandles = nullptr;
   tcti_context_.common.setLocality = nullptr;
   tcti_context_.opaque = this;
-  sys_context_ = sapi_init_from_tcti_ctx(
+  sys_context_ = CreateSysContext(
       reinterpret_cast<TSS2_TCTI_CONTEXT *>(&tcti_context_.common));
   assert(sys_context_ != nullptr);
+
+  if (mode_ == kWorker) {
+#ifdef BUILDING_WASM
+    assert(false && "kWorker is not available with emscripten");
+#else
+    poll_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    assert(poll_fd_ >= 0);
+    tcti_context_.common.getPollHandles = &TssAdapter::GetPollHandlesWrapper;
+    worker_ = std::thread(&TssAdapter::WorkerLoop, this);
+#endif
+  }
 }
 
-TssAdapter::~TssAdapter() { sapi_teardown(sys_context_); }
+TssAdapter::TssAdapter(ExecuteCommand execute)
+    : TssAdapter(nullptr, kSynchronous) {
+  execute_ = execute;
+}
+
+TssAdapter::~TssAdapter() {
+  if (worker_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    command_cv_.notify_one();
+    worker_.join();
+  }
+#ifndef BUILDING_WASM
+  if (poll_fd_ >= 0) {
+    close(poll_fd_);
+  }
+#endif
+  DestroySysContext(sys_context_);
+}
 
 TSS2_SYS_CONTEXT *TssAdapter::GetSysContext() { return sys_context_; }
 
+void TssAdapter::EnableResponseCache(
+    ResponseCache::StateGeneration state_generation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  response_cache_.reset(new ResponseCache(state_generation));
+}
+
+void TssAdapter::EnableNvCommitDeferral(SetNvCommitDeferred set_deferred) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  set_nv_commit_deferred_ = set_deferred;
+}
+
+TSS2_RC TssAdapter::DeferNvCommits(bool deferred) {
+  // The worker only runs commands while command_queued_ is set, and cannot
+  // pick up a new one while mutex_ is held.
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (set_nv_commit_deferred_ == nullptr) {
+    return TSS2_RC_SUCCESS;
+  }
+  if (command_queued_) {
+    return TSS2_TCTI_RC_BAD_SEQUENCE;
+  }
+  if (set_nv_commit_deferred_(deferred) != 0) {
+    return TPM2_RC_NV_UNAVAILABLE;
+  }
+  return TSS2_RC_SUCCESS;
+}
+
+const std::vector<uint8_t> *TssAdapter::FindCachedResponse() {
+  if (!response_cache_) {
+    return nullptr;
+  }
+  const std::vector<uint8_t> *response =
+      response_cache_->Find(pending_command_.data(), pending_command_.size());
+  if (response != nullptr) {
+    LOG1("Cached response to command %s\n",
+         GetTpmCommandName(UnmarshalCodeFromHeader(pending_command_)).c_str());
+  }
+  return response;
+}
+
+std::vector<uint8_t>
+TssAdapter::Execute(const std::vector<uint8_t> &command) {
+  LOG1("About to execute command %s\n",
+       GetTpmCommandName(UnmarshalCodeFromHeader(command)).c_str());
+  LOG2("Command buffer (%d):\n%s", command.size(),
+       HexDumpBuffer(command).c_str());
+  std::vector<uint8_t> response = runner_(command);
+  LOG2("Response buffer (%d):\n%s", response.size(),
+       HexDumpBuffer(response).c_str());
+  return response;
+}
+
+void TssAdapter::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    command_cv_.wait(lock, [this]() { return stop_ || command_queued_; });
+    if (stop_) {
+      return;
+    }
+    // The TSS sends no other command until it receives the response, so
+    // pending_command_ stays put while the command runs.
+    const uint64_t generation =
+        response_cache_ ? response_cache_->GetGeneration() : 0;
+    lock.unlock();
+    std::vector<uint8_t> response = Execute(pending_command_);
+    lock.lock();
+    if (response_cache_) {
+      response_cache_->Insert(pending_command_.data(), pending_command_.size(),
+                              response.data(), response.size(), generation);
+    }
+    response_ = std::move(response);
+    command_queued_ = false;
+    response_ready_ = true;
+#ifndef BUILDING_WASM
+    const uint64_t kOne = 1;
+    (void)write(poll_fd_, &kOne, sizeof(kOne));
+#endif
+    response_cv_.notify_all();
+  }
+}
+
 TSS2_RC TssAdapter::SendCommand(size_t command_size,
                                 uint8_t const *command_buffer) {
-  std::vector<uint8_t> data(command_buffer, command_buffer + command_size);
-  pending_command_ = data;
+  if (mode_ == kSynchronous) {
+    pending_command_.assign(command_buffer, command_buffer + command_size);
+    return TSS2_RC_SUCCESS;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (command_queued_ || response_ready_) {
+      return TSS2_TCTI_RC_BAD_SEQUENCE;
+    }
+    pending_command_.assign(command_buffer, command_buffer + command_size);
+    const std::vector<uint8_t> *cached = FindCachedResponse();
+    if (cached != nullptr) {
+      // Ready right away, with no trip to the worker.
+      response_ = *cached;
+      response_ready_ = true;
+#ifndef BUILDING_WASM
+      const uint64_t kOne = 1;
+      (void)write(poll_fd_, &kOne, sizeof(kOne));
+#endif
+      return TSS2_RC_SUCCESS;
+    }
+    command_queued_ = true;
+  }
+  command_cv_.notify_one();
   return TSS2_RC_SUCCESS;
 }
 
 TSS2_RC TssAdapter::SendCommandWrapper(TSS2_TCTI_CONTEXT *tcti_context,
                                        size_t command_size,
                                        uint8_t const *command_buffer) {
-  TSS2_TCTI_CONTEXT_ADAPTER *context =
-      reinterpret_cast<TSS2_TCTI_CONTEXT_ADAPTER *>(
-          reinterpret_cast<char *>(tcti_context) -
-          offsetof(TSS2_TCTI_CONTEXT_ADAPTER, common));
-  TssAdapter *that = reinterpret_cast<TssAdapter *>(context->opaque);
+  TssAdapter *that =
+      reinterpret_cast<TssAdapter *>(GetTctiOpaque(tcti_context));
   return that->SendCommand(command_size, command_buffer);
 }
 
 TSS2_RC TssAdapter::ReceiveResponse(size_t *response_size,
                                     unsigned char *response_buffer,
-                                    int32_t unused_timeout) {
-  LOG1("About to execute command %s\n",
-       GetTpmCommandName(UnmarshalCodeFromHeader(pending_command_)).c_str());
-  LOG2("Command buffer (%d):\n%s", pending_command_.size(),
-       HexDumpBuffer(pending_command_).c_str());
-  const std::vector<uint8_t> data = runner_(pending_command_);
-  LOG2("Response buffer (%d):\n%s", data.size(), HexDumpBuffer(data).c_str());
-  assert(data.size() <= *response_size);
-  *response_size = data.size();
-  memcpy(response_buffer, data.data(), data.size());
-  pending_command_ = {};
+                                    int32_t timeout) {
+  if (mode_ == kSynchronous) {
+    const std::vector<uint8_t> *cached = FindCachedResponse();
+    if (cached != nullptr) {
+      assert(cached->size() <= *response_size);
+      *response_size = cached->size();
+      memcpy(response_buffer, cached->data(), cached->size());
+      return TSS2_RC_SUCCESS;
+    }
+    const uint64_t generation =
+        response_cache_ ? response_cache_->GetGeneration() : 0;
+    if (execute_ != nullptr) {
+      // The TSS uses the same buffer for the command and the response, which
+      // is why transmit copies the command.
+      execute_(pending_command_.data(), pending_command_.size(),
+               response_buffer, response_size);
+      if (response_cache_) {
+        response_cache_->Insert(pending_command_.data(),
+                                pending_command_.size(), response_buffer,
+                                *response_size, generation);
+      }
+      return TSS2_RC_SUCCESS;
+    }
+    const std::vector<uint8_t> data = Execute(pending_command_);
+    assert(data.size() <= *response_size);
+    *response_size = data.size();
+    memcpy(response_buffer, data.data(), data.size());
+    if (response_cache_) {
+      response_cache_->Insert(pending_command_.data(), pending_command_.size(),
+                              data.data(), data.size(), generation);
+    }
+    pending_command_ = {};
+    return TSS2_RC_SUCCESS;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!command_queued_ && !response_ready_) {
+    return TSS2_TCTI_RC_BAD_SEQUENCE;
+  }
+  auto ready = [this]() { return response_ready_; };
+  if (timeout == TSS2_TCTI_TIMEOUT_BLOCK) {
+    response_cv_.wait(lock, ready);
+  } else if (!response_cv_.wait_for(lock, std::chrono::milliseconds(timeout),
+                                    ready)) {
+    return TSS2_TCTI_RC_TRY_AGAIN;
+  }
+  // A null buffer asks for the size of the response.
+  if (response_buffer == nullptr) {
+    *response_size = response_.size();
+    return TSS2_RC_SUCCESS;
+  }
+  if (response_.size() > *response_size) {
+    return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+  }
+  *response_size = response_.size();
+  memcpy(response_buffer, response_.data(), response_.size());
+  response_ready_ = false;
+#ifndef BUILDING_WASM
+  uint64_t count;
+  (void)read(poll_fd_, &count, sizeof(count));
+#endif
   return TSS2_RC_SUCCESS;
 }
 
@@ -190,12 +387,35 @@ TSS2_RC TssAdapter::ReceiveResponseWrapper(TSS2_TCTI_CONTEXT *tcti_context,
                                            size_t *response_size,
                                            unsigned char *response_buffer,
                                            int32_t timeout) {
-  TSS2_TCTI_CONTEXT_ADAPTER *context =
-      reinterpret_cast<TSS2_TCTI_CONTEXT_ADAPTER *>(
-          reinterpret_cast<char *>(tcti_context) -
-          offsetof(TSS2_TCTI_CONTEXT_ADAPTER, common));
-  TssAdapter *that = reinterpret_cast<TssAdapter *>(context->opaque);
+  TssAdapter *that =
+      reinterpret_cast<TssAdapter *>(GetTctiOpaque(tcti_context));
   return that->ReceiveResponse(response_size, response_buffer, timeout);
 }
 
+TSS2_RC TssAdapter::GetPollHandles(TSS2_TCTI_POLL_HANDLE *handles,
+                                   size_t *num_handles) {
+#ifdef BUILDING_WASM
+  return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+#else
+  if (handles != nullptr) {
+    if (*num_handles < 1) {
+      return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+    handles[0].fd = poll_fd_;
+    handles[0].events = POLLIN;
+    handles[0].revents = 0;
+  }
+  *num_handles = 1;
+  return TSS2_RC_SUCCESS;
+#endif
+}
+
+TSS2_RC TssAdapter::GetPollHandlesWrapper(TSS2_TCTI_CONTEXT *tcti_context,
+                                          TSS2_TCTI_POLL_HANDLE *handles,
+                                          size_t *num_handles) {
+  TssAdapter *that =
+      reinterpret_cast<TssAdapter *>(GetTctiOpaque(tcti_context));
+  return that->GetPollHandles(handles, num_handles);
+}
+
 } // namespace tpm_js
@@ -16,25 +16,102 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "tss2_sys.h"
 #include "tss2_tcti.h"
 
+#include "response_cache.h"
+
 namespace tpm_js {
 
+// Extends TSS2_TCTI_CONTEXT_COMMON_V1 with an opaque pointer.
+// This pointer holds the instance that implements the TCTI, e.g. TssAdapter.
+typedef struct {
+  TSS2_TCTI_CONTEXT_COMMON_V1 common;
+  void *opaque;
+} TSS2_TCTI_CONTEXT_ADAPTER;
+
+// Returns the opaque pointer of a TSS2_TCTI_CONTEXT_ADAPTER.
+void *GetTctiOpaque(TSS2_TCTI_CONTEXT *tcti_context);
+
+// Creates a SAPI context on top of tcti_context. Returns nullptr on failure.
+TSS2_SYS_CONTEXT *CreateSysContext(TSS2_TCTI_CONTEXT *tcti_context);
+
+void DestroySysContext(TSS2_SYS_CONTEXT *sys_context);
+
 // Adapter between Intel TSS software stack and TPM-JS simulator.
 class TssAdapter {
 public:
   using RunCommand =
       std::function<std::vector<uint8_t>(const std::vector<uint8_t> &)>;
-  explicit TssAdapter(RunCommand runner);
+
+  // Where runner executes commands.
+  enum Mode {
+    // On the calling thread, when the TSS receives the response.
+    kSynchronous,
+    // On a worker thread. Transmit returns once the command is queued, so
+    // that Tss2_Sys_ExecuteAsync callers can work while the command runs.
+    // Receive waits for the response for up to its timeout, and the poll
+    // handle is readable once the response is ready. The simulator must not
+    // be used by other threads meanwhile. Not available with emscripten.
+    kWorker,
+  };
+
+  // Defers or resumes the NV commits of the TPM behind the adapter, e.g.
+  // Simulator::SetNvCommitDeferred. Returns 0 on success.
+  using SetNvCommitDeferred = int (*)(bool deferred);
+
+  // Executes the command_size bytes at command, and writes the response to
+  // response, which holds *response_size bytes. Sets *response_size to the
+  // size of the response. E.g. Simulator::ExecuteRawCommand.
+  using ExecuteCommand = void (*)(const uint8_t *command, size_t command_size,
+                                  uint8_t *response, size_t *response_size);
+
+  explicit TssAdapter(RunCommand runner, Mode mode = kSynchronous);
+
+  // Runs commands with execute on the calling thread. Responses are written
+  // straight to the buffer of the TSS, with no RunCommand call and no
+  // allocation per command. Commands are not logged.
+  explicit TssAdapter(ExecuteCommand execute);
+
   ~TssAdapter();
 
   TSS2_SYS_CONTEXT *GetSysContext();
 
+  // Answers commands that left the TPM state unchanged from a cache, for as
+  // long as state_generation says the state is unchanged. E.g. with
+  // Simulator::GetStateGeneration, repeated TPM2_GetCapability, TPM2_PCR_Read,
+  // TPM2_ReadPublic and TPM2_NV_ReadPublic skip the simulator.
+  void EnableResponseCache(ResponseCache::StateGeneration state_generation);
+
+  // Lets DeferNvCommits reach the TPM through set_deferred. Without it, e.g.
+  // for a TPM the adapter does not own, DeferNvCommits does nothing and NV
+  // is committed after each command as usual.
+  void EnableNvCommitDeferral(SetNvCommitDeferred set_deferred);
+
+  // While deferred, NV writes of commands stay in RAM, and resuming commits
+  // them at once, e.g. so that a write split in several commands costs a
+  // single commit. Call between commands. Returns TSS2_TCTI_RC_BAD_SEQUENCE
+  // if a command is running on the worker, or TPM2_RC_NV_UNAVAILABLE if the
+  // commit fails.
+  TSS2_RC DeferNvCommits(bool deferred);
+
 private:
+  // Executes command with runner_.
+  std::vector<uint8_t> Execute(const std::vector<uint8_t> &command);
+
+  // Returns the cached response to pending_command_, or nullptr.
+  const std::vector<uint8_t> *FindCachedResponse();
+
+  // Executes queued commands until the adapter is destroyed, in kWorker mode.
+  void WorkerLoop();
+
   TSS2_RC SendCommand(size_t command_size, uint8_t const *command_buffer);
 
   static TSS2_RC SendCommandWrapper(TSS2_TCTI_CONTEXT *tcti_context,
@@ -49,17 +126,39 @@ private:
                                         unsigned char *response_buffer,
                                         int32_t timeout);
 
-  // Extends TSS2_TCTI_CONTEXT_COMMON_V1 with an opaque pointer.
-  // This pointer holds the IntelTssAdapter instance.
-  typedef struct {
-    TSS2_TCTI_CONTEXT_COMMON_V1 common;
-    void *opaque;
-  } TSS2_TCTI_CONTEXT_ADAPTER;
+  TSS2_RC GetPollHandles(TSS2_TCTI_POLL_HANDLE *handles, size_t *num_handles);
+
+  static TSS2_RC GetPollHandlesWrapper(TSS2_TCTI_CONTEXT *tcti_context,
+                                       TSS2_TCTI_POLL_HANDLE *handles,
+                                       size_t *num_handles);
 
   RunCommand runner_;
+  // Replaces runner_ if set.
+  ExecuteCommand execute_;
+  const Mode mode_;
   TSS2_TCTI_CONTEXT_ADAPTER tcti_context_;
   TSS2_SYS_CONTEXT *sys_context_;
   std::vector<uint8_t> pending_command_;
+  // Set by EnableResponseCache. Guarded by mutex_ in kWorker mode.
+  std::unique_ptr<ResponseCache> response_cache_;
+  // Set by EnableNvCommitDeferral. Called with mutex_ held, so never while
+  // the worker runs a command.
+  SetNvCommitDeferred set_nv_commit_deferred_;
+
+  // Fields below are only used in kWorker mode.
+  std::thread worker_;
+  // Guards the fields below, except poll_fd_.
+  std::mutex mutex_;
+  std::condition_variable command_cv_;
+  std::condition_variable response_cv_;
+  bool stop_;
+  // True from transmit until the worker has executed pending_command_.
+  bool command_queued_;
+  // True from then until the response is received.
+  bool response_ready_;
+  std::vector<uint8_t> response_;
+  // eventfd that is readable while response_ready_.
+  int poll_fd_;
 };
 
 } // namespace tpm_js
@@ -14,6 +14,10 @@
 
 #include "tss_adapter.h"
 
+#include <cstring>
+#include <future>
+#include <poll.h>
+
 #include <gtest/gtest.h>
 
 namespace tpm_js {
@@ -42,5 +46,100 @@ TEST(TssAdapterTest, ExecutesCommandWithSimulator) {
   EXPECT_EQ(rc, TPM2_RC_SUCCESS);
 }
 
+// Responds to TPM2_Startup(TPM2_SU_CLEAR) with success.
+void ExecuteStartup(const uint8_t* command, size_t command_size,
+                    uint8_t* response, size_t* response_size) {
+  const std::vector<uint8_t> kClear = {0x80, 0x01, 0x00, 0x00, 0x00, 0x0C,
+                                       0x00, 0x00, 0x01, 0x44, 0x00, 0x00};
+  const std::vector<uint8_t> kSuccess = {0x80, 0x01, 0x00, 0x00, 0x00,
+                                         0x0A, 0x00, 0x00, 0x00, 0x00};
+  EXPECT_EQ(kClear, std::vector<uint8_t>(command, command + command_size));
+  ASSERT_LE(kSuccess.size(), *response_size);
+  memcpy(response, kSuccess.data(), kSuccess.size());
+  *response_size = kSuccess.size();
+}
+
+TEST(TssAdapterTest, ExecutesCommandDirectly) {
+  TssAdapter tss(&ExecuteStartup);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(TPM2_RC_SUCCESS,
+              Tss2_Sys_Startup(tss.GetSysContext(), TPM2_SU_CLEAR));
+  }
+}
+
+// Calls made to RecordNvCommitDeferred, and what it returns.
+std::vector<bool> nv_commit_deferred_calls;
+int nv_commit_deferred_result = 0;
+
+int RecordNvCommitDeferred(bool deferred) {
+  nv_commit_deferred_calls.push_back(deferred);
+  return nv_commit_deferred_result;
+}
+
+TEST(TssAdapterTest, DefersNvCommits) {
+  TssAdapter tss(&ExecuteStartup);
+  nv_commit_deferred_calls.clear();
+  nv_commit_deferred_result = 0;
+  // Does nothing until enabled.
+  EXPECT_EQ(TSS2_RC_SUCCESS, tss.DeferNvCommits(true));
+  EXPECT_TRUE(nv_commit_deferred_calls.empty());
+
+  tss.EnableNvCommitDeferral(&RecordNvCommitDeferred);
+  EXPECT_EQ(TSS2_RC_SUCCESS, tss.DeferNvCommits(true));
+  EXPECT_EQ(TPM2_RC_SUCCESS,
+            Tss2_Sys_Startup(tss.GetSysContext(), TPM2_SU_CLEAR));
+  nv_commit_deferred_result = 1;
+  EXPECT_EQ(TPM2_RC_NV_UNAVAILABLE, tss.DeferNvCommits(false));
+  EXPECT_EQ(std::vector<bool>({true, false}), nv_commit_deferred_calls);
+}
+
+#ifndef BUILDING_WASM
+TEST(TssAdapterTest, ExecutesCommandOnWorker) {
+  const std::vector<uint8_t> kSuccess = {0x80, 0x01, 0x00, 0x00, 0x00,
+                                         0x0A, 0x00, 0x00, 0x00, 0x00};
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  TssAdapter::RunCommand cb = [&kSuccess,
+                               released](const std::vector<uint8_t>& cmd) {
+    released.wait();
+    return kSuccess;
+  };
+  TssAdapter tss(cb, TssAdapter::kWorker);
+  TSS2_SYS_CONTEXT* sys_context = tss.GetSysContext();
+  ASSERT_EQ(TSS2_RC_SUCCESS,
+            Tss2_Sys_Startup_Prepare(sys_context, TPM2_SU_CLEAR));
+  // Returns while the command is blocked in cb.
+  ASSERT_EQ(TSS2_RC_SUCCESS, Tss2_Sys_ExecuteAsync(sys_context));
+
+  TSS2_TCTI_CONTEXT* tcti_context = nullptr;
+  ASSERT_EQ(TSS2_RC_SUCCESS,
+            Tss2_Sys_GetTctiContext(sys_context, &tcti_context));
+  TSS2_TCTI_POLL_HANDLE handle;
+  size_t num_handles = 1;
+  ASSERT_EQ(TSS2_RC_SUCCESS,
+            Tss2_Tcti_GetPollHandles(tcti_context, &handle, &num_handles));
+  EXPECT_EQ(1, num_handles);
+  EXPECT_EQ(0, poll(&handle, 1, 0));
+  EXPECT_EQ(TSS2_TCTI_RC_TRY_AGAIN, Tss2_Sys_ExecuteFinish(sys_context, 10));
+  // NV commits cannot be deferred while the command runs.
+  nv_commit_deferred_calls.clear();
+  nv_commit_deferred_result = 0;
+  tss.EnableNvCommitDeferral(&RecordNvCommitDeferred);
+  EXPECT_EQ(TSS2_TCTI_RC_BAD_SEQUENCE, tss.DeferNvCommits(true));
+  EXPECT_TRUE(nv_commit_deferred_calls.empty());
+
+  release.set_value();
+  EXPECT_EQ(1, poll(&handle, 1, -1));
+  EXPECT_EQ(TSS2_RC_SUCCESS,
+            Tss2_Sys_ExecuteFinish(sys_context, TSS2_TCTI_TIMEOUT_BLOCK));
+  EXPECT_EQ(0, poll(&handle, 1, 0));
+
+  // Synchronous calls work as well.
+  EXPECT_EQ(TPM2_RC_SUCCESS, Tss2_Sys_Startup(sys_context, TPM2_SU_CLEAR));
+  EXPECT_EQ(TSS2_RC_SUCCESS, tss.DeferNvCommits(true));
+  EXPECT_EQ(std::vector<bool>({true}), nv_commit_deferred_calls);
+}
+#endif  // BUILDING_WASM
+
 }  // namespace
 }  // namespace tpm_js
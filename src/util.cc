@@ -22,6 +22,9 @@
 #include "openssl/digest.h"
 #include "openssl/hmac.h"
 
+#include "host_public_key.h"
+#include "thread_pool.h"
+
 namespace tpm_js {
 namespace {
 
@@ -99,4 +102,26 @@ std::vector<uint8_t> Util::KDFa(int hash_algo, const std::vector<uint8_t> &key,
   return output;
 }
 
+std::vector<int>
+Util::VerifySignatures(const std::vector<PublicKey> &keys,
+                       const std::vector<SignatureToVerify> &signatures) {
+  std::vector<HostPublicKey> host_keys(keys.size());
+  ThreadPool::Get()->ParallelFor(keys.size(), [&](size_t i) {
+    host_keys[i] = NewHostPublicKey(keys[i]);
+  });
+
+  std::vector<int> result(signatures.size());
+  ThreadPool::Get()->ParallelFor(signatures.size(), [&](size_t i) {
+    const SignatureToVerify &signature = signatures[i];
+    if (signature.key_index < 0 ||
+        static_cast<size_t>(signature.key_index) >= host_keys.size()) {
+      result[i] = TPM2_RC_KEY;
+      return;
+    }
+    result[i] =
+        VerifyHostSignature(host_keys[signature.key_index], signature);
+  });
+  return result;
+}
+
 } // namespace tpm_js
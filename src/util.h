@@ -32,6 +32,33 @@ struct AttestInfo {
   std::vector<uint8_t> selected_pcr_digest;
 };
 
+// Public part of a TPM2_ALG_RSA or TPM2_ALG_ECC key, as found in
+// CreatePrimaryResult and CreateResult.
+struct PublicKey {
+  int type;
+  // RSA public key material (n). The exponent is the TPM default, 65537.
+  // Valid only if type == TPM2_ALG_RSA.
+  std::vector<uint8_t> rsa_public_n;
+  // ECC public key material (affine coordinates). Valid only if type ==
+  // TPM2_ALG_ECC.
+  std::vector<uint8_t> ecc_public_x;
+  std::vector<uint8_t> ecc_public_y;
+  int ecc_curve_id;
+};
+
+// Signature of a SHA256 digest, as found in SignResult.
+struct SignatureToVerify {
+  // Index of the signing key in the keys passed to Util::VerifySignatures.
+  int key_index;
+  std::vector<uint8_t> digest;
+  int sign_algo;
+  // RSA signature. Valid only if sign_algo == TPM2_ALG_RSASSA.
+  std::vector<uint8_t> rsa_ssa_sig;
+  // ECDSA signature. Valid only if sign_algo == TPM2_ALG_ECDSA.
+  std::vector<uint8_t> ecdsa_r;
+  std::vector<uint8_t> ecdsa_s;
+};
+
 // Utility functions.
 class Util {
 public:
@@ -48,6 +75,15 @@ public:
        const std::vector<uint8_t> &context_u,
        const std::vector<uint8_t> &context_v, int bits);
 
+  // Verifies signatures on the host, spread over ThreadPool::Get(), without
+  // any TPM round trip. Returns for each signature TPM2_RC_SUCCESS,
+  // TPM2_RC_SIGNATURE if it does not match, TPM2_RC_KEY if its key is invalid,
+  // TPM2_RC_SCHEME if sign_algo does not fit the key or TPM2_RC_SIZE if the
+  // digest is not a SHA256 digest.
+  static std::vector<int>
+  VerifySignatures(const std::vector<PublicKey> &keys,
+                   const std::vector<SignatureToVerify> &signatures);
+
 private:
   // static only
   ~Util();
@@ -113,3 +113,28 @@ ClearBit(
     bArray[bitNum >> 3] &= ~(1 << (bitNum & 7));
 }
 #endif // INLINE_FUNCTIONS
+/* 9.2.3.4 FindClearBit() */
+/* This function returns the number of the lowest clear bit in bArray, skipping a whole octet at a
+   time while the octets are all ones. It is used to allocate from an occupancy map without
+   scanning the slots that the map describes. */
+/* Return Values Meaning */
+/* < bitCount number of the lowest clear bit */
+/* bitCount all bits are set */
+unsigned int
+FindClearBit(
+	     BYTE            *bArray,        // IN: array containing the bits
+	     unsigned int     bitCount       // IN: number of bits in 'bArray'
+	     )
+{
+    unsigned int     i;
+    unsigned int     bitNum;
+    for(i = 0; (i << 3) < bitCount; i++)
+	{
+	    if(bArray[i] != 0xFF)
+		{
+		    for(bitNum = i << 3; (bArray[i] & (1 << (bitNum & 7))) != 0; bitNum++);
+		    return (bitNum < bitCount) ? bitNum : bitCount;
+		}
+	}
+    return bitCount;
+}
@@ -129,5 +129,13 @@ ClearBit(
     bArray[bitNum >> 3] &= ~(1 << (bitNum & 7));
 }
 #endif // INLINE_FUNCTIONS
+/* 5.3.4 FindClearBit() */
+/* This function returns the number of the lowest clear bit in bArray or bitCount if all bits are
+   set. */
+unsigned int
+FindClearBit(
+	     BYTE            *bArray,        // IN: array containing the bits
+	     unsigned int     bitCount       // IN: number of bits in 'bArray'
+	     );
 
 #endif
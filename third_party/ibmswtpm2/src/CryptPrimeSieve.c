@@ -113,7 +113,11 @@ RsaNextPrime(
     lastPrime >>= 1;
     for(lastPrime += 1; lastPrime <= primeLimit; lastPrime++)
 	{
-	    if(((s_PrimeTable[lastPrime >> 3] >> (lastPrime & 0x7)) & 1) == 1)
+	    BYTE        bits = s_PrimeTable[lastPrime >> 3] >> (lastPrime & 0x7);
+	    // If no bits are left in this byte, skip to the start of the next one
+	    if(bits == 0)
+		lastPrime |= 0x7;
+	    else if((bits & 1) == 1)
 		return ((lastPrime << 1) + 1);
 	}
     return 0;
@@ -180,15 +184,40 @@ const BYTE bitsInNibble[16] = {
     (bitsInNibble[(unsigned char)(x) & 0xf]				\
      +   bitsInNibble[((unsigned char)(x) >> 4) & 0xf])
 #endif
+/* BitsInWord() */
+/* This function counts the number of bits set in a crypt_uword_t. When the compiler provides a
+   population count builtin, that is used (it becomes a single instruction on most targets).
+   Otherwise, the word is counted a byte at a time. */
+static int
+BitsInWord(
+	   crypt_uword_t    w              // IN: the word to count
+	   )
+{
+#if defined __GNUC__ || defined __clang__
+    return __builtin_popcountll((unsigned long long)w);
+#else
+    int     j = 0;
+    for(; w != 0; w >>= 8)
+	j += BitsInByte(w);
+    return j;
+#endif
+}
 /* 10.2.17.1.3 BitsInArry() */
-/* This function counts the number of bits set in an array of bytes. */
+/* This function counts the number of bits set in an array of bytes. The array is processed a
+   crypt_uword_t at a time with any remaining bytes counted individually. */
 static int
 BitsInArray(
 	    const unsigned char     *a,             // IN: A pointer to an array of bytes
 	    unsigned int             aSize          // IN: the number of bytes to sum
 	    )
 {
-    int     j = 0;
+    int              j = 0;
+    crypt_uword_t    w;
+    for(; aSize >= sizeof(w); a += sizeof(w), aSize -= sizeof(w))
+	{
+	    memcpy(&w, a, sizeof(w));
+	    j += BitsInWord(w);
+	}
     for(; aSize; a++, aSize--)
 	j += BitsInByte(*a);
     return j;
@@ -197,6 +226,9 @@ BitsInArray(
 /* This function finds the nth SET bit in a bit array. The n parameter is between 1 and the number
    of bits in the array (always a multiple of 8). If called when the array does not have n bits set,
    it will return -1 */
+/* Whole crypt_uword_t values are skipped while their bits do not reach n. Since a population count
+   does not depend on byte order, the selected bit is the same one that a byte-by-byte search
+   would find. The final byte is then searched one bit at a time. */
 /* Return Values Meaning */
 /* <0 no bit is set or no bit with the requested number is set */
 /* >=0 the number of the bit in the array that is the nth set */
@@ -207,24 +239,66 @@ FindNthSetBit(
 	      const UINT32     n              // IN, the number of the SET bit
 	      )
 {
-    UINT16       i;
-    int          retValue;
-    UINT32       sum = 0;
-    BYTE         sel;
-    //find the bit
-    for(i = 0; (i < (int)aSize) && (sum < n); i++)
-	sum += BitsInByte(a[i]);
-    i--;
-    // The chosen bit is in the byte that was just accessed
-    // Compute the offset to the start of that byte
-    retValue = i * 8 - 1;
-    sel = a[i];
-    // Subtract the bits in the last byte added.
-    sum -= BitsInByte(sel);
-    // Now process the byte, one bit at a time.
-    for(; (sel != 0) && (sum != n); retValue++, sel = sel >> 1)
-	sum += (sel & 1) != 0;
-    return (sum == n) ? retValue : -1;
+    UINT32           i = 0;
+    int              retValue;
+    UINT32           sum = 0;
+    UINT32           bits;
+    BYTE             sel;
+    crypt_uword_t    w;
+    if(n == 0)
+	return -1;
+    // Skip the words that do not contain the chosen bit
+    for(; (i + sizeof(w)) <= aSize; i += sizeof(w))
+	{
+	    memcpy(&w, &a[i], sizeof(w));
+	    bits = BitsInWord(w);
+	    if((sum + bits) >= n)
+		break;
+	    sum += bits;
+	}
+    // Find the byte that contains the chosen bit
+    for(; i < aSize; i++)
+	{
+	    bits = BitsInByte(a[i]);
+	    if((sum + bits) >= n)
+		break;
+	    sum += bits;
+	}
+    if(i >= aSize)
+	return -1;
+    // Now process the byte, one bit at a time. The byte is known to hold the bit.
+    retValue = i * 8;
+    for(sel = a[i]; ; retValue++, sel = sel >> 1)
+	{
+	    sum += (sel & 1);
+	    if((sel & 1) && (sum == n))
+		break;
+	}
+    return retValue;
+}
+/* SieveModWord() */
+/* This function returns the remainder of bnN divided by a 32-bit modulus. The sieve uses it in
+   place of BnModWord() because the divisors in the sieve always fit in 32 bits. That allows the
+   remainder to be computed 32 bits at a time with native arithmetic rather than with a full
+   division in the math library. */
+static UINT32
+SieveModWord(
+	     bigConst         bnN,           // IN: the number to divide
+	     UINT32           modulus        // IN: the divisor
+	     )
+{
+    UINT64           r = 0;
+    crypt_uword_t    d;
+    int              i;
+    int              j;
+    pAssert(modulus != 0);
+    for(i = (int)bnN->size - 1; i >= 0; i--)
+	{
+	    d = bnN->d[i];
+	    for(j = RADIX_BITS - 32; j >= 0; j -= 32)
+		r = ((r << 32) | (UINT32)(d >> j)) % modulus;
+	}
+    return (UINT32)r;
 }
 typedef struct
 {
@@ -267,7 +341,7 @@ PrimeSieve(
     // If the remainder is odd, then subtracting the value will give an even number,
     // but we want an odd number, so subtract the 105+rem. Otherwise, just subtract
     // the even remainder.
-    adjust = BnModWord(bnN, 105);
+    adjust = SieveModWord(bnN, 105);
     if(adjust & 1)
 	adjust += 105;
     // Adjust the input number so that it points to the first number in a
@@ -301,7 +375,7 @@ PrimeSieve(
 		}
 	    // Get the remainder when dividing the base field address
 	    // by the composite
-	    composite = BnModWord(bnN, composite);
+	    composite = SieveModWord(bnN, composite);
 	    // 'composite' is divisible by the composite components. for each of the
 	    // composite components, divide 'composite'. That remainder (r) is used to
 	    // pick a starting point for clearing the array. The stride is equal to the
@@ -329,8 +403,10 @@ PrimeSieve(
 		    if(r & 1)           j = (next - r) / 2;
 		    else if(r == 0)     j = 0;
 		    else                 j = next - r / 2;
+		    // j is always within the field so the bounds check in ClearBit() is
+		    // not needed here.
 		    for(; j < fieldBits; j += next)
-			ClearBit(j, field, fieldSize);
+			field[j >> 3] &= ~(1 << (j & 7));
 		}
 	    if(next >= stop)
 		{
@@ -426,7 +502,7 @@ PrimeSelectWithSieve(
 	    // The exponent might not have been one of the tested primes so
 	    // make sure that it isn't divisible and make sure that 0 != (p-1) mod e
 	    // Note: This is the same as 1 != p mod e
-	    modE = BnModWord(test, e);
+	    modE = SieveModWord(test, e);
 	    if((modE != 0) && (modE != 1) && MillerRabin(test, rand))
 		{
 		    BnCopy(candidate, test);
@@ -525,16 +525,28 @@ CryptRandomStir(
     return TPM_RC_SUCCESS;
 }
 /* 10.2.18.4.3 CryptRandomGenerate() */
-/* Generate a randomSize number or random bytes. */
-LIB_EXPORT UINT16
+/* Generate a randomSize number or random bytes. Requests larger than a single DRBG request are
+   filled by back-to-back generate calls on the default DRBG, so the caller is not limited to the
+   size of a TPM2B. */
+/* Return Values Meaning */
+/* > 0 number of bytes generated (always randomSize) */
+/* 0 the DRBG could not be reseeded */
+LIB_EXPORT INT32
 CryptRandomGenerate(
 		    INT32            randomSize,
 		    BYTE            *buffer
 		    )
 {
-    if(randomSize > UINT16_MAX)
-	randomSize = UINT16_MAX;
-    return DRBG_Generate((RAND_STATE *)&drbgDefault, buffer, (UINT16)randomSize);
+    INT32            generated = 0;
+    while(generated < randomSize)
+	{
+	    INT32        chunk = MIN(randomSize - generated, UINT16_MAX);
+	    if(DRBG_Generate((RAND_STATE *)&drbgDefault, &buffer[generated],
+			     (UINT16)chunk) == 0)
+		return 0;
+	    generated += chunk;
+	}
+    return generated;
 }
 /* 10.2.18.4.4 DRBG_InstantiateSeededKdf() */
 /* Function used to instantiate a KDF-based RNG. This is used for derivations */
@@ -101,7 +101,7 @@ CryptRandomStir(
 		UINT32            additionalDataSize,
 		BYTE            *additionalData
 		);
-LIB_EXPORT UINT16
+LIB_EXPORT INT32
 CryptRandomGenerate(
 		    INT32            randomSize,
 		    BYTE            *buffer
@@ -67,6 +67,9 @@
 /* 10.2.19.2 Includes, Defines, and Typedefs */
 #include "Tpm.h"
 #include "CryptSym.h"
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
 /* 10.2.19.3.1	CryptSymInit() */
 /* This function is called to do _TPM_Init() processing */
 BOOL
@@ -155,6 +158,79 @@ CryptGetSymmetricBlockSize(
 	}
     return 0;
 }
+/* 10.2.20.4.2 Block XOR Functions */
+/* TPM-JS: XORs of the CTR, OFB and CFB modes, one call per block. With WebAssembly SIMD
+   (-msimd128), a 16-byte block, e.g. AES, is a single v128 operation. Other block sizes, the
+   last partial block and other builds use the byte loops of the modes. */
+/* 10.2.20.4.2.1 SymXorBlock() */
+/* Sets dOut to dIn XOR mask, for size bytes. dOut may be dIn. */
+static void
+SymXorBlock(
+	    BYTE            *dOut,          // OUT: dIn XOR mask
+	    const BYTE      *dIn,           // IN: data
+	    const BYTE      *mask,          // IN: encrypted counter or IV
+	    INT32            size           // IN: bytes to XOR
+	    )
+{
+#ifdef __wasm_simd128__
+    if(size == 16)
+	{
+	    wasm_v128_store(dOut, wasm_v128_xor(wasm_v128_load(dIn),
+						wasm_v128_load(mask)));
+	    return;
+	}
+#endif
+    for(; size > 0; size--)
+	*dOut++ = *dIn++ ^ *mask++;
+}
+/* 10.2.20.4.2.2 SymCfbEncryptBlock() */
+/* XORs size bytes of dIn into iv to create the cipher text, and copies it to dOut. dOut may be
+   dIn. */
+static void
+SymCfbEncryptBlock(
+		   BYTE            *dOut,          // OUT: cipher text
+		   BYTE            *iv,            // IN/OUT: encrypted IV, then cipher text
+		   const BYTE      *dIn,           // IN: plain text
+		   INT32            size           // IN: bytes to encrypt
+		   )
+{
+#ifdef __wasm_simd128__
+    if(size == 16)
+	{
+	    v128_t      cipher = wasm_v128_xor(wasm_v128_load(iv),
+					       wasm_v128_load(dIn));
+	    wasm_v128_store(iv, cipher);
+	    wasm_v128_store(dOut, cipher);
+	    return;
+	}
+#endif
+    for(; size > 0; size--)
+	*dOut++ = *iv++ ^= *dIn++;
+}
+/* 10.2.20.4.2.3 SymCfbDecryptBlock() */
+/* Copies size bytes of cipher text from dIn to iv, and XORs them with mask into dOut. dOut may
+   be dIn. */
+static void
+SymCfbDecryptBlock(
+		   BYTE            *dOut,          // OUT: plain text
+		   BYTE            *iv,            // OUT: cipher text
+		   const BYTE      *mask,          // IN: encrypted IV
+		   const BYTE      *dIn,           // IN: cipher text
+		   INT32            size           // IN: bytes to decrypt
+		   )
+{
+#ifdef __wasm_simd128__
+    if(size == 16)
+	{
+	    v128_t      cipher = wasm_v128_load(dIn);
+	    wasm_v128_store(dOut, wasm_v128_xor(wasm_v128_load(mask), cipher));
+	    wasm_v128_store(iv, cipher);
+	    return;
+	}
+#endif
+    for(; size > 0; size--)
+	*dOut++ = *mask++ ^ (*iv++ = *dIn++);
+}
 /* 10.2.20.5 Symmetric Encryption */
 /* This function performs symmetric encryption based on the mode. */
 /* Error Returns Meaning */
@@ -178,7 +254,6 @@ CryptSymmetricEncrypt(
     BYTE                *pIv;
     int                  i;
     BYTE                 tmp[MAX_SYM_BLOCK_SIZE];
-    BYTE                *pT;
     tpmCryptKeySchedule_t        keySchedule;
     INT16                blockSize;
     TpmCryptSetSymKeyCall_t        encrypt;
@@ -218,9 +293,10 @@ CryptSymmetricEncrypt(
 			if((iv[i] += 1) != 0)
 			    break;
 		    // XOR the encrypted counter value with input and put into output
-		    pT = tmp;
-		    for(i = (dSize < blockSize) ? dSize : blockSize; i > 0; i--)
-			*dOut++ = *dIn++ ^ *pT++;
+		    i = (dSize < blockSize) ? dSize : blockSize;
+		    SymXorBlock(dOut, dIn, tmp, i);
+		    dOut += i;
+		    dIn += i;
 		}
 	    break;
 #endif
@@ -232,9 +308,10 @@ CryptSymmetricEncrypt(
 		    // Encrypt the current value of the "IV"
 		    ENCRYPT(&keySchedule, iv, iv);
 		    // XOR the encrypted IV into dIn to create the cipher text (dOut)
-		    pIv = iv;
-		    for(i = (dSize < blockSize) ? dSize : blockSize; i > 0; i--)
-			*dOut++ = (*pIv++ ^ *dIn++);
+		    i = (dSize < blockSize) ? dSize : blockSize;
+		    SymXorBlock(dOut, dIn, iv, i);
+		    dOut += i;
+		    dIn += i;
 		}
 	    break;
 #endif
@@ -265,11 +342,13 @@ CryptSymmetricEncrypt(
 		{
 		    // Encrypt the current value of the IV
 		    ENCRYPT(&keySchedule, iv, iv);
-		    pIv = iv;
-		    for(i = (int)(dSize < blockSize) ? dSize : blockSize; i > 0; i--)
-			// XOR the data into the IV to create the cipher text
-			// and put into the output
-			*dOut++ = *pIv++ ^= *dIn++;
+		    // XOR the data into the IV to create the cipher text
+		    // and put into the output
+		    i = (int)(dSize < blockSize) ? dSize : blockSize;
+		    SymCfbEncryptBlock(dOut, iv, dIn, i);
+		    dOut += i;
+		    dIn += i;
+		    pIv = iv + i;
 		}
 	    // If the inner loop (i loop) was smaller than blockSize, then dSize
 	    // would have been smaller than blockSize and it is now negative. If
@@ -400,12 +479,13 @@ CryptSymmetricDecrypt(
 		{
 		    // Encrypt the IV into the temp buffer
 		    ENCRYPT(&keySchedule, iv, tmp);
-		    pT = tmp;
-		    pIv = iv;
-		    for(i = (dSize < blockSize) ? dSize : blockSize; i > 0; i--)
-			// Copy the current cipher text to IV, XOR
-			// with the temp buffer and put into the output
-			*dOut++ = *pT++ ^ (*pIv++ = *dIn++);
+		    // Copy the current cipher text to IV, XOR
+		    // with the temp buffer and put into the output
+		    i = (dSize < blockSize) ? dSize : blockSize;
+		    SymCfbDecryptBlock(dOut, iv, tmp, dIn, i);
+		    dOut += i;
+		    dIn += i;
+		    pIv = iv + i;
 		}
 	    // If the inner loop (i loop) was smaller than blockSize, then dSize
 	    // would have been smaller than blockSize and it is now negative
@@ -425,9 +505,10 @@ CryptSymmetricDecrypt(
 			if((iv[i] += 1) != 0)
 			    break;
 		    // XOR the encrypted counter value with input and put into output
-		    pT = tmp;
-		    for(i = (dSize < blockSize) ? dSize : blockSize; i > 0; i--)
-			*dOut++ = *dIn++ ^ *pT++;
+		    i = (dSize < blockSize) ? dSize : blockSize;
+		    SymXorBlock(dOut, dIn, tmp, i);
+		    dOut += i;
+		    dIn += i;
 		}
 	    break;
 #endif
@@ -449,9 +530,10 @@ CryptSymmetricDecrypt(
 		    // Encrypt the current value of the "IV"
 		    ENCRYPT(&keySchedule, iv, iv);
 		    // XOR the encrypted IV into dIn to create the cipher text (dOut)
-		    pIv = iv;
-		    for(i = (dSize < blockSize) ? dSize : blockSize; i > 0; i--)
-			*dOut++ = (*pIv++ ^ *dIn++);
+		    i = (dSize < blockSize) ? dSize : blockSize;
+		    SymXorBlock(dOut, dIn, iv, i);
+		    dOut += i;
+		    dIn += i;
 		}
 	    break;
 #endif
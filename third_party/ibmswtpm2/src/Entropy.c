@@ -83,6 +83,10 @@ extern int             firstValue;
 /* This function is used to get available hardware entropy. In a hardware implementation of this
    function, there would be no call to the system to get entropy. If the caller does not ask for any
    entropy, then this is a startup indication and firstValue should be reset. */
+/* System entropy is read ENTROPY_POOL_SIZE bytes at a time into s_entropyPool, so a DRBG reseed
+   costs one call to the system generator rather than one per 32 bits. The pool is handed out in
+   32-bit blocks and each block is still compared with the one before it. A startup indication
+   also discards whatever is left in the pool. */
 /* Return Values Meaning */
 /* < 0 hardware failure of the entropy generator, this is sticky */
 /* >= 0 the returned amount of entropy (bytes) */
@@ -93,27 +97,35 @@ _plat__GetEntropy(
 		  )
 {
     uint32_t            rndNum;
-    int                 OK = 1;
+    uint32_t            returned = 0;
+    uint32_t            copy;
     if(amount == 0)
 	{
 	    firstValue = 1;
+	    s_entropyPoolUsed = ENTROPY_POOL_SIZE;
 	    return 0;
 	}
-    // Only provide entropy 32 bits at a time to test the ability
-    // of the caller to deal with partial results.
-    /* rndNum = rand(); kgold rand() is not random */
-    RAND_bytes((unsigned char *)&rndNum, sizeof(uint32_t));	/* kgold */
-    
-    if(firstValue)
-	firstValue = 0;
-    else
-	OK = (rndNum != lastEntropy);
-    if(OK)
+    while(returned < amount)
 	{
+	    if(s_entropyPoolUsed >= ENTROPY_POOL_SIZE)
+		{
+		    /* rndNum = rand(); kgold rand() is not random */
+		    if(RAND_bytes(s_entropyPool, sizeof(s_entropyPool)) != 1)
+			return -1;
+		    s_entropyPoolUsed = 0;
+		}
+	    memcpy(&rndNum, &s_entropyPool[s_entropyPoolUsed], sizeof(rndNum));
+	    s_entropyPoolUsed += sizeof(rndNum);
+	    if(firstValue)
+		firstValue = 0;
+	    else if(rndNum == lastEntropy)
+		return -1;
 	    lastEntropy = rndNum;
-	    if(amount > sizeof(rndNum))
-		amount = sizeof(rndNum);
-	    memcpy(entropy, &rndNum, amount);
+	    copy = amount - returned;
+	    if(copy > sizeof(rndNum))
+		copy = sizeof(rndNum);
+	    memcpy(&entropy[returned], &rndNum, copy);
+	    returned += copy;
 	}
-    return (OK) ? (int32_t)amount : -1;
+    return (int32_t)returned;
 }
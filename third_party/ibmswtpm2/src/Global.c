@@ -142,12 +142,18 @@ BYTE                *s_cachedNvRamRef;
 #endif // __IGNORE_STATE__
 /* 9.5.4.4 Object.c */
 OBJECT              s_objects[MAX_LOADED_OBJECTS];
+BYTE                s_objectMap[(MAX_LOADED_OBJECTS + 7) / 8];
+/* Hierarchy.c */
+PRIMARY_CACHE_ENTRY  s_primaryCache[PRIMARY_CACHE_SIZE];
+UINT32               s_primaryCacheUseCount;
 /* 9.5.4.5 PCR.c */
 PCR                  s_pcrs[IMPLEMENTATION_PCR];
 /* 9.5.4.6 Session.c */
 SESSION_SLOT         s_sessions[MAX_LOADED_SESSIONS];
 UINT32               s_oldestSavedSession;
 int                  s_freeSessionSlots;
+BYTE                 s_sessionMap[(MAX_LOADED_SESSIONS + 7) / 8];
+BYTE                 s_contextMap[(MAX_ACTIVE_SESSIONS + 7) / 8];
 /* 9.5.4.7 MemoryLib.c */
 /* The s_actionOutputBuffer should not be modifiable by the host system until the TPM has returned a
    response code. The s_actionOutputBuffer should not be accessible until response parameter
@@ -1015,7 +1015,30 @@ extern      BYTE            *s_cachedNvRamRef;
 /* From Object.c */
 /* This type is the container for an object. */
 extern OBJECT           s_objects[MAX_LOADED_OBJECTS];
+/* Occupancy map of s_objects. Bit n is SET when s_objects[n] is occupied. It is kept in step with
+   the occupied attribute by ObjectSetInUse() and ObjectFlush() so that a free slot can be found
+   without looking at every object. */
+extern BYTE             s_objectMap[(MAX_LOADED_OBJECTS + 7) / 8];
 #endif // OBJECT_C
+#if defined HIERARCHY_C || defined GLOBAL_C
+/* From Hierarchy.c */
+/* A primary object is completely determined by the primary seed of its hierarchy, its template and
+   its sensitive data. The primary key cache keeps the objects created by TPM2_CreatePrimary() so
+   that creating the same object again does not repeat the key generation. An entry is in use when
+   its key is not empty. The cache is not part of the TPM state and is kept over TPM2_Startup(). */
+#ifndef PRIMARY_CACHE_SIZE
+#define PRIMARY_CACHE_SIZE      8
+#endif
+typedef struct
+{
+    TPM2B_DIGEST        key;            // digest of the seed and the creation inputs
+    TPMI_RH_HIERARCHY   hierarchy;      // hierarchy of the primary seed
+    UINT32              lastUsed;       // s_primaryCacheUseCount at the last use
+    OBJECT              object;         // the created object without its authValue
+} PRIMARY_CACHE_ENTRY;
+extern PRIMARY_CACHE_ENTRY  s_primaryCache[PRIMARY_CACHE_SIZE];
+extern UINT32               s_primaryCacheUseCount;
+#endif // HIERARCHY_C
 #if defined PCR_C || defined GLOBAL_C
 /* From PCR.c */
 typedef struct
@@ -1068,6 +1091,11 @@ extern UINT32            s_oldestSavedSession;
    loaded if the GAP is maxed out. The exception is that the oldest saved session context can always
    be loaded (assuming that there is a space in memory to put it) */
 extern int               s_freeSessionSlots;
+/* Occupancy map of s_sessions. Bit n is SET when s_sessions[n] is occupied. */
+extern BYTE              s_sessionMap[(MAX_LOADED_SESSIONS + 7) / 8];
+/* Occupancy map of gr.contextArray. Bit n is SET when gr.contextArray[n] is not zero. It is not
+   part of the NV state and is rebuilt from gr.contextArray by SessionStartup(). */
+extern BYTE              s_contextMap[(MAX_ACTIVE_SESSIONS + 7) / 8];
 #endif // SESSION_C
 #if defined IO_BUFFER_C || defined GLOBAL_C
 /* The s_actionOutputBuffer should not be modifiable by the host system until the TPM has returned a
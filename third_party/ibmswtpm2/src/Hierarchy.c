@@ -62,6 +62,7 @@
 /* 8.3.1 Introduction */
 /* This file contains the functions used for managing and accessing the hierarchy-related values. */
 /* 8.3.2 Includes */
+#define HIERARCHY_C
 #include "Tpm.h"
 /* 8.3.3 Functions */
 /* 8.3.3.1 HierarchyPreInstall() */
@@ -121,6 +122,8 @@ HierarchyPreInstall_Init(
     NV_SYNC_PERSISTENT(phProof);
     NV_SYNC_PERSISTENT(shProof);
     NV_SYNC_PERSISTENT(ehProof);
+    // Objects created from the previous seeds can not be created again
+    PrimaryCacheFlush(TPM_RH_UNASSIGNED);
     return;
 }
 /* 8.3.3.2 HierarchyStartup() */
@@ -148,6 +151,7 @@ HierarchyStartup(
 	    CryptRandomGenerate(gr.nullProof.t.size, gr.nullProof.t.buffer);
 	    gr.nullSeed.t.size = sizeof(gr.nullSeed.t.buffer);
 	    CryptRandomGenerate(gr.nullSeed.t.size, gr.nullSeed.t.buffer);
+	    PrimaryCacheFlush(TPM_RH_NULL);
 	}
     return;
 }
@@ -243,3 +247,149 @@ HierarchyIsEnabled(
 	}
     return enabled;
 }
+/* 8.3.3.6 PrimaryCacheComputeKey() */
+/* This function computes the primary key cache key for a primary object. The key covers everything
+   that the object creation depends on: the primary seed, the Name computed over the template and
+   the sensitive data. For the endorsement hierarchy, it also covers the proof values that are mixed
+   into the seedValue of the object. */
+void
+PrimaryCacheComputeKey(
+		       TPMI_RH_HIERARCHY    hierarchy,     // IN: hierarchy of the primary seed
+		       TPM2B_NAME          *name,          // IN: Name computed over the template
+		       TPM2B               *data,          // IN: sensitive data
+		       TPM2B_DIGEST        *key            // OUT: cache key
+		       )
+{
+    HASH_STATE           hashState;
+    key->t.size = CryptHashStart(&hashState, TPM_ALG_SHA256);
+    CryptDigestUpdateInt(&hashState, sizeof(TPM_HANDLE), hierarchy);
+    CryptDigestUpdate2B(&hashState, &HierarchyGetPrimarySeed(hierarchy)->b);
+    CryptDigestUpdate2B(&hashState, &name->b);
+    CryptDigestUpdate2B(&hashState, data);
+    if(hierarchy == TPM_RH_ENDORSEMENT)
+	{
+	    CryptDigestUpdate2B(&hashState, &gp.shProof.b);
+	    CryptDigestUpdate2B(&hashState, &gp.ehProof.b);
+	}
+    CryptHashEnd2B(&hashState, &key->b);
+}
+/* 8.3.3.7 PrimaryCacheLookup() */
+/* This function looks for a primary object in the primary key cache. If it is found, the public
+   area, sensitive area, RSA private exponent and Name of object are set from the cache and the
+   authValue is set to userAuth. */
+/* Return Values Meaning */
+/* TRUE object was set from the cache */
+/* FALSE object is not in the cache */
+BOOL
+PrimaryCacheLookup(
+		   TPM2B_DIGEST        *key,           // IN: cache key
+		   TPM2B_AUTH          *userAuth,      // IN: authValue of the object
+		   OBJECT              *object         // OUT: object to set
+		   )
+{
+    UINT32               i;
+    for(i = 0; i < PRIMARY_CACHE_SIZE; i++)
+	{
+	    PRIMARY_CACHE_ENTRY     *entry = &s_primaryCache[i];
+	    if(entry->key.t.size != 0 && MemoryEqual2B(&entry->key.b, &key->b))
+		{
+		    object->publicArea = entry->object.publicArea;
+		    object->sensitive = entry->object.sensitive;
+#ifdef  TPM_ALG_RSA
+		    // The exponent is only used while privateExp is SET, otherwise it is
+		    // computed again from the primes
+		    object->privateExponent = entry->object.privateExponent;
+		    object->attributes.privateExp = entry->object.attributes.privateExp;
+#endif
+		    object->name = entry->object.name;
+		    object->sensitive.authValue = *userAuth;
+		    entry->lastUsed = ++s_primaryCacheUseCount;
+		    return TRUE;
+		}
+	}
+    return FALSE;
+}
+/* 8.3.3.8 PrimaryCacheStore() */
+/* This function adds a newly created primary object to the primary key cache, replacing the least
+   recently used entry if the cache is full. The authValue of the object is not kept. */
+void
+PrimaryCacheStore(
+		  TPMI_RH_HIERARCHY    hierarchy,     // IN: hierarchy of the primary seed
+		  TPM2B_DIGEST        *key,           // IN: cache key
+		  OBJECT              *object         // IN: created object
+		  )
+{
+    PRIMARY_CACHE_ENTRY     *entry = &s_primaryCache[0];
+    UINT32                   i;
+    for(i = 0; i < PRIMARY_CACHE_SIZE; i++)
+	{
+	    if(s_primaryCache[i].key.t.size == 0)
+		{
+		    entry = &s_primaryCache[i];
+		    break;
+		}
+	    if(s_primaryCache[i].lastUsed < entry->lastUsed)
+		entry = &s_primaryCache[i];
+	}
+    entry->key = *key;
+    entry->hierarchy = hierarchy;
+    entry->lastUsed = ++s_primaryCacheUseCount;
+    entry->object = *object;
+    MemorySet(&entry->object.sensitive.authValue, 0,
+	      sizeof(entry->object.sensitive.authValue));
+}
+/* 8.3.3.9 PrimaryCacheFlush() */
+/* This function removes the objects of a hierarchy from the primary key cache. It is called when
+   the primary seed or the proof values of the hierarchy change. TPM_RH_UNASSIGNED removes all
+   objects. */
+void
+PrimaryCacheFlush(
+		  TPMI_RH_HIERARCHY    hierarchy      // IN: hierarchy or TPM_RH_UNASSIGNED
+		  )
+{
+    UINT32               i;
+    for(i = 0; i < PRIMARY_CACHE_SIZE; i++)
+	{
+	    if(hierarchy == TPM_RH_UNASSIGNED
+	       || s_primaryCache[i].hierarchy == hierarchy)
+		MemorySet(&s_primaryCache[i], 0, sizeof(s_primaryCache[i]));
+	}
+}
+/* 8.3.3.10 PrimaryCacheSave() */
+/* This function copies the primary key cache to buffer so that it can be kept outside of the
+   TPM. It returns the size of the saved cache. Nothing is copied if size is smaller than that, so a
+   call with a NULL buffer returns the size to allocate. */
+UINT32
+PrimaryCacheSave(
+		 BYTE                *buffer,        // OUT: saved cache
+		 UINT32               size           // IN: size of buffer
+		 )
+{
+    if(buffer != NULL && size >= sizeof(s_primaryCache))
+	MemoryCopy(buffer, s_primaryCache, sizeof(s_primaryCache));
+    return sizeof(s_primaryCache);
+}
+/* 8.3.3.11 PrimaryCacheRestore() */
+/* This function replaces the primary key cache with one saved by PrimaryCacheSave(). The saved
+   entries are only found again if the primary seeds have not changed since they were saved. */
+/* Return Values Meaning */
+/* TRUE cache restored */
+/* FALSE size does not match this build of the TPM */
+BOOL
+PrimaryCacheRestore(
+		    BYTE                *buffer,        // IN: saved cache
+		    UINT32               size           // IN: size of buffer
+		    )
+{
+    UINT32               i;
+    if(size != sizeof(s_primaryCache))
+	return FALSE;
+    MemoryCopy(s_primaryCache, buffer, sizeof(s_primaryCache));
+    s_primaryCacheUseCount = 0;
+    for(i = 0; i < PRIMARY_CACHE_SIZE; i++)
+	{
+	    if(s_primaryCache[i].lastUsed > s_primaryCacheUseCount)
+		s_primaryCacheUseCount = s_primaryCache[i].lastUsed;
+	}
+    return TRUE;
+}
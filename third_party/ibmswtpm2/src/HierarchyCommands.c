@@ -73,6 +73,7 @@ TPM2_CreatePrimary(
     DRBG_STATE           rand;
     OBJECT              *newObject;
     TPM2B_NAME           name;
+    TPM2B_DIGEST         cacheKey;
     // Input Validation
     // Will need a place to put the result
     newObject = FindEmptyObjectSlot(&out->objectHandle);
@@ -107,11 +108,19 @@ TPM2_CreatePrimary(
     newObject->attributes.primary = SET;
     if(in->primaryHandle == TPM_RH_ENDORSEMENT)
 	newObject->attributes.epsHierarchy = SET;
-    // Create the primary object.
-    result = CryptCreateObject(newObject, &in->inSensitive.sensitive,
-			       (RAND_STATE *)&rand);
-    if(result != TPM_RC_SUCCESS)
-	return result;
+    // Create the primary object. The same inputs always produce the same object, so
+    // a primary object that was created before is taken from the primary key cache.
+    PrimaryCacheComputeKey(in->primaryHandle, &name,
+			   &in->inSensitive.sensitive.data.b, &cacheKey);
+    if(!PrimaryCacheLookup(&cacheKey, &in->inSensitive.sensitive.userAuth,
+			   newObject))
+	{
+	    result = CryptCreateObject(newObject, &in->inSensitive.sensitive,
+				       (RAND_STATE *)&rand);
+	    if(result != TPM_RC_SUCCESS)
+		return result;
+	    PrimaryCacheStore(in->primaryHandle, &cacheKey, newObject);
+	}
     // Set the publicArea and name from the computed values
     out->outPublic.publicArea = newObject->publicArea;
     out->name = newObject->name;
@@ -299,6 +308,7 @@ TPM2_ChangePPS(
     gc.platformPolicy.t.size = 0;
     // Flush loaded object in platform hierarchy
     ObjectFlushHierarchy(TPM_RH_PLATFORM);
+    PrimaryCacheFlush(TPM_RH_PLATFORM);
     // Flush platform evict object and index in NV
     NvFlushHierarchy(TPM_RH_PLATFORM);
     // Save hierarchy changes to NV
@@ -348,6 +358,7 @@ TPM2_ChangeEPS(
     gp.endorsementPolicy.t.size = 0;
     // Flush loaded object in endorsement hierarchy
     ObjectFlushHierarchy(TPM_RH_ENDORSEMENT);
+    PrimaryCacheFlush(TPM_RH_ENDORSEMENT);
     // Flush evict object of endorsement hierarchy stored in NV
     NvFlushHierarchy(TPM_RH_ENDORSEMENT);
     // Save hierarchy changes to NV
@@ -399,6 +410,8 @@ TPM2_Clear(
     // Flush loaded object in storage and endorsement hierarchy
     ObjectFlushHierarchy(TPM_RH_OWNER);
     ObjectFlushHierarchy(TPM_RH_ENDORSEMENT);
+    PrimaryCacheFlush(TPM_RH_OWNER);
+    PrimaryCacheFlush(TPM_RH_ENDORSEMENT);
     // Flush owner and endorsement object and owner index in NV
     NvFlushHierarchy(TPM_RH_OWNER);
     NvFlushHierarchy(TPM_RH_ENDORSEMENT);
@@ -82,6 +82,39 @@ BOOL
 HierarchyIsEnabled(
 		   TPMI_RH_HIERARCHY    hierarchy      // IN: hierarchy
 		   );
+void
+PrimaryCacheComputeKey(
+		       TPMI_RH_HIERARCHY    hierarchy,     // IN: hierarchy of the primary seed
+		       TPM2B_NAME          *name,          // IN: Name computed over the template
+		       TPM2B               *data,          // IN: sensitive data
+		       TPM2B_DIGEST        *key            // OUT: cache key
+		       );
+BOOL
+PrimaryCacheLookup(
+		   TPM2B_DIGEST        *key,           // IN: cache key
+		   TPM2B_AUTH          *userAuth,      // IN: authValue of the object
+		   OBJECT              *object         // OUT: object to set
+		   );
+void
+PrimaryCacheStore(
+		  TPMI_RH_HIERARCHY    hierarchy,     // IN: hierarchy of the primary seed
+		  TPM2B_DIGEST        *key,           // IN: cache key
+		  OBJECT              *object         // IN: created object
+		  );
+void
+PrimaryCacheFlush(
+		  TPMI_RH_HIERARCHY    hierarchy      // IN: hierarchy or TPM_RH_UNASSIGNED
+		  );
+UINT32
+PrimaryCacheSave(
+		 BYTE                *buffer,        // OUT: saved cache
+		 UINT32               size           // IN: size of buffer
+		 );
+BOOL
+PrimaryCacheRestore(
+		    BYTE                *buffer,        // IN: saved cache
+		    UINT32               size           // IN: size of buffer
+		    );
 
 
 #endif
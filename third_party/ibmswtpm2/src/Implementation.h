@@ -350,21 +350,31 @@
 #define  HCRTM_PCR                      0
 #define  NUM_LOCALITIES                 5
 #define  MAX_HANDLE_NUM                 3
+#ifndef  MAX_ACTIVE_SESSIONS
 #define  MAX_ACTIVE_SESSIONS            64
+#endif
 #define  CONTEXT_SLOT                   UINT16
 #define  CONTEXT_COUNTER                UINT64
+#ifndef  MAX_LOADED_SESSIONS
 #define  MAX_LOADED_SESSIONS            3
+#endif
 #define  MAX_SESSION_NUM                3
+#ifndef  MAX_LOADED_OBJECTS
 #define  MAX_LOADED_OBJECTS             3
+#endif
 #define  MIN_EVICT_OBJECTS              2
 #define  NUM_POLICY_PCR_GROUP           1
 #define  NUM_AUTHVALUE_PCR_GROUP        1
 #define  MAX_CONTEXT_SIZE               2474
 #define  MAX_DIGEST_BUFFER              1024
+#ifndef  MAX_NV_INDEX_SIZE
 #define  MAX_NV_INDEX_SIZE              2048
+#endif
 #define  MAX_NV_BUFFER_SIZE             1024
 #define  MAX_CAP_BUFFER                 1024
+#ifndef  NV_MEMORY_SIZE
 #define  NV_MEMORY_SIZE                 16384
+#endif
 #define  MIN_COUNTER_INDICES            8
 #define  NUM_STATIC_PCR                 16
 #define  MAX_ALG_LIST_SIZE              64
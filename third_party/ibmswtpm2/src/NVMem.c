@@ -71,6 +71,26 @@
 #include "PlatformData.h"
 #include "Platform_fp.h"
 /* C.6.3. Functions */
+/* NvMarkDirty() */
+/* Adds a range of s_NV to the range written by the next _plat__NvCommit(), and records the blocks it
+   spans as written. */
+static void
+NvMarkDirty(
+	    unsigned int     start,         // IN: start of the written range
+	    unsigned int     size           // IN: size of the written range
+	    )
+{
+    unsigned int     block;
+    if(size == 0)
+	return;
+    _plat__StateChanged();
+    for(block = start / NV_BLOCK_SIZE; block <= (start + size - 1) / NV_BLOCK_SIZE; block++)
+	s_NvWrittenBlocks[block] = 1;
+    if(start < s_NvDirtyStart)
+	s_NvDirtyStart = start;
+    if(start + size > s_NvDirtyEnd)
+	s_NvDirtyEnd = start + size;
+}
 /* C.6.3.1. _plat__NvErrors() */
 /* This function is used by the simulator to set the error flags in the NV subsystem to simulate an
    error in the NV loading process */
@@ -150,6 +170,9 @@ _plat__NVEnable(
 	    fread(s_NV, NV_MEMORY_SIZE, 1, s_NVFile);
 	}
 #endif
+    // The file matches s_NV.
+    s_NvDirtyStart = NV_MEMORY_SIZE;
+    s_NvDirtyEnd = 0;
     // NV contents have been read and the error checks have been performed. For
     // simulation purposes, use the signaling interface to indicate if an error is
     // to be simulated and the type of the error.
@@ -164,6 +187,8 @@ _plat__NVDisable(
 		 void
 		 )
 {
+    // Commit writes held back by _plat__NvDeferCommit()
+    _plat__NvDeferCommit(FALSE);
 #ifdef  FILE_BACKED_NV
     assert(s_NVFile != NULL);
     // Close NV file
@@ -173,6 +198,44 @@ _plat__NVDisable(
 #endif
     return;
 }
+/* _plat__NvMemoryRestore() */
+/* Replaces the NV image, e.g. with one saved after manufacture by a TPM of the same build. NV must
+   be disabled, so that the next _plat__NVEnable() loads the image. */
+/* Return Values Meaning */
+/* 0 success */
+/* non-0 size is not NV_MEMORY_SIZE or the NV file can not be written */
+LIB_EXPORT int
+_plat__NvMemoryRestore(
+		       const void      *image,         // IN: NV image
+		       unsigned int     size           // IN: size of image
+		       )
+{
+    if(size != NV_MEMORY_SIZE)
+	return 1;
+    memcpy(s_NV, image, size);
+    _plat__StateChanged();
+    memset(s_NvWrittenBlocks, 1, sizeof(s_NvWrittenBlocks));
+#ifdef FILE_BACKED_NV
+    {
+	FILE            *file;
+	size_t           written;
+	assert(s_NVFile == NULL);
+#if defined _MSC_VER && 1
+	if(0 != fopen_s(&file, "NVChip", "w+b"))
+	    file = NULL;
+#else
+	file = fopen("NVChip", "w+b");
+#endif
+	if(file == NULL)
+	    return 1;
+	written = fwrite(s_NV, 1, NV_MEMORY_SIZE, file);
+	fclose(file);
+	if(written != NV_MEMORY_SIZE)
+	    return 1;
+    }
+#endif
+    return 0;
+}
 /* C.6.3.4. _plat__IsNvAvailable() */
 /* Check if NV is available */
 /* Return Values Meaning */
@@ -238,6 +301,7 @@ _plat__NvMemoryWrite(
     assert(startOffset + size <= NV_MEMORY_SIZE);
     // Copy the data to the NV image
     memcpy(&s_NV[startOffset], data, size);
+    NvMarkDirty(startOffset, size);
 }
 /* C.6.3.8. _plat__NvMemoryClear() */
 /* Function is used to set a range of NV memory bytes to an implementation-dependent value. The
@@ -251,6 +315,7 @@ _plat__NvMemoryClear(
     assert(start + size <= NV_MEMORY_SIZE);
     // In this implementation, assume that the errase value for NV is all 1s
     memset(&s_NV[start], 0xff, size);
+    NvMarkDirty(start, size);
 }
 /* C.6.3.9. _plat__NvMemoryMove() */
 /* Function: Move a chunk of NV memory from source to destination This function should ensure that
@@ -266,6 +331,7 @@ _plat__NvMemoryMove(
     assert(destOffset + size <= NV_MEMORY_SIZE);
     // Move data in RAM
     memmove(&s_NV[destOffset], &s_NV[sourceOffset], size);
+    NvMarkDirty(destOffset, size);
     return;
 }
 /* C.6.3.10. _plat__NvCommit() */
@@ -278,17 +344,61 @@ _plat__NvCommit(
 		void
 		)
 {
+    // Writes stay in RAM until commits are resumed
+    if(s_NvCommitDeferred)
+	return 0;
 #ifdef FILE_BACKED_NV
     // If NV file is not available, return failure
     if(s_NVFile == NULL)
 	return 1;
-    // Write RAM data to NV
-    fseek(s_NVFile, 0, SEEK_SET);
-    fwrite(s_NV, 1, NV_MEMORY_SIZE, s_NVFile);
+    // Write the RAM data changed since the last commit to NV
+    if(s_NvDirtyStart < s_NvDirtyEnd)
+	{
+	    fseek(s_NVFile, s_NvDirtyStart, SEEK_SET);
+	    fwrite(&s_NV[s_NvDirtyStart], 1, s_NvDirtyEnd - s_NvDirtyStart, s_NVFile);
+	}
+#endif
+    s_NvDirtyStart = NV_MEMORY_SIZE;
+    s_NvDirtyEnd = 0;
     return 0;
-#else
+}
+/* _plat__NvDeferCommit() */
+/* Defers or resumes NV commits. While commits are deferred, _plat__NvCommit() keeps the writes in
+   RAM, so that the writes of several commands are committed at once. Resuming commits commits the
+   writes made in the meantime. */
+/* Return Values Meaning */
+/* 0 NV write success */
+/* non-0 NV write fail */
+LIB_EXPORT int
+_plat__NvDeferCommit(
+		     int              defer          // IN: TRUE to defer commits
+		     )
+{
+    BOOL            wasDeferred = s_NvCommitDeferred;
+    s_NvCommitDeferred = (defer != 0);
+    if(wasDeferred && !s_NvCommitDeferred)
+	return _plat__NvCommit();
     return 0;
-#endif
+}
+/* _plat__NvTakeWrittenBlocks() */
+/* Sets blocks, which holds NV_BLOCK_COUNT entries, to the indices of the NV blocks written since the
+   last call, e.g. to persist only those, and forgets them. */
+/* Return Values Meaning */
+/* number of indices set in blocks */
+LIB_EXPORT unsigned int
+_plat__NvTakeWrittenBlocks(
+			   unsigned int    *blocks          // OUT: indices of the written blocks
+			   )
+{
+    unsigned int     block;
+    unsigned int     count = 0;
+    for(block = 0; block < NV_BLOCK_COUNT; block++)
+	{
+	    if(s_NvWrittenBlocks[block])
+		blocks[count++] = block;
+	    s_NvWrittenBlocks[block] = 0;
+	}
+    return count;
 }
 /* C.6.3.11. _plat__SetNvAvail() */
 /* Set the current NV state to available.  This function is for testing purpose only.  It is not
@@ -298,6 +408,7 @@ _plat__SetNvAvail(
 		  void
 		  )
 {
+    _plat__StateChanged();
     s_NvIsAvailable = TRUE;
     return;
 }
@@ -309,6 +420,7 @@ _plat__ClearNvAvail(
 		    void
 		    )
 {
+    _plat__StateChanged();
     s_NvIsAvailable = FALSE;
     return;
 }
@@ -76,6 +76,7 @@ ObjectFlush(
 	    )
 {
     object->attributes.occupied = CLEAR;
+    ClearBit((unsigned int)(object - s_objects), s_objectMap, sizeof(s_objectMap));
 }
 /* 8.6.3.2 ObjectSetInUse() */
 /* This access function sets the occupied attribute of an object slot. */
@@ -85,6 +86,7 @@ ObjectSetInUse(
 	       )
 {
     object->attributes.occupied = SET;
+    SetBit((unsigned int)(object - s_objects), s_objectMap, sizeof(s_objectMap));
 }
 /* 8.6.3.3 ObjectStartup() */
 /* This function is called at TPM2_Startup() to initialize the object subsystem. */
@@ -113,12 +115,19 @@ ObjectCleanupEvict(
 {
     UINT32      i;
     // This has to be iterated because a command may have two handles
-    // and they may both be persistent.
-    // This could be made to be more efficient so that a search is not needed.
+    // and they may both be persistent. Only the occupied slots are looked at so
+    // that a large object table does not cost a full scan on every command.
     for(i = 0; i < MAX_LOADED_OBJECTS; i++)
 	{
+	    OBJECT      *object;
+	    // Skip a whole octet of the occupancy map when it has no occupied slot
+	    if(s_objectMap[i >> 3] == 0)
+		{
+		    i |= 7;
+		    continue;
+		}
 	    // If an object is a temporary evict object, flush it from slot
-	    OBJECT      *object = &s_objects[i];
+	    object = &s_objects[i];
 	    if(object->attributes.evict == SET)
 		ObjectFlush(object);
 	}
@@ -265,7 +274,8 @@ GetHeriarchy(
 /* 8.6.3.12 FindEmptyObjectSlot() */
 /* This function finds an open object slot, if any. It will clear the attributes but will not set
    the occupied attribute. This is so that a slot may be used and discarded if everything does not
-   go as planned. */
+   go as planned. The lowest open slot is taken from s_objectMap so the assigned handles are the
+   same as with a scan of s_objects. */
 /* Return Values Meaning */
 /* null no open slot found */
 /* !=null pointer to available slot */
@@ -276,19 +286,16 @@ FindEmptyObjectSlot(
 {
     UINT32               i;
     OBJECT              *object;
-    for(i = 0; i < MAX_LOADED_OBJECTS; i++)
-	{
-	    object = &s_objects[i];
-	    if(object->attributes.occupied == CLEAR)
-		{
-		    if(handle)
-			*handle = i + TRANSIENT_FIRST;
-		    // Initialize the object attributes
-		    MemorySet(&object->attributes, 0, sizeof(OBJECT_ATTRIBUTES));
-		    return object;
-		}
-	}
-    return NULL;
+    i = FindClearBit(s_objectMap, MAX_LOADED_OBJECTS);
+    if(i >= MAX_LOADED_OBJECTS)
+	return NULL;
+    object = &s_objects[i];
+    pAssert(object->attributes.occupied == CLEAR);
+    if(handle)
+	*handle = i + TRANSIENT_FIRST;
+    // Initialize the object attributes
+    MemorySet(&object->attributes, 0, sizeof(OBJECT_ATTRIBUTES));
+    return object;
 }
 /* 8.6.3.13 ObjectAllocateSlot() */
 /* This function is used to allocate a slot in internal object array. */
@@ -667,6 +674,7 @@ FlushObject(
     // Clear all the object attributes
     MemorySet((BYTE*)&(s_objects[index].attributes),
 	      0, sizeof(OBJECT_ATTRIBUTES));
+    ObjectFlush(&s_objects[index]);
     return;
 }
 /* 8.6.3.23 ObjectFlushHierarchy() */
@@ -687,15 +695,15 @@ ObjectFlushHierarchy(
 			{
 			  case TPM_RH_PLATFORM:
 			    if(s_objects[i].attributes.ppsHierarchy == SET)
-				s_objects[i].attributes.occupied = FALSE;
+				ObjectFlush(&s_objects[i]);
 			    break;
 			  case TPM_RH_OWNER:
 			    if(s_objects[i].attributes.spsHierarchy == SET)
-				s_objects[i].attributes.occupied = FALSE;
+				ObjectFlush(&s_objects[i]);
 			    break;
 			  case TPM_RH_ENDORSEMENT:
 			    if(s_objects[i].attributes.epsHierarchy == SET)
-				s_objects[i].attributes.occupied = FALSE;
+				ObjectFlush(&s_objects[i]);
 			    break;
 			  default:
 			    FAIL(FATAL_ERROR_INTERNAL);
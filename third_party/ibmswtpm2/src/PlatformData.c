@@ -84,6 +84,8 @@ BOOL                 s_powerLost;
 /* From Entropy.c */
 uint32_t             lastEntropy;
 int                  firstValue;
+unsigned char        s_entropyPool[ENTROPY_POOL_SIZE];
+uint32_t             s_entropyPoolUsed = ENTROPY_POOL_SIZE;
 /* From NVMem.c */
 #ifdef  VTPM
 #   undef FILE_BACKED_NV
@@ -95,5 +97,11 @@ unsigned char        s_NV[NV_MEMORY_SIZE];
 BOOL                 s_NvIsAvailable;
 BOOL                 s_NV_unrecoverable;
 BOOL                 s_NV_recoverable;
+unsigned int         s_NvDirtyStart = NV_MEMORY_SIZE;
+unsigned int         s_NvDirtyEnd = 0;
+BOOL                 s_NvCommitDeferred;
+unsigned char        s_NvWrittenBlocks[NV_BLOCK_COUNT];
+/* From RunCommand.c */
+uint64_t             s_stateGeneration;
 /* From PPPlat.c */
 BOOL  s_physicalPresence;
@@ -120,6 +120,23 @@ extern unsigned char     s_NV[NV_MEMORY_SIZE];
 extern BOOL              s_NvIsAvailable;
 extern BOOL              s_NV_unrecoverable;
 extern BOOL              s_NV_recoverable;
+/* Range of s_NV written since the last commit. The range is empty when s_NvDirtyStart is not
+   below s_NvDirtyEnd. */
+extern unsigned int      s_NvDirtyStart;
+extern unsigned int      s_NvDirtyEnd;
+/* While SET, _plat__NvCommit() leaves the writes in s_NV so that they are committed together
+   when commits are no longer deferred. */
+extern BOOL              s_NvCommitDeferred;
+/* NV is also tracked in blocks of NV_BLOCK_SIZE bytes, the last one possibly shorter, so that it can
+   be persisted block by block. s_NvWrittenBlocks records the blocks written since the last
+   _plat__NvTakeWrittenBlocks(). */
+#define NV_BLOCK_SIZE           512
+#define NV_BLOCK_COUNT          ((NV_MEMORY_SIZE + NV_BLOCK_SIZE - 1) / NV_BLOCK_SIZE)
+extern unsigned char     s_NvWrittenBlocks[NV_BLOCK_COUNT];
+/* From RunCommand.c */
+/* Incremented whenever the TPM state may have changed, so that responses to read-only commands can
+   be reused while it stays the same. */
+extern uint64_t          s_stateGeneration;
 /* From PPPlat.c Physical presence.  It is initialized to FALSE */
 extern BOOL     s_physicalPresence;
 /* From Power */
@@ -127,6 +144,11 @@ extern BOOL        s_powerLost;
 /* From Entropy.c */
 extern uint32_t        lastEntropy;
 extern int             firstValue;
+/* Entropy is read from the system a pool at a time and handed out from here. The pool is a
+   multiple of the 32-bit block used by the repeated-value test. */
+#define ENTROPY_POOL_SIZE       256
+extern unsigned char   s_entropyPool[ENTROPY_POOL_SIZE];
+extern uint32_t        s_entropyPoolUsed;
 #endif // _PLATFORM_DATA_H_
 
 
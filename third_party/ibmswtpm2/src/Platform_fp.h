@@ -196,6 +196,17 @@ LIB_EXPORT void
 _plat__NVDisable(
 		 void
 		 );
+/* _plat__NvMemoryRestore() */
+/* Replaces the NV image, e.g. with one saved after manufacture by a TPM of the same build. NV must
+   be disabled, so that the next _plat__NVEnable() loads the image. */
+/* Return Values Meaning */
+/* 0 success */
+/* non-0 size is not NV_MEMORY_SIZE or the NV file can not be written */
+LIB_EXPORT int
+_plat__NvMemoryRestore(
+		       const void      *image,         // IN: NV image
+		       unsigned int     size           // IN: size of image
+		       );
 /* C.8.6.4. _plat__IsNvAvailable() */
 /* Check if NV is available */
 /* Return Values Meaning */
@@ -264,6 +275,26 @@ LIB_EXPORT int
 _plat__NvCommit(
 		void
 		);
+/* _plat__NvDeferCommit() */
+/* Defers or resumes NV commits. While commits are deferred, _plat__NvCommit() keeps the writes in
+   RAM, so that the writes of several commands are committed at once. Resuming commits commits the
+   writes made in the meantime. */
+/* Return Values Meaning */
+/* 0 NV write success */
+/* non-0 NV write fail */
+LIB_EXPORT int
+_plat__NvDeferCommit(
+		     int              defer          // IN: TRUE to defer commits
+		     );
+/* _plat__NvTakeWrittenBlocks() */
+/* Sets blocks, which holds NV_BLOCK_COUNT entries, to the indices of the NV blocks written since the
+   last call, e.g. to persist only those, and forgets them. */
+/* Return Values Meaning */
+/* number of indices set in blocks */
+LIB_EXPORT unsigned int
+_plat__NvTakeWrittenBlocks(
+			   unsigned int    *blocks          // OUT: indices of the written blocks
+			   );
 /* C.8.6.11. _plat__SetNvAvail() */
 /* Set the current NV state to available.  This function is for testing purpose only.  It is not
    part of the platform NV logic */
@@ -354,6 +385,21 @@ LIB_EXPORT NORETURN void
 _plat__Fail(
 	    void
 	    );
+/* _plat__StateChanged() */
+/* Records that the TPM state may have changed. */
+LIB_EXPORT void
+_plat__StateChanged(
+		    void
+		    );
+/* _plat__GetStateGeneration() */
+/* Returns a value that changes whenever the TPM state may have changed: after every command
+   except the read-only TPM2_GetCapability, TPM2_ReadPublic, TPM2_NV_ReadPublic and TPM2_PCR_Read
+   when they succeed without sessions, on any NV write and on power and NV signals. The responses
+   of commands that leave it unchanged can be reused until it changes. */
+LIB_EXPORT uint64_t
+_plat__GetStateGeneration(
+			  void
+			  );
 /* C.8.12. From Unique.c */
 /* C.8.13. _plat__GetUnique() */
 /* This function is used to access the platform-specific unique value. This function places the
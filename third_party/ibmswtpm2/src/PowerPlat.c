@@ -72,6 +72,7 @@ _plat__Signal_PowerOn(
 		      void
 		      )
 {
+    _plat__StateChanged();
     // Reset the timer
     _plat__TimerReset();
     // Need to indicate that we lost power
@@ -104,6 +105,7 @@ _plat__Signal_Reset(
 		    void
 		    )
 {
+    _plat__StateChanged();
     // Initialize locality
     s_locality = 0;
     // Command cancel
@@ -120,6 +122,7 @@ _plat__Signal_PowerOff(
 		       void
 		       )
 {
+    _plat__StateChanged();
     // Prepare NV memory for power off
     _plat__NVDisable();
     return;
@@ -78,6 +78,34 @@
 #include "ExecCommand_fp.h"
 jmp_buf              s_jumpBuffer;
 /* C.11.3. Functions */
+/* IsReadOnlyCommand() */
+/* Returns TRUE if the command only reads TPM state, and has no sessions whose nonces would make
+   its response unique. */
+static BOOL
+IsReadOnlyCommand(
+		  uint32_t         requestSize,   // IN: command buffer size
+		  unsigned char   *request        // IN: command buffer
+		  )
+{
+    UINT32           code;
+    // The header is a tag, a size and a command code, and the tag must be TPM_ST_NO_SESSIONS
+    if(requestSize < 10 || request[0] != 0x80 || request[1] != 0x01)
+	return FALSE;
+    code = ((UINT32)request[6] << 24) | (request[7] << 16) | (request[8] << 8) | request[9];
+    return code == TPM_CC_GetCapability || code == TPM_CC_ReadPublic
+	|| code == TPM_CC_NV_ReadPublic || code == TPM_CC_PCR_Read;
+}
+/* IsSuccessResponse() */
+/* Returns TRUE if the response code of the response is TPM_RC_SUCCESS. */
+static BOOL
+IsSuccessResponse(
+		  uint32_t         responseSize,  // IN: response buffer size
+		  unsigned char   *response       // IN: response buffer
+		  )
+{
+    return responseSize >= 10
+	&& (response[6] | response[7] | response[8] | response[9]) == 0;
+}
 /* C.11.3.1. _plat__RunCommand() */
 /* This version of RunCommand() will set up a jum_buf and call ExecuteCommand(). If the command
    executes without failing, it will return and RunCommand() will return. If there is a failure in
@@ -94,6 +122,9 @@ _plat__RunCommand(
 {
     setjmp(s_jumpBuffer);
     ExecuteCommand(requestSize, request, responseSize, response);
+    // A failing command may have changed state too, e.g. the DA counters, or entered failure mode
+    if(!IsReadOnlyCommand(requestSize, request) || !IsSuccessResponse(*responseSize, *response))
+	_plat__StateChanged();
 }
 /* C.11.3.2. _plat__Fail() */
 /* This is the platform depended failure exit for the TPM. */
@@ -104,3 +135,21 @@ _plat__Fail(
 {
     longjmp(&s_jumpBuffer[0], 1);
 }
+/* _plat__StateChanged() */
+/* Records that the TPM state may have changed. */
+LIB_EXPORT void
+_plat__StateChanged(
+		    void
+		    )
+{
+    s_stateGeneration++;
+}
+/* _plat__GetStateGeneration() */
+/* Returns a value that changes whenever the TPM state may have changed. */
+LIB_EXPORT uint64_t
+_plat__GetStateGeneration(
+			  void
+			  )
+{
+    return s_stateGeneration;
+}
@@ -72,7 +72,7 @@
    low nibble is 7, that means that values above 7 are older than values below it and, in this
    example, 9 is the oldest value. Note if we subtract the counter value, from each slot that
    contains a saved contextID we get (- - - - B - 2 - 8) and the oldest entry is now easy to
-   find. */
+   find. Entries are skipped an octet of s_contextMap at a time while none of them are active. */
 static void
 ContextIdSetOldest(
 		   void
@@ -87,6 +87,11 @@ ContextIdSetOldest(
     lowBits = (CONTEXT_SLOT)gr.contextCounter;
     for(i = 0; i < MAX_ACTIVE_SESSIONS; i++)
 	{
+	    if(s_contextMap[i >> 3] == 0)
+		{
+		    i |= 7;
+		    continue;
+		}
 	    entry = gr.contextArray[i];
 	    // only look at entries that are saved contexts
 	    if(entry > MAX_LOADED_SESSIONS)
@@ -116,8 +121,11 @@ SessionStartup(
     // are cleared and marked as not occupied
     for(i = 0; i < MAX_LOADED_SESSIONS; i++)
 	s_sessions[i].occupied = FALSE;   // session slot is not occupied
+    MemorySet(s_sessionMap, 0, sizeof(s_sessionMap));
     // The free session slots the number of maximum allowed loaded sessions
     s_freeSessionSlots = MAX_LOADED_SESSIONS;
+    // The occupancy map of the context array is rebuilt below
+    MemorySet(s_contextMap, 0, sizeof(s_contextMap));
     // Initialize context ID data.  On a ST_SAVE or hibernate sequence, it will
     // scan the saved array of session context counts, and clear any entry that
     // references a session that was in memory during the state save since that
@@ -133,6 +141,8 @@ SessionStartup(
 		    // reclaimed.
 		    if(gr.contextArray[i] <= MAX_LOADED_SESSIONS)
 			gr.contextArray[i] = 0;
+		    else
+			SetBit(i, s_contextMap, sizeof(s_contextMap));
 		}
 	    // Find the oldest session in context ID data and set it in
 	    // s_oldestSavedSession
@@ -141,8 +151,7 @@ SessionStartup(
     else
 	{
 	    // For STARTUP_CLEAR, clear out the contextArray
-	    for(i = 0; i < MAX_ACTIVE_SESSIONS; i++)
-		gr.contextArray[i] = 0;
+	    MemorySet(gr.contextArray, 0, sizeof(gr.contextArray));
 	    // reset the context counter
 	    gr.contextCounter = MAX_LOADED_SESSIONS + 1;
 	    // Initialize oldest saved session
@@ -301,18 +310,16 @@ ContextIdSessionCreate(
 	       == gr.contextArray[s_oldestSavedSession])
 		return TPM_RC_CONTEXT_GAP;
 	}
-    // Find an unoccupied entry in the contextArray
-    for(*handle = 0; *handle < MAX_ACTIVE_SESSIONS; (*handle)++)
-	{
-	    if(gr.contextArray[*handle] == 0)
-		{
-		    // indicate that the session associated with this handle
-		    // references a loaded session
-		    gr.contextArray[*handle] = (CONTEXT_SLOT)(sessionIndex + 1);
-		    return TPM_RC_SUCCESS;
-		}
-	}
-    return TPM_RC_SESSION_HANDLES;
+    // Find the lowest unoccupied entry in the contextArray
+    *handle = FindClearBit(s_contextMap, MAX_ACTIVE_SESSIONS);
+    if(*handle >= MAX_ACTIVE_SESSIONS)
+	return TPM_RC_SESSION_HANDLES;
+    pAssert(gr.contextArray[*handle] == 0);
+    // indicate that the session associated with this handle
+    // references a loaded session
+    gr.contextArray[*handle] = (CONTEXT_SLOT)(sessionIndex + 1);
+    SetBit(*handle, s_contextMap, sizeof(s_contextMap));
+    return TPM_RC_SUCCESS;
 }
 /* 8.9.6.2 SessionCreate() */
 /* This function does the detailed work for starting an authorization session. This is done in a
@@ -345,18 +352,12 @@ SessionCreate(
     if(s_freeSessionSlots == 0)
 	return TPM_RC_SESSION_MEMORY;
     // Find a space for loading a session
-    for(slotIndex = 0; slotIndex < MAX_LOADED_SESSIONS; slotIndex++)
-	{
-	    // Is this available?
-	    if(s_sessions[slotIndex].occupied == FALSE)
-		{
-		    session = &s_sessions[slotIndex].session;
-		    break;
-		}
-	}
+    slotIndex = (CONTEXT_SLOT)FindClearBit(s_sessionMap, MAX_LOADED_SESSIONS);
     // if no spot found, then this is an internal error
-    if(slotIndex >= MAX_LOADED_SESSIONS)
+    if(slotIndex >= MAX_LOADED_SESSIONS
+       || s_sessions[slotIndex].occupied != FALSE)
 	FAIL(FATAL_ERROR_INTERNAL);
+    session = &s_sessions[slotIndex].session;
     // Call context ID function to get a handle.  TPM_RC_SESSION_HANDLE may be
     // returned from ContextIdHandelAssign()
     result = ContextIdSessionCreate(sessionHandle, slotIndex);
@@ -366,6 +367,7 @@ SessionCreate(
     // Can now indicate that the session array entry is occupied.
     s_freeSessionSlots--;
     s_sessions[slotIndex].occupied = TRUE;
+    SetBit(slotIndex, s_sessionMap, sizeof(s_sessionMap));
     // Initialize the session data
     MemorySet(session, 0, sizeof(SESSION));
     // Initialize internal session data
@@ -490,6 +492,7 @@ SessionContextSave(
 	s_oldestSavedSession = contextIndex;
     // Mark the session slot as unoccupied
     s_sessions[slotIndex].occupied = FALSE;
+    ClearBit(slotIndex, s_sessionMap, sizeof(s_sessionMap));
     // and indicate that there is an additional open slot
     s_freeSessionSlots++;
     return TPM_RC_SUCCESS;
@@ -517,10 +520,10 @@ SessionContextLoad(
     if(s_freeSessionSlots == 0)
 	return TPM_RC_SESSION_MEMORY;
     // Find a free session slot to load the session
-    for(slotIndex = 0; slotIndex < MAX_LOADED_SESSIONS; slotIndex++)
-	if(s_sessions[slotIndex].occupied == FALSE) break;
+    slotIndex = (CONTEXT_SLOT)FindClearBit(s_sessionMap, MAX_LOADED_SESSIONS);
     // if no spot found, then this is an internal error
-    pAssert(slotIndex < MAX_LOADED_SESSIONS);
+    pAssert(slotIndex < MAX_LOADED_SESSIONS
+	    && s_sessions[slotIndex].occupied == FALSE);
     contextIndex = *handle & HR_HANDLE_MASK;   // extract the index
     // If there is only one slot left, and the gap is at maximum, the only session
     // context that we can safely load is the oldest one.
@@ -540,6 +543,7 @@ SessionContextLoad(
     MemoryCopy(&s_sessions[slotIndex].session, session, sizeof(SESSION));
     // Set session slot as occupied
     s_sessions[slotIndex].occupied = TRUE;
+    SetBit(slotIndex, s_sessionMap, sizeof(s_sessionMap));
     // Reduce the number of open spots
     s_freeSessionSlots--;
     return TPM_RC_SUCCESS;
@@ -568,6 +572,7 @@ SessionFlush(
     slotIndex = gr.contextArray[contextIndex];
     // Mark context array entry as available
     gr.contextArray[contextIndex] = 0;
+    ClearBit(contextIndex, s_contextMap, sizeof(s_contextMap));
     // Is this a saved session being flushed
     if(slotIndex > MAX_LOADED_SESSIONS)
 	{
@@ -582,6 +587,7 @@ SessionFlush(
 	    slotIndex -= 1;
 	    // Free session array index
 	    s_sessions[slotIndex].occupied = FALSE;
+	    ClearBit(slotIndex, s_sessionMap, sizeof(s_sessionMap));
 	    s_freeSessionSlots++;
 	}
     return;
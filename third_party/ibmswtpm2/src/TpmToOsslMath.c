@@ -72,6 +72,7 @@
 #include "Tpm.h"
 #if MATH_LIB == OSSL
 #include "TpmToOsslMath_fp.h"
+#include <openssl/objects.h>
 /* B.2.3.2.3.1. OsslToTpmBn() */
 /* This function converts an OpenSSL() BIGNUM to a TPM bignum. In this implementation it is assumed
    that OpenSSL() used the same format for a big number as does the TPM -- an array of native-endian
@@ -436,6 +437,134 @@ EcPointInitialized(
     BN_free(bnX);
     return P;
 }
+/* OsslCurveNid() */
+/* This function returns the OpenSSL() NID of a TPM curve that the library knows by name, or
+   NID_undef when it does not. */
+static int
+OsslCurveNid(
+	     TPM_ECC_CURVE     curveId      // IN: curve identifier
+	     )
+{
+    switch(curveId)
+	{
+#if ECC_NIST_P192
+	  case TPM_ECC_NIST_P192:
+	    return NID_X9_62_prime192v1;
+#endif
+#if ECC_NIST_P224
+	  case TPM_ECC_NIST_P224:
+	    return NID_secp224r1;
+#endif
+#if ECC_NIST_P256
+	  case TPM_ECC_NIST_P256:
+	    return NID_X9_62_prime256v1;
+#endif
+#if ECC_NIST_P384
+	  case TPM_ECC_NIST_P384:
+	    return NID_secp384r1;
+#endif
+#if ECC_NIST_P521
+	  case TPM_ECC_NIST_P521:
+	    return NID_secp521r1;
+#endif
+	  default:
+	    return NID_undef;
+	}
+}
+/* OsslCurveGroupNew() */
+/* This function builds the OpenSSL() group for a curve. For a curve that the library knows by name,
+   the library's own group is used. That group comes with precomputed multiples of the generator
+   (a fixed-base comb), so [d]G does not need a general point multiply. Any other curve (such as
+   the BN curves) is built from the parameter data. */
+/* Return Values Meaning */
+/* NULL the group could not be built */
+/* non-NULL the new group */
+static EC_GROUP *
+OsslCurveGroupNew(
+		  const ECC_CURVE_DATA    *C,        // IN: the TPM curve values
+		  TPM_ECC_CURVE            curveId,  // IN: curve identifier
+		  BN_CTX                  *CTX       // IN: the math context
+		  )
+{
+    EC_GROUP                *group = NULL;
+    EC_POINT                *P = NULL;
+    int                      nid = OsslCurveNid(curveId);
+    BIG_INITIALIZED(bnP, C->prime);
+    BIG_INITIALIZED(bnA, C->a);
+    BIG_INITIALIZED(bnB, C->b);
+    BIG_INITIALIZED(bnX, C->base.x);
+    BIG_INITIALIZED(bnY, C->base.y);
+    BIG_INITIALIZED(bnN, C->order);
+    BIG_INITIALIZED(bnH, C->h);
+    int                      OK = TRUE;
+    //
+    if(nid != NID_undef)
+	group = EC_GROUP_new_by_curve_name(nid);
+    if(group == NULL)
+	{
+	    // initialize EC group, associate a generator point and initialize the point
+	    // from the parameter data
+	    // Create a group structure
+	    OK = OK && (group = EC_GROUP_new_curve_GFp(bnP, bnA, bnB, CTX)) != NULL;
+	    // Allocate a point in the group that will be used in setting the
+	    // generator. This is not needed after the generator is set.
+	    OK = OK && ((P = EC_POINT_new(group)) != NULL);
+	    // Need to use this in case Montgomery method is being used
+	    OK = OK
+		 && EC_POINT_set_affine_coordinates_GFp(group, P, bnX, bnY, CTX);
+	    // Now set the generator
+	    OK = OK && EC_GROUP_set_generator(group, P, bnN, bnH);
+	    if(P != NULL)
+		EC_POINT_free(P);
+	}
+    if(!OK && group != NULL)
+	{
+	    EC_GROUP_free(group);
+	    group = NULL;
+	}
+    BN_free(bnH);
+    BN_free(bnN);
+    BN_free(bnY);
+    BN_free(bnX);
+    BN_free(bnB);
+    BN_free(bnA);
+    BN_free(bnP);
+    return group;
+}
+/* This table holds the OpenSSL() group for each curve. A group is built the first time its curve
+   is used and is then shared by every later operation on that curve, so the generator tables are
+   only computed once. The groups are never modified after they are built. */
+static struct
+{
+    TPM_ECC_CURVE        curveId;
+    EC_GROUP            *group;
+} s_curveGroups[ECC_CURVE_COUNT];
+/* OsslCurveGroup() */
+/* This function returns the cached group for a curve, building it if needed. */
+/* Return Values Meaning */
+/* NULL the group could not be built or there is no room in the cache */
+/* non-NULL the group; it is owned by the cache and must not be freed */
+static EC_GROUP *
+OsslCurveGroup(
+	       const ECC_CURVE_DATA    *C,        // IN: the TPM curve values
+	       TPM_ECC_CURVE            curveId,  // IN: curve identifier
+	       BN_CTX                  *CTX       // IN: the math context
+	       )
+{
+    UINT32               i;
+    for(i = 0; i < ECC_CURVE_COUNT; i++)
+	{
+	    if(s_curveGroups[i].group == NULL)
+		{
+		    s_curveGroups[i].group = OsslCurveGroupNew(C, curveId, CTX);
+		    s_curveGroups[i].curveId = curveId;
+		    return s_curveGroups[i].group;
+		}
+	    if(s_curveGroups[i].curveId == curveId)
+		return s_curveGroups[i].group;
+	}
+    return NULL;
+}
 /* B.2.3.2.3.10. BnCurveInitialize() */
 /* This function initializes the OpenSSL() group definition */
 /* It is a fatal error if groupContext is not provided. */
@@ -449,38 +578,13 @@ BnCurveInitialize(
 		  )
 {
     EC_GROUP                *group = NULL;
-    EC_POINT                *P = NULL;
     const ECC_CURVE_DATA    *C = GetCurveData(curveId);
     BN_CTX                  *CTX = NULL;
-    BIG_INITIALIZED(bnP, C != NULL ? C->prime : NULL);
-    BIG_INITIALIZED(bnA, C != NULL ? C->a : NULL);
-    BIG_INITIALIZED(bnB, C != NULL ? C->b : NULL);
-    BIG_INITIALIZED(bnX, C != NULL ? C->base.x : NULL);
-    BIG_INITIALIZED(bnY, C != NULL ? C->base.y : NULL);
-    BIG_INITIALIZED(bnN, C != NULL ? C->order : NULL);
-    BIG_INITIALIZED(bnH, C != NULL ? C->h : NULL);
     int                      OK = (C != NULL);
     //
     OK = OK && ((CTX = OsslContextEnter()) != NULL);
-    // initialize EC group, associate a generator point and initialize the point
-    // from the parameter data
-    // Create a group structure
-    OK = OK && (group = EC_GROUP_new_curve_GFp(bnP, bnA, bnB, CTX)) != NULL;
-    // Allocate a point in the group that will be used in setting the
-    // generator. This is not needed after the generator is set.
-    OK = OK && ((P = EC_POINT_new(group)) != NULL);
-    // Need to use this in case Montgomery method is being used
-    OK = OK
-	 && EC_POINT_set_affine_coordinates_GFp(group, P, bnX, bnY, CTX);
-    // Now set the generator
-    OK = OK && EC_GROUP_set_generator(group, P, bnN, bnH);
-    if(P != NULL)
-	EC_POINT_free(P);
-    if(!OK && group != NULL)
-	{
-	    EC_GROUP_free(group);
-	    group = NULL;
-	}
+    // The group is shared; CURVE_FREE() only releases the context
+    OK = OK && ((group = OsslCurveGroup(C, curveId, CTX)) != NULL);
     if(!OK && CTX != NULL)
 	{
 	    OsslContextLeave(CTX);
@@ -489,13 +593,6 @@ BnCurveInitialize(
     E->G = group;
     E->CTX = CTX;
     E->C = C;
-    BN_free(bnH);
-    BN_free(bnN);
-    BN_free(bnY);
-    BN_free(bnX);
-    BN_free(bnB);
-    BN_free(bnA);
-    BN_free(bnP);
     return OK ? E : NULL;
 }
 /* B.2.3.2.3.11. BnEccModMult() */
@@ -109,11 +109,10 @@ typedef OSSL_CURVE_DATA      *bigCurve;
     OSSL_CURVE_DATA     _##name;					\
     bigCurve            name =  BnCurveInitialize(&_##name, initializer)
 #include "TpmToOsslSupport_fp.h"
+/* The group is owned by the per-curve cache in TpmToOsslMath.c and is not freed here */
 #define CURVE_FREE(E)							\
     if(E != NULL)							\
 	{								\
-	    if(E->G != NULL)						\
-		EC_GROUP_free(E->G);					\
 	    OsslContextLeave(E->CTX);					\
 	}
 #define OSSL_ENTER()     BN_CTX      *CTX = OsslContextEnter()
@@ -0,0 +1,43 @@
+#!/bin/bash
+# Copyright 2018 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Builds app_benchmark to WebAssembly with and without SIMD, runs both builds
+# with node and prints the time per operation of each benchmark side by side.
+# The EncryptDecrypt benchmarks run the SIMD block XORs of CryptSym.c.
+# Run from the repository root, with emsdk activated.
+set -e
+
+for profile in scalar simd; do
+  build_dir="build-web-${profile}"
+  simd=OFF
+  node_flags=""
+  if [ "${profile}" = "simd" ]; then
+    simd=ON
+    node_flags="--experimental-wasm-simd"
+  fi
+  mkdir -p "${build_dir}"
+  (cd "${build_dir}" &&
+    emcmake cmake .. -DCMAKE_BUILD_TYPE=Release -DTPMJS_WASM_SIMD=${simd} &&
+    make -j"$(nproc)" app_benchmark &&
+    node ${node_flags} app_benchmark.js > "${profile}.txt")
+done
+
+# Lines of app_benchmark are "<name> <ops> ops <us> us/op".
+printf "%-32s %12s %12s %8s\n" benchmark "scalar us/op" "simd us/op" speedup
+awk 'NR == FNR { scalar[$1] = $4; next }
+     $1 in scalar {
+       printf "%-32s %12.1f %12.1f %7.2fx\n", $1, scalar[$1], $4,
+              scalar[$1] / $4
+     }' build-web-scalar/scalar.txt build-web-simd/simd.txt